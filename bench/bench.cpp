@@ -0,0 +1,446 @@
+// Benchmarks for the lexer, parser and interpreter hot paths.
+//
+// Usage: cook_bench [--repetitions=N] [--scale=F] [--filter=text]
+//                   [--json=results.json] [--compare=baseline.json]
+
+#include "embedded.h"
+#include "lexer.h"
+#include "parser.h"
+#include "interpreter.h"
+#include "stats.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace cook;
+
+// Command line options
+struct BenchOptions {
+    int repetitions = 10;
+    double scale = 1.0;
+    std::string filter;
+    std::string jsonPath;
+    std::string comparePath;
+};
+
+// Which stage of the pipeline a benchmark measures. STARTUP lexes, parses
+// and runs a script from scratch 'size' times; EMBEDDED runs the same script
+// compiled in with cook::embedded 'size' times.
+enum class Stage { LEX, PARSE, EXECUTE, STARTUP, EMBEDDED };
+
+struct Benchmark {
+    std::string name;
+    Stage stage;
+    std::string unit;                       // "MB", "nodes", "calls" or "runs"
+    std::function<std::string(int)> generate;
+    std::function<double(int)> calls;       // known count, for "calls" and "runs"
+    int size;
+};
+
+struct Result {
+    std::string name;
+    std::string unit;
+    double amount = 0.0;
+    double minMs = 0.0;
+    double medianMs = 0.0;
+    double meanMs = 0.0;
+    double stddevMs = 0.0;
+    double throughput = 0.0;
+};
+
+// Stream that discards everything written to it
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char*, std::streamsize count) override { return count; }
+};
+
+static int scaled(int base, double scale) {
+    return std::max(1, static_cast<int>(base * scale));
+}
+
+// Workload generators
+
+static std::string flatIngredients(int count) {
+    std::ostringstream source;
+    for (int i = 0; i < count; i++) {
+        if (i % 2 == 0) {
+            source << "ingredient flour_" << i << " = " << (i % 100) << ".25; // cups\n";
+        } else {
+            source << "ingredient label_" << i << " = \"batch " << i << "\";\n";
+        }
+    }
+    return source.str();
+}
+
+static std::string nestedExpressions(int count) {
+    const int depth = 64;
+    std::ostringstream source;
+    source << "ingredient a = 3;\n";
+    for (int i = 0; i < count; i++) {
+        source << "taste ";
+        for (int d = 0; d < depth; d++) source << "(";
+        source << "a";
+        for (int d = 0; d < depth; d++) {
+            source << (d % 2 == 0 ? " + " : " * ") << (d + 1) << ")";
+        }
+        source << ";\n";
+    }
+    return source.str();
+}
+
+// Flat statements mixing every operator precedence level
+static std::string operatorChains(int count) {
+    std::ostringstream source;
+    source << "ingredient a = 3;\ningredient b = 4;\n";
+    for (int i = 0; i < count; i++) {
+        source << "taste -a * " << i << " + b / 2 - -1 < a + b * " << (i % 7)
+               << " == !(a - b >= " << (i % 5) << ") != b <= a * a + " << i << " > -b;\n";
+    }
+    return source.str();
+}
+
+static std::string concatChains(int count) {
+    const int length = 64;
+    std::ostringstream source;
+    source << "ingredient word = \"salt\";\n";
+    source << "ingredient amount = 2;\n";
+    for (int i = 0; i < count; i++) {
+        source << "taste \"start\"";
+        for (int j = 0; j < length; j++) {
+            source << (j % 3 == 0 ? " + word" : j % 3 == 1 ? " + amount" : " + \", \"");
+        }
+        source << ";\n";
+    }
+    return source.str();
+}
+
+static const int CALL_TREE_DEPTH = 10;
+
+static std::string recursiveCalls(int count) {
+    std::ostringstream source;
+    for (int level = 0; level < CALL_TREE_DEPTH; level++) {
+        source << "recipe level" << level << "(n) {\n";
+        source << "    cook level" << (level + 1) << "(n + 1);\n";
+        source << "    cook level" << (level + 1) << "(n + 2);\n";
+        source << "}\n";
+    }
+    source << "recipe level" << CALL_TREE_DEPTH << "(n) {\n";
+    source << "    ingredient leaf = n * 2;\n";
+    source << "}\n";
+    for (int i = 0; i < count; i++) {
+        source << "cook level0(" << i << ");\n";
+    }
+    return source.str();
+}
+
+static double recursiveCallCount(int count) {
+    return static_cast<double>(count) * ((1 << (CALL_TREE_DEPTH + 1)) - 1);
+}
+
+static std::string manyGlobals(int count) {
+    const int globals = 1000;
+    std::ostringstream source;
+    for (int i = 0; i < globals; i++) {
+        source << "ingredient global_" << i << " = \"value " << i << "\";\n";
+    }
+    source << "recipe touch(n) {\n";
+    source << "    ingredient local = n + global_7;\n";
+    source << "}\n";
+    for (int i = 0; i < count; i++) {
+        source << "cook touch(" << i << ");\n";
+    }
+    return source.str();
+}
+
+// Unit conversions through the built-in cookbook's native recipes
+static std::string nativeCalls(int count) {
+    std::ostringstream source;
+    source << "cookbook \"builtin:pantry\";\n";
+    for (int i = 0; i < count; i++) {
+        source << "ingredient grams_" << (i % 100) << " = round_to(" << i << " * 28.35, 1);\n";
+    }
+    return source.str();
+}
+
+// A small script run whole, for the startup benchmarks
+struct KitchenScript {
+    static constexpr std::string_view source = R"(
+ingredient servings = 4;
+ingredient flour = 250;
+ingredient name = "Pancakes";
+recipe scale(amount, people) {
+    ingredient scaled = amount * people / servings;
+    taste name + ": " + scaled;
+}
+cook scale(flour, 2);
+cook scale(flour, 8);
+cook scale(3, 12);
+taste flour * 1.5;
+)";
+};
+
+static std::string kitchenScript(int) {
+    return std::string(KitchenScript::source);
+}
+
+// AST node counting
+
+static size_t countNodes(const Expression* expr);
+
+static size_t countNodes(const Statement* stmt) {
+    if (!stmt) return 0;
+    if (auto exprStmt = dynamic_cast<const ExpressionStmt*>(stmt)) {
+        return 1 + countNodes(exprStmt->expression.get());
+    } else if (auto ingredientStmt = dynamic_cast<const IngredientStmt*>(stmt)) {
+        return 1 + countNodes(ingredientStmt->initializer.get());
+    } else if (auto recipeStmt = dynamic_cast<const RecipeStmt*>(stmt)) {
+        size_t count = 1;
+        for (const auto& bodyStmt : recipeStmt->body) count += countNodes(bodyStmt.get());
+        return count;
+    } else if (auto tasteStmt = dynamic_cast<const TasteStmt*>(stmt)) {
+        return 1 + countNodes(tasteStmt->expression.get());
+    }
+    return 1;
+}
+
+static size_t countNodes(const Expression* expr) {
+    if (!expr) return 0;
+    if (auto unaryExpr = dynamic_cast<const UnaryExpr*>(expr)) {
+        return 1 + countNodes(unaryExpr->operand.get());
+    } else if (auto binaryExpr = dynamic_cast<const BinaryExpr*>(expr)) {
+        return 1 + countNodes(binaryExpr->left.get()) + countNodes(binaryExpr->right.get());
+    } else if (auto assignExpr = dynamic_cast<const AssignExpr*>(expr)) {
+        return 1 + countNodes(assignExpr->value.get());
+    } else if (auto callExpr = dynamic_cast<const CallExpr*>(expr)) {
+        size_t count = 1;
+        for (const auto& arg : callExpr->arguments) count += countNodes(arg.get());
+        return count;
+    }
+    return 1;
+}
+
+static size_t countNodes(const Program& program) {
+    size_t count = 0;
+    for (const auto& stmt : program.statements) count += countNodes(stmt.get());
+    return count;
+}
+
+// Measurement
+
+static Result measure(const Benchmark& benchmark, int repetitions) {
+    std::string source = benchmark.generate(benchmark.size);
+    std::vector<Token> tokens = Lexer(source).tokenize();
+    std::unique_ptr<Program> program = Parser(tokens).parse();
+
+    NullBuffer nullBuffer;
+    std::ostream nullStream(&nullBuffer);
+
+    std::function<void()> body;
+    Result result;
+    result.name = benchmark.name;
+    result.unit = benchmark.unit;
+
+    switch (benchmark.stage) {
+        case Stage::LEX:
+            body = [&]() { Lexer(source).tokenize(); };
+            break;
+        case Stage::PARSE:
+            body = [&]() { Parser(tokens).parse(); };
+            break;
+        case Stage::EXECUTE:
+            body = [&]() {
+                Interpreter interpreter;
+                interpreter.setOutput(nullStream);
+                interpreter.interpret(*program);
+            };
+            break;
+        case Stage::STARTUP:
+            body = [&]() {
+                for (int i = 0; i < benchmark.size; i++) {
+                    Interpreter interpreter;
+                    interpreter.setOutput(nullStream);
+                    interpreter.interpret(*Parser(Lexer(source).tokenize()).parse());
+                }
+            };
+            break;
+        case Stage::EMBEDDED:
+            body = [&]() {
+                for (int i = 0; i < benchmark.size; i++) {
+                    embedded::Script<KitchenScript> script(nullStream);
+                    script.run();
+                }
+            };
+            break;
+    }
+
+    if (benchmark.unit == "MB") {
+        result.amount = static_cast<double>(source.size()) / (1024.0 * 1024.0);
+    } else if (benchmark.unit == "calls" || benchmark.unit == "runs") {
+        result.amount = benchmark.calls(benchmark.size);
+    } else {
+        result.amount = static_cast<double>(countNodes(*program));
+    }
+
+    // One warm-up run, then the measured repetitions
+    body();
+    std::vector<double> samples;
+    for (int i = 0; i < repetitions; i++) {
+        Stopwatch stopwatch;
+        body();
+        samples.push_back(stopwatch.elapsedMillis());
+    }
+
+    std::sort(samples.begin(), samples.end());
+    size_t middle = samples.size() / 2;
+    result.minMs = samples.front();
+    result.medianMs = samples.size() % 2 ? samples[middle]
+                                         : (samples[middle - 1] + samples[middle]) / 2.0;
+
+    double sum = 0.0;
+    for (double sample : samples) sum += sample;
+    result.meanMs = sum / samples.size();
+
+    double variance = 0.0;
+    for (double sample : samples) variance += (sample - result.meanMs) * (sample - result.meanMs);
+    result.stddevMs = samples.size() > 1 ? std::sqrt(variance / (samples.size() - 1)) : 0.0;
+
+    result.throughput = result.medianMs > 0.0 ? result.amount / (result.medianMs / 1000.0) : 0.0;
+    return result;
+}
+
+// Results files hold one benchmark object per line so they are easy to diff
+static void writeJson(const std::string& path, const std::vector<Result>& results) {
+    std::ofstream out(path);
+    if (!out.is_open()) {
+        std::cerr << "Could not write results: " << path << std::endl;
+        return;
+    }
+
+    out << std::setprecision(6) << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        out << "    {\"name\": \"" << r.name << "\", \"unit\": \"" << r.unit
+            << "\", \"amount\": " << r.amount
+            << ", \"min_ms\": " << r.minMs << ", \"median_ms\": " << r.medianMs
+            << ", \"mean_ms\": " << r.meanMs << ", \"stddev_ms\": " << r.stddevMs
+            << ", \"throughput\": " << r.throughput
+            << ", \"throughput_unit\": \"" << r.unit << "/s\"}"
+            << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+static std::map<std::string, double> readBaseline(const std::string& path) {
+    std::map<std::string, double> medians;
+    std::ifstream in(path);
+    std::string line;
+
+    while (std::getline(in, line)) {
+        size_t name = line.find("\"name\": \"");
+        size_t median = line.find("\"median_ms\": ");
+        if (name == std::string::npos || median == std::string::npos) continue;
+
+        name += 9;
+        std::string key = line.substr(name, line.find('"', name) - name);
+        medians[key] = std::strtod(line.c_str() + median + 13, nullptr);
+    }
+    return medians;
+}
+
+static bool parseOptions(int argc, char* argv[], BenchOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg.compare(0, 14, "--repetitions=") == 0) {
+            options.repetitions = std::max(1, std::atoi(arg.c_str() + 14));
+        } else if (arg.compare(0, 8, "--scale=") == 0) {
+            options.scale = std::atof(arg.c_str() + 8);
+        } else if (arg.compare(0, 9, "--filter=") == 0) {
+            options.filter = arg.substr(9);
+        } else if (arg.compare(0, 7, "--json=") == 0) {
+            options.jsonPath = arg.substr(7);
+        } else if (arg.compare(0, 10, "--compare=") == 0) {
+            options.comparePath = arg.substr(10);
+        } else {
+            return false;
+        }
+    }
+    return options.scale > 0.0;
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cout << "Usage: cook_bench [--repetitions=N] [--scale=F] [--filter=text]"
+                  << " [--json=file] [--compare=file]" << std::endl;
+        return 1;
+    }
+
+    double s = options.scale;
+    std::vector<Benchmark> benchmarks = {
+        {"lex_flat_ingredients", Stage::LEX, "MB", flatIngredients, nullptr, scaled(200000, s)},
+        {"parse_flat_ingredients", Stage::PARSE, "nodes", flatIngredients, nullptr, scaled(200000, s)},
+        {"parse_nested_expressions", Stage::PARSE, "nodes", nestedExpressions, nullptr, scaled(2000, s)},
+        {"parse_operator_chains", Stage::PARSE, "nodes", operatorChains, nullptr, scaled(20000, s)},
+        {"exec_nested_expressions", Stage::EXECUTE, "nodes", nestedExpressions, nullptr, scaled(2000, s)},
+        {"exec_concat_chains", Stage::EXECUTE, "nodes", concatChains, nullptr, scaled(2000, s)},
+        {"exec_recursive_calls", Stage::EXECUTE, "calls", recursiveCalls, recursiveCallCount, scaled(20, s)},
+        {"exec_many_globals", Stage::EXECUTE, "calls", manyGlobals,
+         [](int count) { return static_cast<double>(count); }, scaled(1000, s)},
+        {"exec_native_calls", Stage::EXECUTE, "calls", nativeCalls,
+         [](int count) { return static_cast<double>(count); }, scaled(20000, s)},
+        {"startup_interpreted", Stage::STARTUP, "runs", kitchenScript,
+         [](int count) { return static_cast<double>(count); }, scaled(20000, s)},
+        {"startup_embedded", Stage::EMBEDDED, "runs", kitchenScript,
+         [](int count) { return static_cast<double>(count); }, scaled(20000, s)},
+    };
+
+    std::map<std::string, double> baseline;
+    if (!options.comparePath.empty()) {
+        baseline = readBaseline(options.comparePath);
+    }
+
+    std::vector<Result> results;
+    std::cout << std::left << std::setw(28) << "benchmark" << std::right
+              << std::setw(12) << "median ms" << std::setw(12) << "stddev ms"
+              << std::setw(20) << "throughput";
+    if (!baseline.empty()) std::cout << std::setw(12) << "vs base";
+    std::cout << std::endl;
+
+    for (const auto& benchmark : benchmarks) {
+        if (!options.filter.empty() && benchmark.name.find(options.filter) == std::string::npos) {
+            continue;
+        }
+
+        Result result = measure(benchmark, options.repetitions);
+        results.push_back(result);
+
+        std::ostringstream throughput;
+        throughput << std::fixed << std::setprecision(result.unit == "MB" ? 2 : 0)
+                   << result.throughput << " " << result.unit << "/s";
+
+        std::cout << std::left << std::setw(28) << result.name << std::right << std::fixed
+                  << std::setprecision(3) << std::setw(12) << result.medianMs
+                  << std::setw(12) << result.stddevMs << std::setw(20) << throughput.str();
+
+        auto base = baseline.find(result.name);
+        if (base != baseline.end() && result.medianMs > 0.0) {
+            std::cout << std::setw(11) << std::setprecision(2) << base->second / result.medianMs << "x";
+        }
+        std::cout << std::endl;
+    }
+
+    if (!options.jsonPath.empty()) {
+        writeJson(options.jsonPath, results);
+    }
+
+    return 0;
+}
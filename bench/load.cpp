@@ -0,0 +1,227 @@
+// Load generator for `cook serve`: keeps a number of connections busy sending
+// requests for one script and reports the latency distribution.
+//
+// Usage: cook_load --socket=path --script=name [--connections=N] [--requests=N]
+//                  [--warmup=N] [--ingredients=json]
+//
+// Latency is measured from sending a request to receiving its status line.
+
+#include "json.h"
+#include "stats.h"
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+using namespace cook;
+
+// Command line options
+struct LoadOptions {
+    std::string socketPath;
+    std::string script;
+    std::string ingredients = "{}";
+    int connections = 4;
+    int requests = 10000;
+    int warmup = 100;
+};
+
+// Outcome of one connection's share of the requests
+struct ClientResult {
+    std::vector<double> latenciesMs;
+    int errors = 0;
+    std::string firstError;
+};
+
+#ifndef _WIN32
+
+static int connectTo(const std::string& path) {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) return -1;
+    std::strcpy(address.sun_path, path.c_str());
+
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Reads newline-terminated replies from a connection
+class LineReader {
+public:
+    explicit LineReader(int fd) : fd(fd) {}
+
+    bool next(std::string& line) {
+        while (true) {
+            size_t end = buffer.find('\n', start);
+            if (end != std::string::npos) {
+                line.assign(buffer, start, end - start);
+                start = end + 1;
+                return true;
+            }
+
+            buffer.erase(0, start);
+            start = 0;
+            char chunk[65536];
+            ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+            if (received <= 0) return false;
+            buffer.append(chunk, static_cast<size_t>(received));
+        }
+    }
+
+private:
+    int fd;
+    std::string buffer;
+    size_t start = 0;
+};
+
+// Send one request and wait for its status line; false if the connection failed
+static bool roundTrip(int fd, LineReader& reader, const std::string& request, ClientResult& result,
+                      bool record) {
+    Stopwatch timer;
+    if (send(fd, request.data(), request.size(), 0) != static_cast<ssize_t>(request.size())) return false;
+
+    std::string line;
+    while (reader.next(line)) {
+        Json reply = Json::parse(line);
+        if (!reply.has("status")) continue;
+
+        if (reply["status"].asString() != "ok") {
+            if (result.errors++ == 0) result.firstError = reply["message"].asString();
+        }
+        if (record) result.latenciesMs.push_back(timer.elapsedMillis());
+        return true;
+    }
+    return false;
+}
+
+static void runClient(const LoadOptions& options, const std::string& request, int warmup, int count,
+                      ClientResult& result) {
+    int fd = connectTo(options.socketPath);
+    if (fd < 0) {
+        result.errors = count;
+        result.firstError = "could not connect to " + options.socketPath;
+        return;
+    }
+
+    LineReader reader(fd);
+    result.latenciesMs.reserve(count);
+    for (int i = 0; i < warmup + count; i++) {
+        if (!roundTrip(fd, reader, request, result, i >= warmup)) {
+            result.errors += warmup + count - i;
+            if (result.firstError.empty()) result.firstError = "connection closed by server";
+            break;
+        }
+    }
+    close(fd);
+}
+
+#endif
+
+static double percentile(const std::vector<double>& sorted, double fraction) {
+    if (sorted.empty()) return 0.0;
+    size_t index = static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5);
+    return sorted[std::min(index, sorted.size() - 1)];
+}
+
+static bool parseOptions(int argc, char* argv[], LoadOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg.compare(0, 9, "--socket=") == 0) {
+            options.socketPath = arg.substr(9);
+        } else if (arg.compare(0, 9, "--script=") == 0) {
+            options.script = arg.substr(9);
+        } else if (arg.compare(0, 14, "--ingredients=") == 0) {
+            options.ingredients = arg.substr(14);
+        } else if (arg.compare(0, 14, "--connections=") == 0) {
+            options.connections = std::max(1, std::atoi(arg.c_str() + 14));
+        } else if (arg.compare(0, 11, "--requests=") == 0) {
+            options.requests = std::max(1, std::atoi(arg.c_str() + 11));
+        } else if (arg.compare(0, 9, "--warmup=") == 0) {
+            options.warmup = std::max(0, std::atoi(arg.c_str() + 9));
+        } else {
+            return false;
+        }
+    }
+    return !options.socketPath.empty() && !options.script.empty();
+}
+
+int main(int argc, char* argv[]) {
+    LoadOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        std::cout << "Usage: cook_load --socket=path --script=name [--connections=N] [--requests=N]"
+                  << " [--warmup=N] [--ingredients=json]" << std::endl;
+        return 1;
+    }
+
+#ifdef _WIN32
+    std::cerr << "cook_load needs Unix domain sockets" << std::endl;
+    return 1;
+#else
+    Json request = Json::object();
+    request["script"] = options.script;
+    try {
+        request["ingredients"] = Json::parse(options.ingredients);
+    } catch (const std::exception& e) {
+        std::cerr << "--ingredients: " << e.what() << std::endl;
+        return 1;
+    }
+    std::string line = request.dump() + "\n";
+
+    // Split the requests evenly across the connections
+    std::vector<ClientResult> results(options.connections);
+    std::vector<std::thread> clients;
+    Stopwatch wall;
+    for (int i = 0; i < options.connections; i++) {
+        int count = options.requests / options.connections + (i < options.requests % options.connections ? 1 : 0);
+        int warmup = options.warmup / options.connections;
+        clients.emplace_back(runClient, std::cref(options), std::cref(line), warmup, count, std::ref(results[i]));
+    }
+    for (auto& client : clients) {
+        client.join();
+    }
+    double elapsedMs = wall.elapsedMillis();
+
+    std::vector<double> latencies;
+    int errors = 0;
+    std::string firstError;
+    for (const auto& result : results) {
+        latencies.insert(latencies.end(), result.latenciesMs.begin(), result.latenciesMs.end());
+        errors += result.errors;
+        if (firstError.empty()) firstError = result.firstError;
+    }
+    std::sort(latencies.begin(), latencies.end());
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "requests     " << latencies.size() << " over " << options.connections
+              << (options.connections == 1 ? " connection" : " connections") << "\n"
+              << "throughput   " << std::setprecision(0) << latencies.size() / (elapsedMs / 1000.0)
+              << " requests/s\n" << std::setprecision(3)
+              << "p50          " << percentile(latencies, 0.50) << " ms\n"
+              << "p90          " << percentile(latencies, 0.90) << " ms\n"
+              << "p99          " << percentile(latencies, 0.99) << " ms\n"
+              << "max          " << (latencies.empty() ? 0.0 : latencies.back()) << " ms" << std::endl;
+
+    if (errors > 0) {
+        std::cerr << errors << (errors == 1 ? " request failed: " : " requests failed, first: ")
+                  << firstError << std::endl;
+        return 1;
+    }
+    return 0;
+#endif
+}
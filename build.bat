@@ -5,7 +5,7 @@ REM Create bin directory if it doesn't exist
 if not exist bin mkdir bin
 
 REM Compile source files
-g++ -std=c++14 -I include -o bin/cook.exe src/main.cpp src/lexer.cpp src/parser.cpp src/ast.cpp src/interpreter.cpp
+g++ -std=c++17 -pthread -I include -o bin/cook.exe src/main.cpp src/lexer.cpp src/parser.cpp src/ast.cpp src/interpreter.cpp src/module.cpp src/serializer.cpp src/profiler.cpp src/stats.cpp src/region.cpp src/files.cpp src/json.cpp src/document.cpp src/language_server.cpp src/symbols.cpp src/thread_pool.cpp src/symbol_index.cpp src/server.cpp src/snapshot.cpp src/records.cpp src/pipeline.cpp src/transpiler.cpp src/pantry.cpp src/watch.cpp
 
 if %ERRORLEVEL% EQU 0 (
     echo Build successful! Executable created at bin/cook.exe
@@ -1,6 +1,7 @@
 #ifndef COOK_AST_H
 #define COOK_AST_H
 
+#include <cstdint>
 #include <string>
 #include <vector>
 #include <memory>
@@ -14,7 +15,16 @@ class Statement;
 // Base AST node
 class ASTNode {
 public:
+    // Source location of the token that starts the node (0 when unknown)
+    int line = 0;
+    int column = 0;
+
     virtual ~ASTNode() = default;
+
+    void setLocation(int line, int column) {
+        this->line = line;
+        this->column = column;
+    }
 };
 
 // Program - the root of our AST
@@ -30,21 +40,32 @@ class Expression : public ASTNode {
 public:
     virtual ~Expression() = default;
     virtual Expression* clone() const = 0;
+
+protected:
+    template <typename T>
+    T* withLocation(T* copy) const {
+        copy->setLocation(line, column);
+        return copy;
+    }
 };
 
 // Literal expression (numbers, strings)
 class LiteralExpr : public Expression {
 public:
-    enum class Type { NUMBER, STRING };
+    enum class Type { NUMBER, STRING, INTEGER };
 
     Type type;
     std::string value;
 
-    LiteralExpr(Type type, const std::string& value)
-        : type(type), value(value) {}
+    // Numeric value, converted once from the source text. An integer literal
+    // too large for 64 bits becomes a NUMBER.
+    double number = 0.0;
+    int64_t integer = 0;
+
+    LiteralExpr(Type type, const std::string& value);
 
     Expression* clone() const override {
-        return new LiteralExpr(type, value);
+        return withLocation(new LiteralExpr(type, value));
     }
 };
 
@@ -56,14 +77,33 @@ public:
     VariableExpr(const std::string& name) : name(name) {}
 
     Expression* clone() const override {
-        return new VariableExpr(name);
+        return withLocation(new VariableExpr(name));
     }
 };
 
-// Binary expression (a + b, etc.)
+// Unary expression (-a, !a)
+class UnaryExpr : public Expression {
+public:
+    enum class Operator { NEGATE, NOT };
+
+    Operator op;
+    std::unique_ptr<Expression> operand;
+
+    UnaryExpr(Operator op, std::unique_ptr<Expression> operand)
+        : op(op), operand(std::move(operand)) {}
+
+    Expression* clone() const override {
+        return withLocation(new UnaryExpr(op, std::unique_ptr<Expression>(operand->clone())));
+    }
+};
+
+// Binary expression (a + b, a < b, etc.)
 class BinaryExpr : public Expression {
 public:
-    enum class Operator { ADD, SUBTRACT, MULTIPLY, DIVIDE };
+    enum class Operator {
+        ADD, SUBTRACT, MULTIPLY, DIVIDE,
+        EQUAL, NOT_EQUAL, LESS, LESS_EQUAL, GREATER, GREATER_EQUAL
+    };
 
     Operator op;
     std::unique_ptr<Expression> left;
@@ -73,11 +113,11 @@ public:
         : op(op), left(std::move(left)), right(std::move(right)) {}
 
     Expression* clone() const override {
-        return new BinaryExpr(
+        return withLocation(new BinaryExpr(
             op,
             std::unique_ptr<Expression>(left->clone()),
             std::unique_ptr<Expression>(right->clone())
-        );
+        ));
     }
 };
 
@@ -91,10 +131,10 @@ public:
         : name(name), value(std::move(value)) {}
 
     Expression* clone() const override {
-        return new AssignExpr(
+        return withLocation(new AssignExpr(
             name,
             std::unique_ptr<Expression>(value->clone())
-        );
+        ));
     }
 };
 
@@ -112,7 +152,7 @@ public:
         for (const auto& arg : arguments) {
             argsCopy.push_back(std::unique_ptr<Expression>(arg->clone()));
         }
-        return new CallExpr(callee, std::move(argsCopy));
+        return withLocation(new CallExpr(callee, std::move(argsCopy)));
     }
 };
 
@@ -162,6 +202,14 @@ public:
         : expression(std::move(expression)) {}
 };
 
+// Module import statement (cookbook)
+class CookbookStmt : public Statement {
+public:
+    std::string path;
+
+    CookbookStmt(const std::string& path) : path(path) {}
+};
+
 } // namespace cook
 
 #endif // COOK_AST_H
@@ -0,0 +1,146 @@
+#ifndef COOK_BOUNDED_QUEUE_H
+#define COOK_BOUNDED_QUEUE_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace cook {
+
+// Fixed-capacity queue between one producer thread and one consumer thread.
+//
+// push() and pop() take no locks while the queue has room and items: each
+// side owns one index and publishes it for the other to read. A side that
+// finds the queue full or empty yields a few times, then sleeps on a
+// condition variable until the other side moves its index and wakes it.
+//
+// The producer calls close() after its last item; pop() then returns false
+// once the queue is drained. Either side may cancel(), after which push() and
+// pop() return false at once, so a stage that stops early releases the stage
+// blocked on it.
+template <typename T>
+class BoundedQueue {
+public:
+    // 'capacity' is rounded up to a power of two
+    explicit BoundedQueue(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    ~BoundedQueue() {
+        size_t tail = tailIndex.load(std::memory_order_relaxed);
+        for (size_t i = headIndex.load(std::memory_order_relaxed); i != tail; i++) {
+            item(i)->~T();
+        }
+    }
+
+    BoundedQueue(const BoundedQueue&) = delete;
+    BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+    // Producer side; false if the queue was cancelled
+    bool push(T&& value) {
+        size_t tail = tailIndex.load(std::memory_order_relaxed);
+        bool room = waitUntil(producerWaiting, notFull, [&] { return tail - headIndex.load() != slots.size(); });
+        if (!room) return false;
+
+        new (&slots[tail & mask]) T(std::move(value));
+        tailIndex.store(tail + 1);
+        wake(consumerWaiting, notEmpty);
+        return true;
+    }
+
+    // Consumer side; false once the queue is closed and empty, or cancelled
+    bool pop(T& value) {
+        size_t head = headIndex.load(std::memory_order_relaxed);
+        bool ready = waitUntil(consumerWaiting, notEmpty, [&] { return head != tailIndex.load() || closed.load(); });
+        // Check the tail again: items pushed before close() still count
+        if (!ready || head == tailIndex.load()) return false;
+
+        T* slot = item(head);
+        value = std::move(*slot);
+        slot->~T();
+        headIndex.store(head + 1);
+        wake(producerWaiting, notFull);
+        return true;
+    }
+
+    void close() {
+        closed.store(true);
+        wakeAll();
+    }
+
+    void cancel() {
+        cancelled.store(true);
+        wakeAll();
+    }
+
+private:
+    using Slot = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+    std::vector<Slot> slots;
+    size_t mask;
+
+    // Next item to pop, written by the consumer, and next slot to fill,
+    // written by the producer; kept on separate cache lines
+    alignas(64) std::atomic<size_t> headIndex{0};
+    alignas(64) std::atomic<size_t> tailIndex{0};
+    std::atomic<bool> closed{false};
+    std::atomic<bool> cancelled{false};
+
+    // Yields before sleeping; enough to ride out a short stall of the other
+    // side without a system call
+    static const int SPIN_LIMIT = 64;
+
+    // A side sets its flag while asleep, so the other side only takes the
+    // mutex when there is someone to wake. Index stores and flag loads are
+    // sequentially consistent: a side either sees the new index before
+    // sleeping or the other side sees its flag.
+    std::mutex mutex;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    std::atomic<bool> consumerWaiting{false};
+    std::atomic<bool> producerWaiting{false};
+
+    T* item(size_t index) { return reinterpret_cast<T*>(&slots[index & mask]); }
+
+    // Wait until 'ready' holds; false if the queue was cancelled first
+    template <typename Ready>
+    bool waitUntil(std::atomic<bool>& waiting, std::condition_variable& condition, Ready ready) {
+        for (int spin = 0; !ready(); spin++) {
+            if (cancelled.load()) return false;
+            if (spin < SPIN_LIMIT) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(mutex);
+            waiting.store(true);
+            condition.wait(lock, [&] { return ready() || cancelled.load(); });
+            waiting.store(false);
+        }
+        return true;
+    }
+
+    void wake(std::atomic<bool>& waiting, std::condition_variable& condition) {
+        if (!waiting.load()) return;
+        std::lock_guard<std::mutex> lock(mutex);
+        condition.notify_one();
+    }
+
+    void wakeAll() {
+        std::lock_guard<std::mutex> lock(mutex);
+        notEmpty.notify_all();
+        notFull.notify_all();
+    }
+};
+
+} // namespace cook
+
+#endif // COOK_BOUNDED_QUEUE_H
@@ -0,0 +1,113 @@
+#ifndef COOK_DOCUMENT_H
+#define COOK_DOCUMENT_H
+
+#include "lexer.h"
+#include "parser.h"
+#include "symbols.h"
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace cook {
+
+// Zero-based line and character offset, as used by editors
+struct TextPosition {
+    int line;
+    int character;
+};
+
+// A definition site in current document coordinates (one-based)
+struct SymbolLocation {
+    Symbol::Kind kind;
+    int line;
+    int column;
+};
+
+// An open source file kept parsed for editor queries.
+//
+// The text is split into top-level statements ("segments"): each segment ends
+// after a ';' or '}' at brace depth zero. An edit re-lexes and re-parses only
+// the segments it touches and keeps the rest, including their symbols, as they
+// are. Positions inside a segment are stored as they were when it was lexed
+// and translated on the way out, so an edit above a segment costs nothing.
+// Characters are counted in bytes.
+class Document {
+public:
+    explicit Document(std::string text);
+
+    Document(const Document&) = delete;
+    Document& operator=(const Document&) = delete;
+
+    const std::string& getText() const { return text; }
+
+    // Text of a zero-based line without its line break ("" past the end)
+    std::string_view line(int index) const;
+
+    // Replace the whole text
+    void replace(std::string newText);
+
+    // Replace the text between two positions
+    void edit(TextPosition from, TextPosition to, const std::string& replacement);
+
+    // Syntax errors in current coordinates
+    std::vector<Diagnostic> diagnostics() const;
+
+    // Names visible at a position: recipes and ingredients defined at the top
+    // level, plus the parameters and ingredients of the enclosing recipe
+    std::vector<Symbol> visibleSymbols(TextPosition position) const;
+
+    // Definitions of the name under the cursor; 'reference' receives the name
+    // that was found there
+    std::vector<SymbolLocation> definitions(TextPosition position, Reference& reference) const;
+
+    // Cookbook paths imported at the top level
+    std::vector<std::string> cookbooks() const;
+
+    size_t segmentCount() const { return segments.size(); }
+
+    // Number of segments rebuilt by the most recent edit
+    size_t lastRebuiltSegments() const { return rebuilt; }
+
+private:
+    struct Segment {
+        size_t start;
+        int lexedLine;
+        int lexedColumn;
+        std::vector<std::unique_ptr<Statement>> statements;
+        std::vector<Diagnostic> diagnostics;
+        std::vector<Symbol> globals;
+        std::vector<Symbol> locals;
+        std::vector<Reference> references;
+        std::vector<std::string> cookbooks;
+        bool recipe = false;
+    };
+
+    std::string text;
+    std::vector<size_t> lineStarts;
+    std::vector<std::unique_ptr<Segment>> segments;
+    size_t rebuilt = 0;
+
+    // Top-level name -> segments that define it
+    std::unordered_map<std::string, std::vector<const Segment*>> index;
+
+    size_t offsetOf(TextPosition position) const;
+    TextPosition positionOf(size_t offset) const;
+    size_t segmentAt(size_t offset) const;
+
+    void updateLineStarts(size_t start, size_t end, const std::string& replacement);
+    void rebuild(size_t first, size_t last);
+    bool lexRegion(size_t start, size_t end, std::vector<std::unique_ptr<Segment>>& built) const;
+    std::unique_ptr<Segment> buildSegment(size_t start, std::vector<Token> tokens) const;
+    void addToIndex(const Segment* segment);
+    void removeFromIndex(const Segment* segment);
+
+    // Translate between lexed and current one-based coordinates
+    void toCurrent(const Segment& segment, int& line, int& column) const;
+    void toLexed(const Segment& segment, int& line, int& column) const;
+};
+
+} // namespace cook
+
+#endif // COOK_DOCUMENT_H
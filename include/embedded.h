@@ -0,0 +1,759 @@
+#ifndef COOK_EMBEDDED_H
+#define COOK_EMBEDDED_H
+
+#include "ast.h"
+#include "lexer.h"
+#include "runtime.h"
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace cook {
+namespace embedded {
+
+// Cook scripts compiled into a C++ program (header only).
+//
+//     struct Recipes {
+//         static constexpr std::string_view source = R"(
+//             ingredient servings = 4;
+//             recipe scale(eggs, people) {
+//                 taste "Eggs: " + eggs * people / servings;
+//             }
+//         )";
+//     };
+//     using Kitchen = cook::embedded::Script<Recipes>;
+//
+//     Kitchen kitchen(std::cout);
+//     kitchen.run();                                  // Recipe 'scale' defined ...
+//     kitchen.call<Kitchen::recipe("scale")>(3, 8);   // Eggs: 6
+//
+// The source is lexed and parsed by constexpr ports of Lexer and Parser while
+// the program is compiled: a syntax error, a call to a recipe that does not
+// exist or a call with the wrong number of arguments stops the build, and the
+// compiler's notes show the message and its line and column. Each node of the
+// parsed tree becomes a template instantiation that the compiler inlines, and
+// ingredients are resolved to fixed slots, so nothing is parsed or looked up
+// by name at startup.
+//
+// Values keep Cook's dynamic types, and output and runtime errors match the
+// interpreter's. Cookbooks, recipes declared inside recipes and recipes
+// declared twice are compile errors.
+
+// Reports an error in the script. Reached while the script is compiled, a
+// throw is not a constant expression, so the build stops with the message in
+// the compiler's notes; reached at runtime it throws.
+constexpr void fail(const char* message, int line, int column) {
+#if defined(__GNUC__) || defined(__clang__)
+    if (__builtin_is_constant_evaluated()) {
+        // A subscript past the end is not a constant expression either, and
+        // the compiler's error quotes it: the line of the script
+        const char atLine[1] = {};
+        if (atLine[line] == 0) throw std::invalid_argument(message);
+    }
+#endif
+    if (line >= 0 && column >= 0) throw std::invalid_argument(message);
+}
+
+struct Token {
+    TokenType type = TokenType::EOF_TOKEN;
+    std::string_view text;  // string literals without their quotes
+    int line = 1;
+    int column = 1;
+};
+
+// Lexer over a string_view, with the same rules as cook::Lexer
+class Lexer {
+public:
+    constexpr explicit Lexer(std::string_view source) : source(source) {}
+
+    constexpr Token next() {
+        while (true) {
+            skipWhitespace();
+            if (position >= source.size()) return Token{TokenType::EOF_TOKEN, {}, line, column};
+
+            char c = advance();
+            switch (c) {
+                case '(': return make(TokenType::LPAREN, 1);
+                case ')': return make(TokenType::RPAREN, 1);
+                case '{': return make(TokenType::LBRACE, 1);
+                case '}': return make(TokenType::RBRACE, 1);
+                case ',': return make(TokenType::COMMA, 1);
+                case ';': return make(TokenType::SEMICOLON, 1);
+                case '+': return make(TokenType::PLUS, 1);
+                case '-': return make(TokenType::MINUS, 1);
+                case '*': return make(TokenType::MULTIPLY, 1);
+                case '/':
+                    if (match('/')) {
+                        while (position < source.size() && source[position] != '\n') advance();
+                        continue;
+                    }
+                    return make(TokenType::DIVIDE, 1);
+                case '=':
+                    return match('=') ? make(TokenType::EQUAL_EQUAL, 2) : make(TokenType::ASSIGN, 1);
+                case '!':
+                    return match('=') ? make(TokenType::BANG_EQUAL, 2) : make(TokenType::BANG, 1);
+                case '<':
+                    return match('=') ? make(TokenType::LESS_EQUAL, 2) : make(TokenType::LESS, 1);
+                case '>':
+                    return match('=') ? make(TokenType::GREATER_EQUAL, 2) : make(TokenType::GREATER, 1);
+                case '"': return string();
+                default:
+                    if (isDigit(c)) return number();
+                    if (isAlpha(c)) return identifier();
+                    return make(TokenType::UNKNOWN, 1);
+            }
+        }
+    }
+
+private:
+    std::string_view source;
+    size_t position = 0;
+    int line = 1;
+    int column = 1;
+
+    static constexpr bool isDigit(char c) { return c >= '0' && c <= '9'; }
+    static constexpr bool isAlpha(char c) {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_';
+    }
+
+    constexpr char peek() const { return position < source.size() ? source[position] : '\0'; }
+
+    constexpr char advance() {
+        column++;
+        return source[position++];
+    }
+
+    constexpr bool match(char expected) {
+        if (peek() != expected || position >= source.size()) return false;
+        advance();
+        return true;
+    }
+
+    // The last 'length' characters
+    constexpr Token make(TokenType type, int length) {
+        return Token{type, source.substr(position - length, length), line, column - length};
+    }
+
+    constexpr void skipWhitespace() {
+        while (position < source.size()) {
+            char c = source[position];
+            if (c == '\n') {
+                line++;
+                column = 0;  // advance() moves past the newline to column 1
+            } else if (c != ' ' && c != '\r' && c != '\t') {
+                return;
+            }
+            advance();
+        }
+    }
+
+    // Strings have no escapes; an unterminated one runs to the end
+    constexpr Token string() {
+        Token token{TokenType::STRING, {}, line, column - 1};
+        size_t start = position;
+        while (position < source.size() && source[position] != '"') {
+            if (source[position] == '\n') {
+                line++;
+                column = 0;
+            }
+            advance();
+        }
+        token.text = source.substr(start, position - start);
+        if (position < source.size()) advance();
+        return token;
+    }
+
+    constexpr Token number() {
+        size_t start = position - 1;
+        int startColumn = column - 1;
+        while (isDigit(peek())) advance();
+
+        TokenType type = TokenType::INTEGER;
+        if (peek() == '.' && position + 1 < source.size() && isDigit(source[position + 1])) {
+            advance();
+            type = TokenType::NUMBER;
+            while (isDigit(peek())) advance();
+        }
+        return Token{type, source.substr(start, position - start), line, startColumn};
+    }
+
+    constexpr Token identifier() {
+        size_t start = position - 1;
+        int startColumn = column - 1;
+        while (isAlpha(peek()) || isDigit(peek())) advance();
+
+        std::string_view text = source.substr(start, position - start);
+        TokenType type = TokenType::IDENTIFIER;
+        if (text == "ingredient") type = TokenType::INGREDIENT;
+        else if (text == "recipe") type = TokenType::RECIPE;
+        else if (text == "cookbook") type = TokenType::COOKBOOK;
+        else if (text == "cook") type = TokenType::COOK;
+        else if (text == "taste") type = TokenType::TASTE;
+        return Token{type, text, line, startColumn};
+    }
+};
+
+enum class NodeKind {
+    // Expressions
+    INTEGER, NUMBER, STRING, VARIABLE, UNARY, BINARY, ASSIGN, CALL,
+    // Statements
+    EXPRESSION, INGREDIENT, TASTE, RECIPE, PARAMETER
+};
+
+// A node of the parsed script. Children are node indices, -1 when absent;
+// statements, parameters and arguments are chained through 'next'.
+struct Node {
+    NodeKind kind = NodeKind::INTEGER;
+    int op = 0;          // UnaryExpr::Operator or BinaryExpr::Operator
+    int first = -1;      // operand, value, first argument or first parameter
+    int second = -1;     // right operand or first statement of a recipe body
+    int next = -1;
+    int slot = -1;       // ingredient slot; a call's recipe node; a recipe's number
+    int count = 0;       // arguments or parameters
+    bool negative = false;
+    bool exact = true;   // 'number' is the correctly rounded value of the literal
+    int64_t integer = 0;
+    double number = 0.0;
+    std::string_view text;  // literal digits or text, or a recipe name
+    int line = 0;
+    int column = 0;
+};
+
+// One node per token is enough, so N is bounded by the length of the source
+template <size_t N>
+struct Tree {
+    std::array<Node, N> nodes{};
+    std::array<std::string_view, N> names{};  // ingredient name of each slot
+    int nodeCount = 0;
+    int nameCount = 0;
+    int recipeCount = 0;
+    int first = -1;  // first top-level statement
+};
+
+template <size_t N>
+class Parser {
+public:
+    constexpr explicit Parser(std::string_view source) : lexer(source), current(lexer.next()) {}
+
+    constexpr Tree<N> parse() {
+        int last = -1;
+        while (current.type != TokenType::EOF_TOKEN) {
+            last = append(tree.first, last, declaration(true));
+        }
+
+        for (int i = 0; i < tree.nodeCount; i++) {
+            Node& node = tree.nodes[i];
+            if (node.kind == NodeKind::INTEGER || node.kind == NodeKind::NUMBER) finishLiteral(node);
+            if (node.kind == NodeKind::CALL) resolveCall(node);
+        }
+        return tree;
+    }
+
+private:
+    enum Precedence {
+        PREC_NONE,
+        PREC_ASSIGNMENT,
+        PREC_EQUALITY,
+        PREC_COMPARISON,
+        PREC_TERM,
+        PREC_FACTOR,
+        PREC_UNARY
+    };
+
+    Lexer lexer;
+    Token current;
+    Token previous;
+    Tree<N> tree;
+
+    constexpr void advance() {
+        previous = current;
+        if (current.type != TokenType::EOF_TOKEN) current = lexer.next();
+    }
+
+    constexpr bool check(TokenType type) const {
+        return current.type != TokenType::EOF_TOKEN && current.type == type;
+    }
+
+    constexpr bool match(TokenType type) {
+        if (!check(type)) return false;
+        advance();
+        return true;
+    }
+
+    constexpr void consume(TokenType type, const char* message) {
+        if (!match(type)) fail(message, current.line, current.column);
+    }
+
+    constexpr int add(NodeKind kind, const Token& at) {
+        Node& node = tree.nodes[tree.nodeCount];
+        node.kind = kind;
+        node.line = at.line;
+        node.column = at.column;
+        return tree.nodeCount++;
+    }
+
+    constexpr int append(int& head, int last, int node) {
+        if (last < 0) head = node;
+        else tree.nodes[last].next = node;
+        return node;
+    }
+
+    constexpr int slotOf(std::string_view name) {
+        for (int i = 0; i < tree.nameCount; i++) {
+            if (tree.names[i] == name) return i;
+        }
+        tree.names[tree.nameCount] = name;
+        return tree.nameCount++;
+    }
+
+    constexpr int declaration(bool topLevel) {
+        Token keyword = current;
+
+        if (match(TokenType::INGREDIENT)) {
+            consume(TokenType::IDENTIFIER, "Expect ingredient name");
+            int node = add(NodeKind::INGREDIENT, keyword);
+            tree.nodes[node].slot = slotOf(previous.text);
+            if (match(TokenType::ASSIGN)) tree.nodes[node].first = expression();
+            consume(TokenType::SEMICOLON, "Expect ';' after ingredient declaration");
+            return node;
+        }
+
+        if (match(TokenType::RECIPE)) {
+            if (!topLevel) fail("Recipes inside recipes are not supported in embedded scripts",
+                                keyword.line, keyword.column);
+            consume(TokenType::IDENTIFIER, "Expect recipe name");
+            for (int i = 0; i < tree.nodeCount; i++) {
+                if (tree.nodes[i].kind == NodeKind::RECIPE && tree.nodes[i].text == previous.text) {
+                    fail("Recipe already declared", previous.line, previous.column);
+                }
+            }
+            int node = add(NodeKind::RECIPE, keyword);
+            tree.nodes[node].text = previous.text;
+            tree.nodes[node].slot = tree.recipeCount++;
+
+            consume(TokenType::LPAREN, "Expect '(' after recipe name");
+            int last = -1;
+            if (!check(TokenType::RPAREN)) {
+                do {
+                    consume(TokenType::IDENTIFIER, "Expect parameter name");
+                    int parameter = add(NodeKind::PARAMETER, previous);
+                    tree.nodes[parameter].slot = slotOf(previous.text);
+                    last = append(tree.nodes[node].first, last, parameter);
+                    tree.nodes[node].count++;
+                } while (match(TokenType::COMMA));
+            }
+            consume(TokenType::RPAREN, "Expect ')' after parameters");
+            consume(TokenType::LBRACE, "Expect '{' before recipe body");
+
+            last = -1;
+            while (!check(TokenType::RBRACE) && current.type != TokenType::EOF_TOKEN) {
+                last = append(tree.nodes[node].second, last, declaration(false));
+            }
+            consume(TokenType::RBRACE, "Expect '}' after recipe body");
+            return node;
+        }
+
+        if (match(TokenType::COOKBOOK)) {
+            fail("Cookbooks are not supported in embedded scripts", keyword.line, keyword.column);
+        }
+
+        if (match(TokenType::TASTE)) {
+            int node = add(NodeKind::TASTE, keyword);
+            tree.nodes[node].first = expression();
+            consume(TokenType::SEMICOLON, "Expect ';' after taste statement");
+            return node;
+        }
+
+        if (match(TokenType::COOK)) {
+            Token start = current;
+            int node = add(NodeKind::EXPRESSION, keyword);
+            int call = expression();
+            if (tree.nodes[call].kind != NodeKind::CALL) {
+                fail("Expect recipe call after 'cook'", start.line, start.column);
+            }
+            tree.nodes[node].first = call;
+            consume(TokenType::SEMICOLON, "Expect ';' after cook statement");
+            return node;
+        }
+
+        int node = add(NodeKind::EXPRESSION, keyword);
+        tree.nodes[node].first = expression();
+        consume(TokenType::SEMICOLON, "Expect ';' after expression");
+        return node;
+    }
+
+    constexpr int expression() {
+        return parsePrecedence(PREC_ASSIGNMENT);
+    }
+
+    static constexpr Precedence infix(TokenType type, BinaryExpr::Operator& op) {
+        switch (type) {
+            case TokenType::EQUAL_EQUAL: op = BinaryExpr::Operator::EQUAL; return PREC_EQUALITY;
+            case TokenType::BANG_EQUAL: op = BinaryExpr::Operator::NOT_EQUAL; return PREC_EQUALITY;
+            case TokenType::LESS: op = BinaryExpr::Operator::LESS; return PREC_COMPARISON;
+            case TokenType::LESS_EQUAL: op = BinaryExpr::Operator::LESS_EQUAL; return PREC_COMPARISON;
+            case TokenType::GREATER: op = BinaryExpr::Operator::GREATER; return PREC_COMPARISON;
+            case TokenType::GREATER_EQUAL: op = BinaryExpr::Operator::GREATER_EQUAL; return PREC_COMPARISON;
+            case TokenType::PLUS: op = BinaryExpr::Operator::ADD; return PREC_TERM;
+            case TokenType::MINUS: op = BinaryExpr::Operator::SUBTRACT; return PREC_TERM;
+            case TokenType::MULTIPLY: op = BinaryExpr::Operator::MULTIPLY; return PREC_FACTOR;
+            case TokenType::DIVIDE: op = BinaryExpr::Operator::DIVIDE; return PREC_FACTOR;
+            default: return PREC_NONE;
+        }
+    }
+
+    constexpr int parsePrecedence(int minimum) {
+        Token start = current;
+        int expr = unary();
+
+        while (true) {
+            // Assignment is right-associative and needs a variable on the left
+            if (minimum <= PREC_ASSIGNMENT && check(TokenType::ASSIGN)) {
+                Token equals = current;
+                advance();
+                int value = parsePrecedence(PREC_ASSIGNMENT);
+                if (tree.nodes[expr].kind != NodeKind::VARIABLE) {
+                    fail("Invalid assignment target", equals.line, equals.column);
+                }
+                int node = add(NodeKind::ASSIGN, start);
+                tree.nodes[node].slot = tree.nodes[expr].slot;
+                tree.nodes[node].first = value;
+                return node;
+            }
+
+            BinaryExpr::Operator op = BinaryExpr::Operator::ADD;
+            Precedence precedence = infix(current.type, op);
+            if (precedence == PREC_NONE || precedence < minimum) break;
+
+            Token opToken = current;
+            advance();
+            int right = parsePrecedence(precedence + 1);
+
+            int node = add(NodeKind::BINARY, opToken);
+            tree.nodes[node].op = static_cast<int>(op);
+            tree.nodes[node].first = expr;
+            tree.nodes[node].second = right;
+            expr = node;
+        }
+
+        return expr;
+    }
+
+    constexpr int unary() {
+        if (!check(TokenType::MINUS) && !check(TokenType::BANG)) return primary();
+
+        Token opToken = current;
+        advance();
+        int operand = unary();
+
+        // Negative number literals are folded into the literal
+        Node& literal = tree.nodes[operand];
+        if (opToken.type == TokenType::MINUS &&
+            (literal.kind == NodeKind::INTEGER || literal.kind == NodeKind::NUMBER)) {
+            literal.negative = !literal.negative;
+            literal.line = opToken.line;
+            literal.column = opToken.column;
+            return operand;
+        }
+
+        int node = add(NodeKind::UNARY, opToken);
+        tree.nodes[node].op = static_cast<int>(opToken.type == TokenType::MINUS ? UnaryExpr::Operator::NEGATE
+                                                                                : UnaryExpr::Operator::NOT);
+        tree.nodes[node].first = operand;
+        return node;
+    }
+
+    constexpr int primary() {
+        Token token = current;
+
+        if (match(TokenType::NUMBER) || match(TokenType::INTEGER) || match(TokenType::STRING)) {
+            int node = add(token.type == TokenType::NUMBER ? NodeKind::NUMBER
+                         : token.type == TokenType::INTEGER ? NodeKind::INTEGER
+                         : NodeKind::STRING, token);
+            tree.nodes[node].text = token.text;
+
+            // An integer too large for int64 is a number before any '-' is
+            // folded into it, as in the interpreter
+            if (token.type == TokenType::INTEGER) finishLiteral(tree.nodes[node]);
+            return node;
+        }
+
+        if (match(TokenType::IDENTIFIER)) {
+            if (match(TokenType::LPAREN)) {
+                int node = add(NodeKind::CALL, token);
+                tree.nodes[node].text = token.text;
+                int last = -1;
+                if (!check(TokenType::RPAREN)) {
+                    do {
+                        last = append(tree.nodes[node].first, last, expression());
+                        tree.nodes[node].count++;
+                    } while (match(TokenType::COMMA));
+                }
+                consume(TokenType::RPAREN, "Expect ')' after arguments");
+                return node;
+            }
+
+            int node = add(NodeKind::VARIABLE, token);
+            tree.nodes[node].slot = slotOf(token.text);
+            return node;
+        }
+
+        if (match(TokenType::LPAREN)) {
+            int expr = expression();
+            consume(TokenType::RPAREN, "Expect ')' after expression");
+            return expr;
+        }
+
+        if (token.type == TokenType::UNKNOWN) fail("Unexpected character", token.line, token.column);
+        fail("Expect expression", token.line, token.column);
+    }
+
+    // Integers that overflow become numbers, as with strtoll's ERANGE. Numbers
+    // whose digits and power of ten are both exact doubles are divided here,
+    // which rounds correctly; any other is left to strtod at runtime.
+    static constexpr void finishLiteral(Node& node) {
+        uint64_t digits = 0;
+        int scale = 0;
+        bool overflow = false;
+        bool fraction = false;
+        for (char c : node.text) {
+            if (c == '.') {
+                fraction = true;
+                continue;
+            }
+            if (digits > (UINT64_MAX - 9) / 10) overflow = true;
+            digits = digits * 10 + static_cast<uint64_t>(c - '0');
+            if (fraction) scale++;
+        }
+
+        if (node.kind == NodeKind::INTEGER) {
+            uint64_t limit = node.negative ? uint64_t(1) << 63 : (uint64_t(1) << 63) - 1;
+            if (!overflow && digits <= limit) {
+                node.integer = node.negative ? static_cast<int64_t>(0 - digits) : static_cast<int64_t>(digits);
+                return;
+            }
+            node.kind = NodeKind::NUMBER;
+        }
+
+        node.exact = !overflow && digits <= (uint64_t(1) << 53) && scale <= 22;
+        if (node.exact) {
+            double power = 1.0;
+            for (int i = 0; i < scale; i++) power *= 10.0;
+            node.number = static_cast<double>(digits) / power;
+            if (node.negative) node.number = -node.number;
+        }
+    }
+
+    constexpr void resolveCall(Node& call) {
+        for (int i = 0; i < tree.nodeCount; i++) {
+            const Node& recipe = tree.nodes[i];
+            if (recipe.kind != NodeKind::RECIPE || recipe.text != call.text) continue;
+            if (recipe.count != call.count) {
+                fail("Wrong number of arguments for the recipe", call.line, call.column);
+            }
+            call.slot = i;
+            return;
+        }
+        fail("Undefined recipe", call.line, call.column);
+    }
+};
+
+template <size_t N>
+constexpr Tree<N> parse(std::string_view source) {
+    return Parser<N>(source).parse();
+}
+
+// Length of the chain of nodes starting at 'first', and its nodes by position
+template <size_t N>
+constexpr int chainLength(const Tree<N>& tree, int first) {
+    int length = 0;
+    for (int i = first; i >= 0; i = tree.nodes[i].next) length++;
+    return length;
+}
+
+template <size_t N>
+constexpr int chainAt(const Tree<N>& tree, int first, int position) {
+    int i = first;
+    while (position-- > 0) i = tree.nodes[i].next;
+    return i;
+}
+
+using runtime::Value;
+
+namespace detail {
+
+inline double parseNumber(std::string_view digits, bool negative) {
+    std::string text = negative ? "-" : "";
+    text += digits;
+    return std::strtod(text.c_str(), nullptr);
+}
+
+} // namespace detail
+
+// A compiled script. 'Source' has a `static constexpr std::string_view source`.
+template <typename Source>
+class Script {
+public:
+    static constexpr auto tree = parse<Source::source.size() + 2>(Source::source);
+
+    explicit Script(std::ostream& out = std::cout) : out(&out) {}
+
+    // Node of the recipe 'name', for call(); a compile error if there is none
+    static constexpr int recipe(std::string_view name) {
+        for (int i = 0; i < tree.nodeCount; i++) {
+            if (tree.nodes[i].kind == NodeKind::RECIPE && tree.nodes[i].text == name) return i;
+        }
+        fail("Undefined recipe", 0, 0);
+    }
+
+    // Slot of the ingredient 'name', for get(); a compile error if the script
+    // never mentions it
+    static constexpr int ingredient(std::string_view name) {
+        for (int i = 0; i < tree.nameCount; i++) {
+            if (tree.names[i] == name) return i;
+        }
+        fail("Undefined ingredient", 0, 0);
+    }
+
+    // Run the top-level statements
+    void run() {
+        executeList<tree.first>();
+    }
+
+    // Call a recipe from C++, as `cook --for-each` does; like a call in the
+    // script, it fails until the recipe's declaration has run
+    template <int Recipe, typename... Args>
+    void call(Args&&... arguments) {
+        static_assert(Recipe >= 0 && tree.nodes[Recipe].kind == NodeKind::RECIPE,
+                      "not a recipe; use Script::recipe(name)");
+        static_assert(static_cast<int>(sizeof...(Args)) == tree.nodes[Recipe].count,
+                      "wrong number of arguments for the recipe");
+        constexpr Node recipe = tree.nodes[Recipe];
+        if (!defined[recipe.slot]) runtime::undefinedRecipe(recipe.text);
+        std::array<Value, sizeof...(Args)> values{{Value(std::forward<Args>(arguments))...}};
+        invoke<Recipe>(values);
+    }
+
+    template <int Slot>
+    const Value& get() const {
+        constexpr std::string_view name = tree.names[Slot];
+        if (!slots[Slot].isDefined()) runtime::undefinedIngredient(name);
+        return slots[Slot];
+    }
+
+private:
+    std::ostream* out;
+    std::array<Value, tree.nameCount> slots;
+    std::array<bool, tree.recipeCount> defined{};
+
+    template <int First>
+    void executeList() {
+        executeEach<First>(std::make_integer_sequence<int, chainLength(tree, First)>());
+    }
+
+    template <int First, int... K>
+    void executeEach(std::integer_sequence<int, K...>) {
+        (execute<chainAt(tree, First, K)>(), ...);
+    }
+
+    template <int I>
+    void execute() {
+        constexpr Node node = tree.nodes[I];
+
+        if constexpr (node.kind == NodeKind::EXPRESSION) {
+            evaluate<node.first>();
+        } else if constexpr (node.kind == NodeKind::INGREDIENT) {
+            if constexpr (node.first >= 0) slots[node.slot] = evaluate<node.first>();
+            else slots[node.slot] = Value::literal("");
+        } else if constexpr (node.kind == NodeKind::TASTE) {
+            runtime::taste(*out, evaluate<node.first>());
+        } else {
+            static_assert(node.kind == NodeKind::RECIPE, "unexpected statement");
+            defined[node.slot] = true;
+            *out << "Recipe '" << node.text << "' defined with " << node.count << " parameters" << std::endl;
+        }
+    }
+
+    template <int I>
+    Value evaluate() {
+        constexpr Node node = tree.nodes[I];
+
+        if constexpr (node.kind == NodeKind::INTEGER) {
+            return Value(node.integer);
+        } else if constexpr (node.kind == NodeKind::NUMBER) {
+            if constexpr (node.exact) {
+                return Value(node.number);
+            } else {
+                static const double number = detail::parseNumber(node.text, node.negative);
+                return Value(number);
+            }
+        } else if constexpr (node.kind == NodeKind::STRING) {
+            return Value::literal(node.text);
+        } else if constexpr (node.kind == NodeKind::VARIABLE) {
+            return get<node.slot>();
+        } else if constexpr (node.kind == NodeKind::UNARY) {
+            Value operand = evaluate<node.first>();
+            if constexpr (node.op == static_cast<int>(UnaryExpr::Operator::NOT)) {
+                return Value(runtime::logicalNot(operand));
+            } else {
+                return runtime::negate(operand);
+            }
+        } else if constexpr (node.kind == NodeKind::BINARY) {
+            Value left = evaluate<node.first>();
+            Value right = evaluate<node.second>();
+            return runtime::binary<static_cast<runtime::Operator>(node.op)>(left, right);
+        } else if constexpr (node.kind == NodeKind::ASSIGN) {
+            Value value = evaluate<node.first>();
+            constexpr std::string_view name = tree.names[node.slot];
+            if (!slots[node.slot].isDefined()) runtime::undefinedIngredient(name);
+            slots[node.slot] = value;
+            return value;
+        } else {
+            static_assert(node.kind == NodeKind::CALL, "unexpected expression");
+            constexpr Node recipe = tree.nodes[node.slot];
+            if (!defined[recipe.slot]) runtime::undefinedRecipe(node.text);
+            std::array<Value, node.count> arguments =
+                evaluateArguments<node.first>(std::make_integer_sequence<int, node.count>());
+            invoke<node.slot>(arguments);
+            return Value::literal("recipe result");
+        }
+    }
+
+    // Arguments are evaluated left to right, as braced lists guarantee
+    template <int First, int... K>
+    std::array<Value, sizeof...(K)> evaluateArguments(std::integer_sequence<int, K...>) {
+        return std::array<Value, sizeof...(K)>{{evaluate<chainAt(tree, First, K)>()...}};
+    }
+
+    // Run a recipe with every ingredient restored afterwards, as the
+    // interpreter's copy of the environment does
+    template <int Recipe, size_t Count>
+    void invoke(std::array<Value, Count>& arguments) {
+        constexpr Node recipe = tree.nodes[Recipe];
+        auto saved = slots;
+        try {
+            bind<recipe.first>(arguments, std::make_integer_sequence<int, recipe.count>());
+            executeList<recipe.second>();
+        } catch (...) {
+            slots = std::move(saved);
+            throw;
+        }
+        slots = std::move(saved);
+    }
+
+    template <int First, size_t Count, int... K>
+    void bind(std::array<Value, Count>& arguments, std::integer_sequence<int, K...>) {
+        ((slots[tree.nodes[chainAt(tree, First, K)].slot] = std::move(arguments[K])), ...);
+    }
+};
+
+} // namespace embedded
+} // namespace cook
+
+#endif // COOK_EMBEDDED_H
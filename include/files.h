@@ -0,0 +1,60 @@
+#ifndef COOK_FILES_H
+#define COOK_FILES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cook {
+
+// Read a whole file; returns false if it cannot be opened
+bool readWholeFile(const std::string& path, std::string& contents);
+
+bool isDirectory(const std::string& path);
+
+// Size and modification time (nanoseconds where the platform has them);
+// returns false if the file does not exist
+bool fileStatus(const std::string& path, uint64_t& size, uint64_t& modified);
+
+// 64-bit FNV-1a hash of file contents
+uint64_t contentHash(const std::string& data);
+
+// All .cook files below a directory, sorted by path
+std::vector<std::string> findCookFiles(const std::string& root);
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Returns false if the file cannot be opened or mapped
+    bool open(const std::string& path);
+    void close();
+
+    const char* data() const { return bytes; }
+    size_t size() const { return length; }
+
+    // Hint that the file will be read once from front to back
+    void adviseSequential();
+
+    // Drop the pages wholly before 'offset' from memory; they are read from
+    // the file again if touched
+    void release(size_t offset);
+
+private:
+    const char* bytes = nullptr;
+    size_t length = 0;
+#ifdef _WIN32
+    void* file = nullptr;
+    void* mapping = nullptr;
+#endif
+};
+
+} // namespace cook
+
+#endif // COOK_FILES_H
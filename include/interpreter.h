@@ -2,45 +2,166 @@
 #define COOK_INTERPRETER_H
 
 #include "ast.h"
+#include "module.h"
+#include "profiler.h"
+#include "stats.h"
+#include "region.h"
+#include "thread_pool.h"
 #include <unordered_map>
+#include <unordered_set>
 #include <string>
 #include <memory>
+#include <ostream>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 namespace cook {
 
+class AstWriter;
+class AstReader;
+
 // Value class for the interpreter (instead of std::variant)
+//
+// Numbers are either integers or doubles. Arithmetic on two integers stays
+// exact and only produces a double when the result overflows 64 bits or a
+// division has a remainder.
+//
+// Strings are either owned by the value or borrowed: a borrowed string points
+// into the interpreter's region or into the AST and is only valid until the
+// current statement finishes. Values stored in an Environment are always owned.
 class Value {
 public:
     enum class Type { NUMBER, STRING };
 
     Value() : type(Type::STRING), stringValue("") {}
     Value(double val) : type(Type::NUMBER), numberValue(val) {}
-    Value(const std::string& val) : type(Type::STRING), stringValue(val) {}
+    Value(const std::string& val) : type(Type::STRING), stringValue(val) {
+        COOK_STAT_ADD(stringBytesCopied, val.size());
+    }
+
+    static Value integer(int64_t val) {
+        Value value(0.0);
+        value.integral = true;
+        value.integerValue = val;
+        return value;
+    }
+
+    // A string that the value does not own
+    static Value borrowed(const char* data, size_t size) {
+        Value value;
+        value.view = data;
+        value.viewSize = size;
+        return value;
+    }
+
+    Value(const Value& other)
+        : type(other.type), integral(other.integral), numberValue(other.numberValue),
+          integerValue(other.integerValue), stringValue(other.stringValue),
+          view(other.view), viewSize(other.viewSize) {
+        COOK_STAT_ADD(stringBytesCopied, stringValue.size());
+    }
+    Value(Value&& other) = default;
+
+    Value& operator=(const Value& other) {
+        type = other.type;
+        integral = other.integral;
+        numberValue = other.numberValue;
+        integerValue = other.integerValue;
+        stringValue = other.stringValue;
+        view = other.view;
+        viewSize = other.viewSize;
+        COOK_STAT_ADD(stringBytesCopied, stringValue.size());
+        return *this;
+    }
+    Value& operator=(Value&& other) = default;
 
     Type getType() const { return type; }
-    double getNumber() const { return numberValue; }
-    std::string getString() const { return stringValue; }
+    double getNumber() const { return integral ? static_cast<double>(integerValue) : numberValue; }
+    int64_t getInteger() const { return integerValue; }
+    std::string getString() const {
+        COOK_STAT_ADD(stringBytesCopied, stringSize());
+        return std::string(stringData(), stringSize());
+    }
+
+    const char* stringData() const { return view ? view : stringValue.data(); }
+    size_t stringSize() const { return view ? viewSize : stringValue.size(); }
 
     bool isNumber() const { return type == Type::NUMBER; }
+    bool isInteger() const { return integral; }
     bool isString() const { return type == Type::STRING; }
+    bool isBorrowed() const { return view != nullptr; }
+
+    // Copy of this value that owns its string
+    Value promoted() const {
+        if (!view) return *this;
+        return Value(std::string(view, viewSize));
+    }
 
 private:
     Type type;
+    bool integral = false;
     double numberValue = 0.0;
+    int64_t integerValue = 0;
     std::string stringValue;
+    const char* view = nullptr;
+    size_t viewSize = 0;
 };
 
 // Environment to store variables
+//
+// An environment may be layered over a shared one that it only reads: names
+// it does not hold are looked up there, and the first assignment to one of
+// them stores the new value in this environment, leaving the shared one as
+// it was.
 class Environment {
 public:
     Environment() = default;
+    explicit Environment(const Environment* shared) : shared(shared) {}
 
     void define(const std::string& name, const Value& value);
-    Value get(const std::string& name);
+    const Value& get(const std::string& name);
     void assign(const std::string& name, const Value& value);
 
+    // Bytes held by the string values, not counting the shared environment
+    size_t stringBytes() const { return bytes; }
+
+    // Values held by this environment, not those it reads from the shared one
+    const std::unordered_map<std::string, Value>& entries() const { return values; }
+
 private:
     std::unordered_map<std::string, Value> values;
+    const Environment* shared = nullptr;
+    size_t bytes = 0;
+
+    const Value* find(const std::string& name) const;
+};
+
+// Limits for one run of a program; 0 means unlimited
+struct ExecutionBudget {
+    uint64_t maxSteps = 0;        // statements executed plus recipe calls
+    uint64_t maxMillis = 0;       // wall-clock time
+    int maxCallDepth = 0;         // nested recipe calls
+    size_t maxStringBytes = 0;    // live string values, stored and transient
+};
+
+// Thrown when a run exceeds its budget, with the location of the statement
+// or expression being evaluated
+class BudgetExceeded : public std::runtime_error {
+public:
+    enum class Kind { STEPS, TIME, CALL_DEPTH, STRING_BYTES };
+
+    BudgetExceeded(Kind kind, const std::string& message, int line, int column)
+        : std::runtime_error(message), kind(kind), line(line), column(column) {}
+
+    Kind kind;
+    int line;
+    int column;
 };
 
 // Recipe structure to store function definitions
@@ -55,33 +176,265 @@ struct Recipe {
         : parameters(std::move(params)), body(std::move(stmts)) {}
 };
 
+// Conversions between values and the parameters and results of native
+// recipes, chosen by type at compile time
+namespace native {
+
+[[noreturn]] void wrongArgument(const std::string& recipe, size_t position, const char* expected);
+
+// For a native recipe about to build a string of 'bytes' bytes: throws
+// BudgetExceeded if that would pass the calling interpreter's string memory
+// limit, before anything is allocated
+void reserveString(size_t bytes);
+
+// Numbers convert to double and int64_t (whole numbers only), strings to
+// std::string and std::string_view (valid for the call), and a const Value&
+// parameter takes either unconverted. Other parameter types do not compile.
+template <typename T>
+struct Argument;
+
+template <>
+struct Argument<double> {
+    static double from(const Value& value, const std::string& recipe, size_t position) {
+        if (!value.isNumber()) wrongArgument(recipe, position, "a number");
+        return value.getNumber();
+    }
+};
+
+template <>
+struct Argument<int64_t> {
+    static int64_t from(const Value& value, const std::string& recipe, size_t position) {
+        if (value.isInteger()) return value.getInteger();
+        double number = value.getNumber();
+        if (!value.isNumber() || std::floor(number) != number ||
+            !(number >= -9223372036854775808.0 && number < 9223372036854775808.0)) {
+            wrongArgument(recipe, position, "a whole number");
+        }
+        return static_cast<int64_t>(number);
+    }
+};
+
+template <>
+struct Argument<std::string> {
+    static std::string from(const Value& value, const std::string& recipe, size_t position) {
+        if (!value.isString()) wrongArgument(recipe, position, "a string");
+        return value.getString();
+    }
+};
+
+template <>
+struct Argument<std::string_view> {
+    static std::string_view from(const Value& value, const std::string& recipe, size_t position) {
+        if (!value.isString()) wrongArgument(recipe, position, "a string");
+        return std::string_view(value.stringData(), value.stringSize());
+    }
+};
+
+template <>
+struct Argument<Value> {
+    static const Value& from(const Value& value, const std::string&, size_t) { return value; }
+};
+
+// Results may be integers (and bool, as 1 or 0), doubles, strings or values
+template <typename T>
+Value result(T value) {
+    if constexpr (std::is_same<T, Value>::value) {
+        return value;
+    } else if constexpr (std::is_integral<T>::value) {
+        return Value::integer(static_cast<int64_t>(value));
+    } else if constexpr (std::is_floating_point<T>::value) {
+        return Value(static_cast<double>(value));
+    } else {
+        static_assert(std::is_same<T, std::string>::value, "Native recipes return numbers, strings or values");
+        return Value(value);
+    }
+}
+
+// Convert the arguments left to right, then call the function they belong to
+template <typename Result, typename... Args, size_t... I>
+Value invoke(Result (*function)(Args...), const std::string& recipe, const Value* arguments,
+             std::index_sequence<I...>) {
+    std::tuple<decltype(Argument<std::decay_t<Args>>::from(arguments[I], recipe, I + 1))...> converted{
+        Argument<std::decay_t<Args>>::from(arguments[I], recipe, I + 1)...};
+    return result<std::decay_t<Result>>(std::apply(function, std::move(converted)));
+}
+
+template <typename Result, typename... Args>
+Value call(void (*function)(), const std::string& recipe, const Value* arguments) {
+    return invoke(reinterpret_cast<Result (*)(Args...)>(function), recipe, arguments,
+                  std::index_sequence_for<Args...>());
+}
+
+} // namespace native
+
+// A recipe implemented as a C++ function. Its parameter types give the
+// number of arguments and how each is converted, and the call goes straight
+// to the function with the argument values as they were evaluated. Parallel
+// calls may run it on several threads at once.
+class NativeRecipe {
+public:
+    static const size_t MAX_PARAMETERS = 8;
+
+    template <typename Result, typename... Args>
+    NativeRecipe(Result (*function)(Args...))
+        : function(reinterpret_cast<void (*)()>(function)), parameterCount(sizeof...(Args)),
+          invoker(&native::call<Result, Args...>) {
+        static_assert(sizeof...(Args) <= MAX_PARAMETERS, "Too many parameters for a native recipe");
+    }
+
+    size_t arity() const { return parameterCount; }
+
+    // Call with arity() arguments; 'name' is the recipe's name for errors
+    Value call(const std::string& name, const Value* arguments) const {
+        return invoker(function, name, arguments);
+    }
+
+private:
+    void (*function)();
+    size_t parameterCount;
+    Value (*invoker)(void (*)(), const std::string&, const Value*);
+};
+
 // Interpreter class
 class Interpreter {
 public:
     Interpreter();
     void interpret(const Program& program);
 
+    // Run top-level statements [first, last) of a program
+    void interpret(const Program& program, size_t first, size_t last);
+
+    // Run top-level statements one at a time as they become available, such
+    // as from a pipelined parser; startRun() begins the budget for all of them
+    void startRun();
+    void interpretStatement(const Statement& stmt);
+
+    // Directory that relative cookbook paths are resolved against
+    void setBaseDirectory(const std::string& directory) { baseDirectory = directory; }
+
+    // Stream that taste statements write to (std::cout by default)
+    void setOutput(std::ostream& stream) { out = &stream; }
+
+    // Report recipe calls and statements to a profiler (nullptr disables)
+    void setProfiler(Profiler* profiler) { this->profiler = profiler; }
+
+    // Define a global ingredient, such as an input supplied before interpret()
+    void define(const std::string& name, const Value& value) { environment.define(name, value); }
+
+    // Make a C++ function callable as a recipe, such as
+    // defineNative("to_grams", +[](double cups) { return cups * 120; }).
+    // Recipes written in Cook take precedence over one of the same name.
+    void defineNative(const std::string& name, const NativeRecipe& recipe) {
+        natives.insert_or_assign(name, recipe);
+    }
+
+    // Parameters of a recipe defined by the program or an imported
+    // cookbook; nullptr if there is none by that name
+    const std::vector<std::string>* recipeParameters(const std::string& name);
+
+    // Call a recipe with values supplied by the host, such as a row of
+    // `--for-each` input, as if from a top-level statement
+    void callRecipe(const std::string& name, const std::vector<Value>& arguments);
+
+    // Limits enforced by each interpret() and callRecipe() call
+    void setBudget(const ExecutionBudget& budget) { this->budget = budget; }
+
+    // Threads for running independent top-level recipe calls at the same
+    // time; 0 picks one per hardware thread. With 1, the default, or with a
+    // profiler or budget, interpret() runs every statement in order.
+    void setJobs(size_t jobs) { this->jobs = jobs; }
+
+    // Write the ingredients, recipes and imported cookbooks, for a snapshot
+    void saveState(AstWriter& writer) const;
+
+    // Replace the state with one written by saveState
+    void restoreState(AstReader& reader);
+
 private:
     Environment environment;
     std::unordered_map<std::string, Recipe> recipes;
 
+    // Cookbooks imported by this interpreter, and recipes they provide that
+    // have not been called yet
+    std::string baseDirectory;
+    std::unordered_set<const Module*> importedModules;
+    std::unordered_map<std::string, const Module*> pendingRecipes;
+
+    // Native recipes, defined by the host or by built-in cookbooks, and the
+    // built-in cookbooks imported
+    std::unordered_map<std::string, NativeRecipe> natives;
+    std::unordered_set<std::string> builtinImports;
+
+    // Transient strings produced while evaluating a statement
+    Region region;
+
+    // Set while evaluating a taste expression that cannot change the
+    // environment, so variable reads need not copy their strings
+    bool borrowVariables = false;
+
+    std::ostream* out;
+    Profiler* profiler = nullptr;
+    int callDepth = 0;
+
+    // Parallel calls. A worker runs one call in an environment layered over
+    // its parent's, and looks recipes up in the parent, which does not change
+    // either until every worker has finished.
+    struct CallAccess;
+    size_t jobs = 1;
+    std::unique_ptr<ThreadPool> pool;
+    const Interpreter* parent = nullptr;
+
+    // Budget accounting. Statements and calls decrement 'fuel'; only when it
+    // runs out are the step count and the clock checked.
+    ExecutionBudget budget;
+    int64_t fuel = 0;
+    uint64_t granted = 0;
+    uint64_t stepsTaken = 0;
+    std::chrono::steady_clock::time_point deadline;
+    size_t savedStringBytes = 0;
+
     // Statement visitors
     void executeStatement(const Statement* stmt);
     void executeExpressionStmt(const ExpressionStmt* stmt);
     void executeIngredientStmt(const IngredientStmt* stmt);
     void executeRecipeStmt(const RecipeStmt* stmt);
     void executeTasteStmt(const TasteStmt* stmt);
+    void executeCookbookStmt(const CookbookStmt* stmt);
+    void importBuiltin(const std::string& path);
 
     // Expression visitors
     Value evaluateExpression(const Expression* expr);
     Value evaluateLiteralExpr(const LiteralExpr* expr);
     Value evaluateVariableExpr(const VariableExpr* expr);
+    Value evaluateUnaryExpr(const UnaryExpr* expr);
     Value evaluateBinaryExpr(const BinaryExpr* expr);
     Value evaluateAssignExpr(const AssignExpr* expr);
     Value evaluateCallExpr(const CallExpr* expr);
 
+    // Parallel calls
+    bool runsInParallel() const;
+    size_t independentCalls(const Program& program, size_t first, size_t last,
+                            std::vector<CallAccess>& accesses);
+    bool analyzeCall(const Statement* stmt, CallAccess& access);
+    bool analyzeExpression(const Expression* expr, bool persistent, CallAccess& access);
+    bool analyzeRecipe(const Recipe& recipe, CallAccess& access);
+    void interpretParallel(const Program& program, size_t first, const std::vector<CallAccess>& accesses);
+
     // Helper methods
-    void executeRecipeBody(const Recipe& recipe, const std::vector<Value>& arguments);
+    Value concatenate(const Value& left, const Value& right);
+    const Recipe* findRecipe(const std::string& name);
+    const NativeRecipe* findNative(const std::string& name) const;
+    Value callNative(const NativeRecipe& native, const CallExpr* call);
+    void invokeRecipe(const Recipe& recipe, const std::vector<Value>& arguments, const CallExpr* call);
+    void executeRecipeBody(const Recipe& recipe, const std::vector<Value>& arguments, const CallExpr* call);
+
+    // Budget checks
+    void startBudget();
+    void refuel(const ASTNode* node);
+    // Throws if live strings plus 'pending' more bytes exceed the limit
+    void checkStringBytes(const ASTNode* node, size_t pending = 0);
+
+    friend void native::reserveString(size_t bytes);
 };
 
 } // namespace cook
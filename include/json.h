@@ -0,0 +1,67 @@
+#ifndef COOK_JSON_H
+#define COOK_JSON_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace cook {
+
+// Minimal JSON value for the tool protocols (language server and friends).
+// Objects keep their members in insertion order.
+class Json {
+public:
+    enum class Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+    Json() : type(Type::NUL) {}
+    Json(bool value) : type(Type::BOOLEAN), boolValue(value) {}
+    Json(int value) : type(Type::NUMBER), numberValue(value) {}
+    Json(double value) : type(Type::NUMBER), numberValue(value) {}
+    Json(const char* value) : type(Type::STRING), stringValue(value) {}
+    Json(std::string value) : type(Type::STRING), stringValue(std::move(value)) {}
+
+    static Json array();
+    static Json object();
+
+    // Parse a complete JSON text; throws std::runtime_error on malformed input
+    static Json parse(const std::string& text);
+
+    Type getType() const { return type; }
+    bool isNull() const { return type == Type::NUL; }
+    bool isNumber() const { return type == Type::NUMBER; }
+    bool isString() const { return type == Type::STRING; }
+    bool isArray() const { return type == Type::ARRAY; }
+    bool isObject() const { return type == Type::OBJECT; }
+
+    bool asBool() const { return type == Type::BOOLEAN && boolValue; }
+    double asNumber() const { return type == Type::NUMBER ? numberValue : 0.0; }
+    int asInt() const { return static_cast<int>(asNumber()); }
+    const std::string& asString() const { return stringValue; }
+
+    // Object access; a missing member reads as null
+    const Json& operator[](const std::string& key) const;
+    Json& operator[](const std::string& key);
+    bool has(const std::string& key) const;
+    const std::vector<std::pair<std::string, Json>>& entries() const { return members; }
+
+    // Array access
+    size_t size() const { return items.size(); }
+    const Json& operator[](size_t index) const { return items[index]; }
+    void push(Json value);
+
+    std::string dump() const;
+
+private:
+    Type type;
+    bool boolValue = false;
+    double numberValue = 0.0;
+    std::string stringValue;
+    std::vector<Json> items;
+    std::vector<std::pair<std::string, Json>> members;
+
+    void write(std::string& out) const;
+};
+
+} // namespace cook
+
+#endif // COOK_JSON_H
@@ -0,0 +1,82 @@
+#ifndef COOK_LANGUAGE_SERVER_H
+#define COOK_LANGUAGE_SERVER_H
+
+#include "document.h"
+#include "json.h"
+#include "module.h"
+#include <cstdint>
+#include <istream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace cook {
+
+// Language Server Protocol over a pair of streams (stdin/stdout for `cook --lsp`).
+// Open documents are kept parsed and updated incrementally; the server answers
+// completion and go-to-definition and publishes syntax errors after each change.
+class LanguageServer {
+public:
+    LanguageServer(std::istream& in, std::ostream& out);
+
+    // Serve messages until the client sends 'exit'; returns the exit code
+    int run();
+
+private:
+    std::istream& in;
+    std::ostream& out;
+    std::unordered_map<std::string, std::unique_ptr<Document>> documents;
+    bool shutdownRequested = false;
+
+    // Whether the client counts characters in bytes (UTF-8) like the server,
+    // rather than in UTF-16 code units
+    bool utf8Positions = false;
+
+    // Imported cookbooks, parsed here rather than through ModuleCache so the
+    // editor never writes "<file>c" files and sees cookbooks as they are edited
+    struct CachedModule {
+        uint64_t size = 0;
+        uint64_t modified = 0;
+        std::unique_ptr<Module> module; // null if the file failed to parse
+    };
+    std::unordered_map<std::string, CachedModule> modules;
+
+    bool readMessage(std::string& body);
+    void send(const Json& message);
+    void respond(const Json& id, Json result);
+    void respondError(const Json& id, int code, const std::string& message);
+
+    // Returns false once the client asked the server to exit
+    bool handle(const Json& message);
+
+    Json initialize(const Json& params);
+    void didOpen(const Json& params);
+    void didChange(const Json& params);
+    void didClose(const Json& params);
+    Json completion(const Json& params);
+    Json definition(const Json& params);
+    void publishDiagnostics(const std::string& uri, const Document& document);
+
+    const Document* find(const std::string& uri) const;
+
+    // Convert between the client's positions and the byte columns used here
+    TextPosition textPosition(const Document& document, const Json& position) const;
+    Json lspRange(std::string_view line, int lineNumber, int column, size_t length) const;
+    Json lspLocation(const std::string& uri, std::string_view line, int lineNumber, int column,
+                     size_t length) const;
+
+    // A cookbook as it is on disk now, or null if it cannot be loaded
+    const Module* loadModule(const std::string& path);
+
+    // Cookbooks a document imports, directly or through other cookbooks
+    std::vector<const Module*> importedModules(const std::string& uri, const Document& document);
+    void collectModules(const std::string& directory, const std::string& cookbook,
+                        std::vector<const Module*>& found);
+};
+
+} // namespace cook
+
+#endif // COOK_LANGUAGE_SERVER_H
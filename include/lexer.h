@@ -17,7 +17,8 @@ enum class TokenType {
     
     // Literals
     STRING,
-    NUMBER,
+    NUMBER,      // with a decimal part
+    INTEGER,
     IDENTIFIER,
     
     // Operators
@@ -26,6 +27,13 @@ enum class TokenType {
     MULTIPLY,
     DIVIDE,
     ASSIGN,
+    BANG,          // !
+    EQUAL_EQUAL,   // ==
+    BANG_EQUAL,    // !=
+    LESS,          // <
+    LESS_EQUAL,    // <=
+    GREATER,       // >
+    GREATER_EQUAL, // >=
     
     // Delimiters
     LPAREN,      // (
@@ -55,8 +63,14 @@ struct Token {
 class Lexer {
 public:
     Lexer(const std::string& source);
+    
+    // Lex a fragment of a larger document that starts at line:column
+    Lexer(const std::string& source, int line, int column);
     std::vector<Token> tokenize();
     
+    // The next token; EOF_TOKEN once the source is exhausted
+    Token next();
+    
 private:
     std::string source;
     int position = 0;
@@ -69,9 +83,11 @@ private:
     bool match(char expected);
     
     Token makeToken(TokenType type);
+    Token makeToken(TokenType type, int length);  // the last 'length' characters
     Token stringToken();
     Token numberToken();
     Token identifierToken();
+    Token unknownToken(char first);
     
     void skipWhitespace();
     void skipComment();
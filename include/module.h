@@ -0,0 +1,86 @@
+#ifndef COOK_MODULE_H
+#define COOK_MODULE_H
+
+#include "ast.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <cstdint>
+
+namespace cook {
+
+// A compiled cookbook. Top-level statements are decoded when the module is
+// loaded; recipe bodies stay in the compiled image until they are called.
+class Module {
+public:
+    const std::string& getPath() const { return path; }
+    const std::vector<std::unique_ptr<Statement>>& getPrelude() const { return prelude; }
+    std::vector<std::string> getRecipeNames() const;
+    bool hasRecipe(const std::string& name) const;
+
+    // Decode a single recipe from the compiled image
+    std::unique_ptr<RecipeStmt> materializeRecipe(const std::string& name) const;
+
+private:
+    friend class ModuleCache;
+
+    std::string path;
+    std::string directory;
+    std::string image;
+    size_t bodiesOffset = 0;
+    uint64_t sourceSize = 0;
+    uint64_t sourceModified = 0;
+    std::vector<std::unique_ptr<Statement>> prelude;
+    std::unordered_map<std::string, uint64_t> recipeOffsets;
+};
+
+// Process-wide cache of loaded cookbooks. Each file is parsed at most once per
+// process (once per version with revalidation on), and its compiled form is
+// kept next to the source as "<file>c".
+class ModuleCache {
+public:
+    static ModuleCache& instance();
+
+    // Load a cookbook by resolved path
+    const Module& load(const std::string& path);
+
+    // Check each file's size and modification time on every load and reload
+    // it if they changed, for long-lived processes such as `cook serve`
+    void setRevalidate(bool enabled);
+
+    // Compile source into the on-disk module format
+    static std::string compile(const std::string& source);
+
+    // Parse a cookbook from its source, bypassing both the process cache and
+    // the "<file>c" file; for tools that must see the file as it is now
+    static std::unique_ptr<Module> compileFile(const std::string& path);
+
+private:
+    ModuleCache() = default;
+
+    std::mutex mutex;
+    std::unordered_map<std::string, std::unique_ptr<Module>> modules;
+    bool revalidate = false;
+
+    // Modules replaced by a newer version of their file. Interpreters that
+    // loaded them may still be running, so they are kept until exit.
+    std::vector<std::unique_ptr<Module>> retired;
+
+    static std::unique_ptr<Module> decode(const std::string& path, std::string image);
+};
+
+// Whether a cookbook path names one built into the interpreter, such as
+// "builtin:pantry", rather than a file
+bool isBuiltinCookbook(const std::string& path);
+
+// Resolve a cookbook path relative to the directory of the importing file
+std::string resolveModulePath(const std::string& baseDirectory, const std::string& path);
+
+// Directory part of a file path ("" for a bare file name)
+std::string directoryOf(const std::string& path);
+
+} // namespace cook
+
+#endif // COOK_MODULE_H
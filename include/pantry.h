@@ -0,0 +1,28 @@
+#ifndef COOK_PANTRY_H
+#define COOK_PANTRY_H
+
+#include "interpreter.h"
+#include <string>
+#include <vector>
+
+namespace cook {
+
+// A recipe of a built-in cookbook
+struct NativeDefinition {
+    const char* name;
+    NativeRecipe recipe;
+};
+
+// Recipes of the built-in cookbook at 'path'; nullptr if there is none.
+//
+// `cookbook "builtin:pantry";` provides math and string recipes:
+//   abs(x) min(a, b) max(a, b) floor(x) ceil(x) round(x) round_to(x, places)
+//   sqrt(x) pow(x, y)
+//   length(s) upper(s) lower(s) trim(s) repeat(s, n) contains(s, part)
+//   find(s, part) substring(s, start, count) replace(s, from, to)
+//   text(value) number(s)
+const std::vector<NativeDefinition>* builtinCookbook(const std::string& path);
+
+} // namespace cook
+
+#endif // COOK_PANTRY_H
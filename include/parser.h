@@ -3,44 +3,87 @@
 
 #include "lexer.h"
 #include "ast.h"
+#include <functional>
 #include <vector>
 #include <memory>
+#include <string>
 
 namespace cook {
 
+// A syntax error with the location of the offending token
+struct Diagnostic {
+    int line;
+    int column;
+    std::string message;
+
+    // "file:line:column: error: message"
+    std::string format(const std::string& sourceName) const;
+};
+
+// Recursive descent parser for statements; expressions are parsed by
+// precedence climbing over a table of binary operators. Syntax errors never
+// throw: they are collected as diagnostics, the parser resynchronizes at the
+// next statement, and parse() returns the statements that were well formed.
 class Parser {
 public:
     Parser(const std::vector<Token>& tokens);
+    Parser(std::vector<Token>&& tokens);
+    
+    // Parse tokens pulled one at a time from 'source', which returns
+    // EOF_TOKEN at the end; only the tokens of the current statement are kept
+    explicit Parser(std::function<Token()> source);
+    
     std::unique_ptr<Program> parse();
     
+    // The next well-formed top-level statement, or nullptr at the end
+    std::unique_ptr<Statement> next();
+    
+    bool hadError() const { return !diagnostics.empty(); }
+    const std::vector<Diagnostic>& getDiagnostics() const { return diagnostics; }
+    
 private:
     std::vector<Token> tokens;
     int current = 0;
     
+    // Streaming: where tokens come from, and buffers outgrown during the
+    // current statement
+    std::function<Token()> source;
+    std::vector<std::vector<Token>> retired;
+    std::vector<Diagnostic> diagnostics;
+    
     // Helper methods
-    Token peek();
-    Token previous();
-    Token advance();
-    bool isAtEnd();
-    bool check(TokenType type);
+    const Token& peek() const;
+    const Token& previous() const;
+    const Token& advance();
+    void pull();
+    bool isAtEnd() const;
+    bool check(TokenType type) const;
     bool match(TokenType type);
     bool match(std::initializer_list<TokenType> types);
-    Token consume(TokenType type, const std::string& message);
+    bool consume(TokenType type, const char* message);
+    
+    // Attach the location of a token to a freshly built node
+    template <typename T>
+    std::unique_ptr<T> located(std::unique_ptr<T> node, const Token& token) {
+        node->setLocation(token.line, token.column);
+        return node;
+    }
     
     // Parsing methods
     std::unique_ptr<Statement> declaration();
     std::unique_ptr<Statement> ingredientDeclaration();
     std::unique_ptr<Statement> recipeDeclaration();
+    std::unique_ptr<Statement> cookbookDeclaration();
     std::unique_ptr<Statement> statement();
     std::unique_ptr<Statement> expressionStatement();
     
     std::unique_ptr<Expression> expression();
-    std::unique_ptr<Expression> assignment();
-    std::unique_ptr<Expression> term();
-    std::unique_ptr<Expression> factor();
+    std::unique_ptr<Expression> parsePrecedence(int minimum);
+    std::unique_ptr<Expression> unary();
     std::unique_ptr<Expression> primary();
     
     // Error handling
+    void error(const Token& token, const std::string& message);
     void synchronize();
 };
 
@@ -0,0 +1,32 @@
+#ifndef COOK_PIPELINE_H
+#define COOK_PIPELINE_H
+
+#include "ast.h"
+#include "lexer.h"
+#include "parser.h"
+#include <functional>
+#include <vector>
+
+namespace cook {
+
+// Outcome of a pipelined run
+struct PipelineReport {
+    // Wall time of the lexer and parser threads, including waits on the queues
+    double lexMs = 0.0;
+    double parseMs = 0.0;
+    std::vector<Diagnostic> diagnostics;
+};
+
+// Lex and parse on two threads of their own while the calling thread runs
+// each top-level statement as soon as it is parsed (`cook --pipeline`).
+//
+// The stages are connected by bounded queues, so only a fixed number of
+// tokens and statements are in flight, and each statement is freed once it
+// has run. Nothing after the first syntax error runs, but parsing continues
+// so that every error is reported. An exception from 'execute' stops the other
+// stages and is rethrown.
+PipelineReport runPipelined(Lexer lexer, const std::function<void(const Statement&)>& execute);
+
+} // namespace cook
+
+#endif // COOK_PIPELINE_H
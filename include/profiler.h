@@ -0,0 +1,104 @@
+#ifndef COOK_PROFILER_H
+#define COOK_PROFILER_H
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+
+namespace cook {
+
+// Profiler for recipes and statements. The instrumenting mode times every
+// transition exactly; the sampling mode only maintains a frame stack and lets
+// a SIGPROF timer record it, which keeps the overhead low for long runs.
+class Profiler {
+public:
+    enum class Mode { INSTRUMENT, SAMPLE };
+
+    Profiler(Mode mode, int sampleIntervalMicros = 1000);
+    ~Profiler();
+
+    void start();
+    void stop();
+
+    // Interpreter hooks
+    void enterRecipe(const std::string& name);
+    void enterStatement(int line);
+    void exit();
+
+    // Collapsed stacks ("main;greet;greet:15 42") weighted in microseconds
+    void writeFolded(std::ostream& out) const;
+
+    // Per-recipe and per-statement tables
+    void writeSummary(std::ostream& out) const;
+
+    // Called from the SIGPROF handler
+    void recordSample();
+
+private:
+    static const int MAX_DEPTH = 256;
+    static const size_t SAMPLE_CAPACITY = 1 << 22;
+
+    // Stack frames are either recipes (by id) or statements (by line)
+    static uint32_t recipeFrame(uint32_t id) { return id << 1; }
+    static uint32_t lineFrame(int line) { return (static_cast<uint32_t>(line) << 1) | 1; }
+    static bool isLineFrame(uint32_t frame) { return (frame & 1) != 0; }
+
+    // Call tree node; exclusive time is accumulated per node
+    struct Node {
+        int parent;
+        uint32_t frame;
+        uint64_t selfNanos = 0;
+        uint64_t count = 0;
+        std::unordered_map<uint32_t, int> children;
+
+        Node(int parent, uint32_t frame) : parent(parent), frame(frame) {}
+    };
+
+    Mode mode;
+    int intervalMicros;
+    bool running = false;
+
+    std::vector<std::string> recipeNames;
+    std::unordered_map<std::string, uint32_t> recipeIds;
+    std::vector<uint64_t> recipeCalls;
+
+    std::vector<Node> nodes;
+    int currentNode = 0;
+    std::chrono::steady_clock::time_point lastTransition;
+
+    // Frame stack read by the signal handler
+    uint32_t stack[MAX_DEPTH];
+    volatile sig_atomic_t depth = 0;
+
+    // Samples are stored as [depth, frames...] records
+    std::unique_ptr<uint32_t[]> samples;
+    volatile size_t sampleEnd = 0;
+    volatile size_t droppedSamples = 0;
+
+    void push(uint32_t frame);
+    void chargeCurrent();
+    int childNode(int parent, uint32_t frame);
+    std::string frameLabel(int node) const;
+    uint32_t ownerRecipe(int node) const;
+};
+
+// Keeps the profiler stack balanced when a statement or call unwinds
+class ProfileScope {
+public:
+    ProfileScope(Profiler* profiler) : profiler(profiler) {}
+    ~ProfileScope() {
+        if (profiler) profiler->exit();
+    }
+
+private:
+    Profiler* profiler;
+};
+
+} // namespace cook
+
+#endif // COOK_PROFILER_H
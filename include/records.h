@@ -0,0 +1,84 @@
+#ifndef COOK_RECORDS_H
+#define COOK_RECORDS_H
+
+#include "files.h"
+#include "interpreter.h"
+#include <string>
+#include <vector>
+
+namespace cook {
+
+// Rows of a CSV or JSON Lines file, read through a memory mapping
+// (`cook --for-each`).
+//
+// The reader is given the names of the fields to extract and fills one Value
+// per name for each row. The first row of a CSV file names its columns; each
+// line of a JSON Lines file is an object with a member per field. Unquoted CSV
+// fields and JSON numbers that look like numbers become numbers.
+//
+// Strings are borrowed from the mapping, or from a buffer reused by every row
+// when they contain escapes, so a row is never copied; its values are valid
+// until the next call to next(). Pages already read are released as the
+// reader moves on, so memory use does not grow with the size of the file.
+class RecordReader {
+public:
+    enum class Format { CSV, JSONL };
+
+    // Format from the extension (.csv, .jsonl or .ndjson); false if unknown
+    static bool formatOf(const std::string& path, Format& format);
+
+    // Open 'path' and, for CSV, read its header; throws if the file cannot be
+    // read or a CSV header lacks one of 'fields'
+    RecordReader(const std::string& path, Format format, std::vector<std::string> fields);
+
+    // Read the next row into 'values'; false at the end of the file. Throws
+    // on malformed rows and rows missing a field.
+    bool next(std::vector<Value>& values);
+
+    // Line on which the last row read starts
+    size_t line() const { return rowLine; }
+
+private:
+    std::string path;
+    Format format;
+    std::vector<std::string> fields;
+    MappedFile file;
+
+    size_t position = 0;
+    size_t currentLine = 1;
+    size_t rowLine = 0;
+    size_t released = 0;
+
+    // CSV: the field each column fills, or -1 for columns not extracted
+    std::vector<int> columnSlots;
+
+    // Per-field buffers for strings that had to be unescaped, and which
+    // fields the current JSON row has set
+    std::vector<std::string> scratch;
+    std::string nameBuffer;
+    std::vector<char> filled;
+
+    void readCsvHeader();
+    bool nextCsv(std::vector<Value>& values);
+    bool nextJson(std::vector<Value>& values);
+
+    // Read one CSV field starting at 'position'; 'quoted' is set for quoted
+    // fields, whose doubled quotes are unescaped into 'unescaped' if non-null
+    void readCsvField(const char*& data, size_t& size, bool& quoted, std::string* unescaped);
+
+    // Read the JSON string or value starting at 'position'; escapes are
+    // decoded into 'decoded' if non-null
+    void readJsonString(const char*& data, size_t& size, std::string* decoded);
+    void readJsonValue(int slot, std::vector<Value>& values);
+    void skipJsonNested();
+    void skipJsonSpaces();
+    void expectJson(char c, const char* what);
+
+    int slotOf(const char* name, size_t size) const;
+    void releaseBefore(size_t offset);
+    [[noreturn]] void fail(size_t line, const std::string& message) const;
+};
+
+} // namespace cook
+
+#endif // COOK_RECORDS_H
@@ -0,0 +1,67 @@
+#ifndef COOK_REGION_H
+#define COOK_REGION_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace cook {
+
+// Bump allocator for transient runtime strings. Memory is handed out from
+// large blocks and reclaimed all at once by releasing to a mark or resetting;
+// blocks are kept for reuse, so a warmed-up region does not call malloc.
+// Blocks larger than the block size, made for one oversized string, are
+// freed when released instead.
+class Region {
+public:
+    // Position in the region that later allocations can be released back to
+    struct Mark {
+        size_t block;
+        size_t offset;
+    };
+
+    explicit Region(size_t blockSize = 64 * 1024);
+
+    Region(const Region&) = delete;
+    Region& operator=(const Region&) = delete;
+
+    char* allocate(size_t size);
+    const char* copy(const char* data, size_t size);
+
+    Mark mark() const { return Mark{current, offset}; }
+    void release(const Mark& mark);
+    void reset() { release(Mark{0, 0}); }
+
+    // Total capacity of the blocks owned by the region
+    size_t capacity() const;
+
+    // Bytes handed out since the region was last reset, counting the unused
+    // tails of blocks that were skipped
+    size_t used() const;
+
+private:
+    struct Block {
+        std::unique_ptr<char[]> data;
+        size_t size;
+    };
+
+    size_t blockSize;
+    std::vector<Block> blocks;
+    size_t current = 0;
+    size_t offset = 0;
+};
+
+// Releases a region back to the mark taken at construction
+class RegionScope {
+public:
+    RegionScope(Region& region) : region(region), mark(region.mark()) {}
+    ~RegionScope() { region.release(mark); }
+
+private:
+    Region& region;
+    Region::Mark mark;
+};
+
+} // namespace cook
+
+#endif // COOK_REGION_H
@@ -0,0 +1,278 @@
+#ifndef COOK_RUNTIME_H
+#define COOK_RUNTIME_H
+
+#include <cstdint>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+namespace cook {
+namespace runtime {
+
+// Cook's values and operators for code that runs without the interpreter:
+// scripts compiled in with embedded.h and programs written by `cook compile`.
+// Results, output and error messages match the interpreter's. Header only, so
+// a generated program needs nothing else from Cook to build.
+
+// Binary operators, in the order of BinaryExpr::Operator
+enum class Operator {
+    ADD, SUBTRACT, MULTIPLY, DIVIDE,
+    EQUAL, NOT_EQUAL, LESS, LESS_EQUAL, GREATER, GREATER_EQUAL
+};
+
+// A Cook value: undefined, an integer, a double or a string. Literal strings
+// are views of text that outlives the value; others own their text.
+class Value {
+public:
+    enum class Type { UNDEFINED, INTEGER, NUMBER, STRING };
+
+    Value() = default;
+
+    template <typename T, typename std::enable_if<std::is_integral<T>::value, int>::type = 0>
+    Value(T value) : type(Type::INTEGER), integer(static_cast<int64_t>(value)) {}
+
+    Value(double value) : type(Type::NUMBER), number(value) {}
+    Value(std::string text) : type(Type::STRING), owned(std::move(text)) {}
+    Value(const char* text) : Value(std::string(text)) {}
+
+    // A string that outlives the value
+    static Value literal(std::string_view text) {
+        Value value;
+        value.type = Type::STRING;
+        value.view = text;
+        value.borrowed = true;
+        return value;
+    }
+
+    Type getType() const { return type; }
+    bool isDefined() const { return type != Type::UNDEFINED; }
+    bool isInteger() const { return type == Type::INTEGER; }
+    bool isNumber() const { return type == Type::INTEGER || type == Type::NUMBER; }
+    bool isString() const { return type == Type::STRING; }
+
+    int64_t getInteger() const { return integer; }
+    double getNumber() const { return type == Type::INTEGER ? static_cast<double>(integer) : number; }
+    std::string_view getString() const { return borrowed ? view : std::string_view(owned); }
+
+private:
+    Type type = Type::UNDEFINED;
+    bool borrowed = false;
+    int64_t integer = 0;
+    double number = 0.0;
+    std::string_view view;
+    std::string owned;
+};
+
+[[noreturn]] inline void undefinedIngredient(std::string_view name) {
+    throw std::runtime_error("Undefined ingredient '" + std::string(name) + "'");
+}
+
+[[noreturn]] inline void undefinedRecipe(std::string_view name) {
+    throw std::runtime_error("Undefined recipe '" + std::string(name) + "'");
+}
+
+[[noreturn]] inline void wrongArgumentCount(size_t expected, size_t got) {
+    throw std::runtime_error("Expected " + std::to_string(expected) + " arguments but got " +
+                             std::to_string(got));
+}
+
+// Comparison results are integers: 1 for true, 0 for false
+inline Value truth(bool value) {
+    return Value(value ? 1 : 0);
+}
+
+// Integer arithmetic that reports overflow instead of wrapping
+inline bool addOverflows(int64_t a, int64_t b, int64_t& result) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_add_overflow(a, b, &result);
+#else
+    if ((b > 0 && a > INT64_MAX - b) || (b < 0 && a < INT64_MIN - b)) return true;
+    result = a + b;
+    return false;
+#endif
+}
+
+inline bool subtractOverflows(int64_t a, int64_t b, int64_t& result) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_sub_overflow(a, b, &result);
+#else
+    if ((b < 0 && a > INT64_MAX + b) || (b > 0 && a < INT64_MIN + b)) return true;
+    result = a - b;
+    return false;
+#endif
+}
+
+inline bool multiplyOverflows(int64_t a, int64_t b, int64_t& result) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_mul_overflow(a, b, &result);
+#else
+    if (a != 0 && b != 0) {
+        if ((a == -1 && b == INT64_MIN) || (b == -1 && a == INT64_MIN)) return true;
+        if (a != -1 && b != -1 && (a * b) / b != a) return true;
+    }
+    result = a * b;
+    return false;
+#endif
+}
+
+// Text of a value for concatenation: integers exactly, doubles like "%f"
+inline std::string textOf(int64_t value) {
+    return std::to_string(static_cast<long long>(value));
+}
+
+inline std::string textOf(double value) {
+    return std::to_string(value);
+}
+
+inline const std::string& textOf(const std::string& value) {
+    return value;
+}
+
+inline std::string textOf(const Value& value) {
+    if (value.isString()) return std::string(value.getString());
+    if (value.isInteger()) return textOf(value.getInteger());
+    return textOf(value.getNumber());
+}
+
+template <typename Left, typename Right>
+std::string concat(const Left& left, const Right& right) {
+    std::string result(textOf(left));
+    result += textOf(right);
+    return result;
+}
+
+inline double divide(double left, double right) {
+    if (right == 0) throw std::runtime_error("Division by zero");
+    return left / right;
+}
+
+// Binary operators on values of any type. 'Op' is known where the operator
+// is written, so only its own branch is compiled.
+template <Operator Op>
+Value binary(const Value& left, const Value& right) {
+    constexpr bool equality = Op == Operator::EQUAL || Op == Operator::NOT_EQUAL;
+    constexpr bool comparison = Op >= Operator::LESS && Op <= Operator::GREATER_EQUAL;
+
+    if (left.isInteger() && right.isInteger()) {
+        int64_t a = left.getInteger();
+        int64_t b = right.getInteger();
+        int64_t exact = 0;
+        if constexpr (Op == Operator::ADD) {
+            if (!addOverflows(a, b, exact)) return Value(exact);
+        } else if constexpr (Op == Operator::SUBTRACT) {
+            if (!subtractOverflows(a, b, exact)) return Value(exact);
+        } else if constexpr (Op == Operator::MULTIPLY) {
+            if (!multiplyOverflows(a, b, exact)) return Value(exact);
+        } else if constexpr (Op == Operator::DIVIDE) {
+            // Only divisions without a remainder stay integers
+            if (b != 0 && !(b == -1 && a == INT64_MIN) && a % b == 0) return Value(a / b);
+        } else if constexpr (Op == Operator::EQUAL) {
+            return truth(a == b);
+        } else if constexpr (Op == Operator::NOT_EQUAL) {
+            return truth(a != b);
+        } else if constexpr (Op == Operator::LESS) {
+            return truth(a < b);
+        } else if constexpr (Op == Operator::LESS_EQUAL) {
+            return truth(a <= b);
+        } else if constexpr (Op == Operator::GREATER) {
+            return truth(a > b);
+        } else {
+            return truth(a >= b);
+        }
+    }
+
+    // Values of different types are never equal
+    if constexpr (equality) {
+        bool equal;
+        if (left.isNumber() != right.isNumber()) {
+            equal = false;
+        } else if (left.isNumber()) {
+            equal = left.getNumber() == right.getNumber();
+        } else {
+            equal = left.getString() == right.getString();
+        }
+        return truth(equal == (Op == Operator::EQUAL));
+    } else {
+        if (left.isNumber() && right.isNumber()) {
+            double a = left.getNumber();
+            double b = right.getNumber();
+            if constexpr (Op == Operator::ADD) return Value(a + b);
+            else if constexpr (Op == Operator::SUBTRACT) return Value(a - b);
+            else if constexpr (Op == Operator::MULTIPLY) return Value(a * b);
+            else if constexpr (Op == Operator::DIVIDE) return Value(divide(a, b));
+            else if constexpr (Op == Operator::LESS) return truth(a < b);
+            else if constexpr (Op == Operator::LESS_EQUAL) return truth(a <= b);
+            else if constexpr (Op == Operator::GREATER) return truth(a > b);
+            else return truth(a >= b);
+        }
+
+        if constexpr (Op == Operator::ADD) {
+            return Value(concat(left, right));
+        } else if constexpr (comparison) {
+            if (left.isNumber() || right.isNumber()) {
+                throw std::runtime_error("Cannot compare a number with a string");
+            }
+
+            // Strings compare byte by byte
+            int order = left.getString().compare(right.getString());
+            if constexpr (Op == Operator::LESS) return truth(order < 0);
+            else if constexpr (Op == Operator::LESS_EQUAL) return truth(order <= 0);
+            else if constexpr (Op == Operator::GREATER) return truth(order > 0);
+            else return truth(order >= 0);
+        } else {
+            throw std::runtime_error("Invalid operands for binary operator");
+        }
+    }
+}
+
+// 0, 0.0 and the empty string are false
+inline int64_t logicalNot(const Value& operand) {
+    bool isFalse = operand.isInteger() ? operand.getInteger() == 0
+                 : operand.isNumber() ? operand.getNumber() == 0
+                 : operand.getString().empty();
+    return isFalse ? 1 : 0;
+}
+
+inline Value negate(const Value& operand) {
+    if (!operand.isNumber()) throw std::runtime_error("Operand of '-' must be a number");
+    if (operand.isInteger() && operand.getInteger() != INT64_MIN) return Value(-operand.getInteger());
+    return Value(-operand.getNumber());
+}
+
+// `taste`: the value and a newline
+inline void taste(std::ostream& out, int64_t value) {
+    out << value << std::endl;
+}
+
+inline void taste(std::ostream& out, double value) {
+    out << value << std::endl;
+}
+
+inline void taste(std::ostream& out, std::string_view text) {
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    out << std::endl;
+}
+
+inline void taste(std::ostream& out, const std::string& text) {
+    taste(out, std::string_view(text));
+}
+
+inline void taste(std::ostream& out, const Value& value) {
+    if (value.isInteger()) taste(out, value.getInteger());
+    else if (value.isNumber()) taste(out, value.getNumber());
+    else taste(out, value.getString());
+}
+
+// A value stored where only one type can reach; the others cannot happen,
+// since reading the value that would produce them has already thrown
+inline int64_t integerOf(const Value& value) { return value.getInteger(); }
+inline double numberOf(const Value& value) { return value.getNumber(); }
+inline std::string stringOf(const Value& value) { return std::string(value.getString()); }
+
+} // namespace runtime
+} // namespace cook
+
+#endif // COOK_RUNTIME_H
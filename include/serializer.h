@@ -0,0 +1,64 @@
+#ifndef COOK_SERIALIZER_H
+#define COOK_SERIALIZER_H
+
+#include "ast.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+
+namespace cook {
+
+// Writes AST nodes into a compact binary buffer
+class AstWriter {
+public:
+    AstWriter() = default;
+
+    void writeStatement(const Statement* stmt);
+    void writeExpression(const Expression* expr);
+
+    void writeU8(uint8_t value);
+    void writeU32(uint32_t value);
+    void writeU64(uint64_t value);
+    void writeString(const std::string& value);
+
+    size_t size() const { return buffer.size(); }
+    const std::string& data() const { return buffer; }
+
+private:
+    std::string buffer;
+
+    void writeLocation(const ASTNode* node);
+};
+
+// Reads AST nodes back from a buffer produced by AstWriter
+class AstReader {
+public:
+    AstReader(const char* data, size_t size);
+
+    std::unique_ptr<Statement> readStatement();
+    std::unique_ptr<Expression> readExpression();
+
+    uint8_t readU8();
+    uint32_t readU32();
+    uint64_t readU64();
+    std::string readString();
+
+    size_t position() const { return offset; }
+    void seek(size_t position);
+    bool isAtEnd() const { return offset >= length; }
+
+private:
+    const char* bytes;
+    size_t length;
+    size_t offset = 0;
+
+    void require(size_t count);
+    void readLocation(ASTNode* node);
+    std::unique_ptr<Statement> readStatementNode();
+    std::unique_ptr<Expression> readExpressionNode();
+};
+
+} // namespace cook
+
+#endif // COOK_SERIALIZER_H
@@ -0,0 +1,113 @@
+#ifndef COOK_SERVER_H
+#define COOK_SERVER_H
+
+#include "interpreter.h"
+#include "json.h"
+#include "parser.h"
+#include "thread_pool.h"
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace cook {
+
+// Long-lived process that runs preloaded scripts for clients of a Unix socket
+// (`cook serve`).
+//
+// Scripts are lexed and parsed once, and the cookbooks they import are loaded
+// into the module cache up front. Each request checks the size and
+// modification time of its script, and of the cookbooks it loads, and parses
+// again only those that changed. Each request is one line of JSON:
+//
+//     {"script": "report", "ingredients": {"region": "north", "limit": 10}}
+//
+// The ingredients are defined as globals before the script runs; a request
+// that passes one the script declares itself is rejected. The reply is
+// a sequence of JSON lines: {"output": "..."} for each line the script tastes,
+// as it is produced, then {"status": "ok", "ms": 0.42} or
+// {"status": "error", "message": "..."}. A connection may send any number of
+// requests; they are answered in order.
+//
+// One thread polls the listening socket and idle connections. When a request
+// line is complete the connection is handed to a worker, which runs every
+// complete request it has buffered and then hands it back.
+class Server {
+public:
+    Server(std::string socketPath, size_t workers, const ExecutionBudget& budget);
+    ~Server();
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    // Load a script to serve under 'name'; throws on syntax errors
+    void addScript(const std::string& name, const std::string& path);
+
+    size_t scriptCount() const { return scripts.size(); }
+
+    // Serve until SIGINT or SIGTERM; returns the exit code
+    int run();
+
+private:
+    // One parse of a script, shared with the requests running it when the
+    // file is reloaded
+    struct Parsed {
+        std::unique_ptr<Program> program;
+
+        // Ingredients the script declares at the top level; a request may not
+        // pass these, as the declaration would replace the value
+        std::unordered_set<std::string> ingredients;
+    };
+
+    struct Script {
+        std::string path;
+        std::string baseDirectory;
+        uint64_t size = 0;
+        uint64_t modified = 0;
+        std::shared_ptr<const Parsed> parsed;
+
+        // Why the latest version of the file could not be loaded
+        std::string error;
+
+        // Guards the fields above once the server runs, so a reload only
+        // holds up requests for the same script
+        std::mutex mutex;
+    };
+
+    struct Connection {
+        int fd;
+        std::string input;
+        bool closed = false;
+    };
+
+    std::string socketPath;
+    size_t workerCount;
+    ExecutionBudget budget;
+    // Fixed before run() starts, so looking a script up needs no lock
+    std::unordered_map<std::string, std::unique_ptr<Script>> scripts;
+
+    int listenFd = -1;
+
+    // Connections finished by a worker, waiting to go back to the poll set;
+    // writing to 'wakeFds[1]' interrupts the poll
+    std::mutex returnedMutex;
+    std::vector<Connection*> returned;
+    int wakeFds[2] = {-1, -1};
+
+    // Parse a script from its file; throws on syntax errors
+    static void loadScript(Script& script);
+
+    // The current parse of a script, reloaded first if its file changed
+    std::shared_ptr<const Parsed> currentScript(const std::string& name, std::string& baseDirectory);
+
+    bool listen();
+    void serveConnection(Connection* connection);
+    void handleRequest(Connection* connection, const std::string& line);
+    void giveBack(Connection* connection);
+};
+
+} // namespace cook
+
+#endif // COOK_SERVER_H
@@ -0,0 +1,51 @@
+#ifndef COOK_SNAPSHOT_H
+#define COOK_SNAPSHOT_H
+
+#include "files.h"
+#include "interpreter.h"
+#include <cstdint>
+#include <string>
+
+namespace cook {
+
+// Interpreter state saved part-way through a script, so later runs can skip
+// the statements before that point (`cook --snapshot-after` / `--restore`).
+//
+// Besides the state, a snapshot records where in the script execution
+// resumes, so a restoring run only lexes and parses the rest of the file. It
+// also records the size and hash of the script and is only restored into a
+// run of the same source.
+class Snapshot {
+public:
+    // Save 'interpreter', which has run the statements of 'source' before
+    // 'resume' (nullptr when it ran them all); 'line' is the requested line
+    static void write(const std::string& path, const Interpreter& interpreter, const std::string& source,
+                      uint32_t line, const Statement* resume);
+
+    // Map a snapshot of 'source'; throws if it is unreadable or was taken
+    // from different source
+    void open(const std::string& path, const std::string& source);
+
+    uint32_t line() const { return snapshotLine; }
+
+    // Where execution resumes: byte offset and one-based line and column
+    size_t resumeOffset() const { return offset; }
+    int resumeLine() const { return lineAt; }
+    int resumeColumn() const { return columnAt; }
+
+    // Load the saved state into 'interpreter'
+    void restore(Interpreter& interpreter) const;
+
+private:
+    MappedFile file;
+    std::string path;
+    uint32_t snapshotLine = 0;
+    size_t offset = 0;
+    int lineAt = 1;
+    int columnAt = 1;
+    size_t stateOffset = 0;
+};
+
+} // namespace cook
+
+#endif // COOK_SNAPSHOT_H
@@ -0,0 +1,76 @@
+#ifndef COOK_STATS_H
+#define COOK_STATS_H
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+namespace cook {
+
+// Interpreter counters. They are only updated when the build defines
+// COOK_STATS (cmake -DCOOK_ENABLE_STATS=ON); otherwise the macros below
+// compile to nothing.
+struct RuntimeStats {
+    uint64_t nodesEvaluated = 0;
+    uint64_t environmentLookups = 0;
+    uint64_t environmentMisses = 0;
+    uint64_t stringBytesCopied = 0;
+    uint64_t heapAllocations = 0;
+    uint64_t recipeCalls = 0;
+    uint64_t maxCallDepth = 0;
+};
+
+// Counters of the calling thread. Each thread counts into its own set, so
+// workers of `cook serve`, --jobs and --pipeline never write shared memory.
+RuntimeStats& runtimeStats();
+
+// Counters of every thread that has counted anything, added up. Call it once
+// the other threads are idle or have exited; maxCallDepth is the largest.
+RuntimeStats totalRuntimeStats();
+
+#ifdef COOK_STATS
+#define COOK_STAT_ADD(field, amount) (::cook::runtimeStats().field += (amount))
+#define COOK_STAT_MAX(field, value) \
+    do { \
+        uint64_t statValue = static_cast<uint64_t>(value); \
+        if (statValue > ::cook::runtimeStats().field) ::cook::runtimeStats().field = statValue; \
+    } while (0)
+#else
+#define COOK_STAT_ADD(field, amount) ((void)0)
+#define COOK_STAT_MAX(field, value) ((void)0)
+#endif
+
+// Wall-clock time spent in each front end and execution phase
+struct PhaseTimings {
+    double readMs = 0.0;
+    double lexMs = 0.0;
+    double parseMs = 0.0;
+    double executeMs = 0.0;
+};
+
+// Simple wall-clock stopwatch
+class Stopwatch {
+public:
+    Stopwatch() : start(std::chrono::steady_clock::now()) {}
+
+    void reset() { start = std::chrono::steady_clock::now(); }
+
+    double elapsedMillis() const {
+        return std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+};
+
+// Peak resident set size of the process in kilobytes (0 if unavailable)
+uint64_t peakResidentKilobytes();
+
+// Report phase timings, counters and peak RSS
+void writeStatsJson(std::ostream& out, const PhaseTimings& timings);
+void writeStatsText(std::ostream& out, const PhaseTimings& timings);
+
+} // namespace cook
+
+#endif // COOK_STATS_H
@@ -0,0 +1,76 @@
+#ifndef COOK_SYMBOL_INDEX_H
+#define COOK_SYMBOL_INDEX_H
+
+#include "files.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace cook {
+
+// One definition or use of a name in an indexed file
+struct IndexEntry {
+    enum class Kind : uint8_t {
+        INGREDIENT, // ingredient declaration
+        RECIPE,     // recipe declaration
+        VARIABLE,   // ingredient read or assigned
+        CALL        // recipe call
+    };
+
+    std::string file;  // relative to the indexed directory
+    std::string name;
+    std::string scope; // enclosing recipe, empty at the top level
+    Kind kind;
+    uint32_t line;
+    uint32_t column;
+};
+
+// What an index build did
+struct IndexReport {
+    size_t files = 0;
+    size_t parsed = 0;     // files that were lexed and parsed
+    size_t entries = 0;
+    size_t syntaxErrors = 0;
+    std::vector<std::string> unreadable; // files that could not be read
+};
+
+// Persistent symbol index for every .cook file below a directory, stored in
+// "<dir>/.cookindex". Rebuilding only parses files whose size and mtime
+// changed and whose content hash differs from the indexed one; parsing runs
+// on a thread pool. Queries memory-map the index and binary-search a sorted
+// name table, so they do not depend on the size of the codebase.
+class SymbolIndex {
+public:
+    static std::string pathFor(const std::string& root);
+
+    // Bring the index of a directory up to date (threads = 0: one per core)
+    static IndexReport build(const std::string& root, size_t threads = 0);
+
+    // Map an existing index; returns false if it is missing or not an index
+    bool open(const std::string& root);
+
+    // All entries for a name, grouped by kind and ordered by file and line
+    std::vector<IndexEntry> find(const std::string& name) const;
+
+    size_t fileCount() const { return files; }
+
+private:
+    MappedFile map;
+    uint32_t files = 0;
+    uint32_t names = 0;
+    uint32_t entries = 0;
+    uint64_t filesOffset = 0;
+    uint64_t namesOffset = 0;
+    uint64_t postingsOffset = 0;
+    uint64_t entriesOffset = 0;
+    uint64_t stringsOffset = 0;
+
+    std::string string(uint32_t offset, uint32_t length) const;
+    std::string nameAt(uint32_t id) const;
+    IndexEntry entryAt(uint32_t index) const;
+    std::string filePath(uint32_t index) const;
+};
+
+} // namespace cook
+
+#endif // COOK_SYMBOL_INDEX_H
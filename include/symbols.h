@@ -0,0 +1,59 @@
+#ifndef COOK_SYMBOLS_H
+#define COOK_SYMBOLS_H
+
+#include "lexer.h"
+#include "ast.h"
+#include <string>
+#include <vector>
+
+namespace cook {
+
+// A name introduced by a program
+struct Symbol {
+    enum class Kind { INGREDIENT, RECIPE, PARAMETER };
+
+    std::string name;
+    Kind kind;
+    int line;
+    int column;
+    std::string scope; // enclosing recipe, empty at the top level
+};
+
+// A use of a name: an ingredient read or assigned, or a recipe call
+struct Reference {
+    std::string name;
+    bool call;
+    int line;
+    int column;
+    std::string scope;
+};
+
+// Records the names that top-level statements define and use. Definitions are
+// located at their name token, looked up in the tokens the statements were
+// parsed from.
+class SymbolCollector {
+public:
+    explicit SymbolCollector(const std::vector<Token>& tokens) : tokens(tokens) {}
+
+    void collect(const Statement* stmt);
+
+    std::vector<Symbol> globals;       // top-level ingredients and recipes
+    std::vector<Symbol> locals;        // recipe parameters and body ingredients
+    std::vector<Reference> references;
+    std::vector<std::string> cookbooks;
+
+private:
+    const std::vector<Token>& tokens;
+    size_t cursor = 0;
+    std::string scope;
+
+    size_t tokenAt(int line, int column);
+    Symbol declared(const Statement* stmt, const std::string& name, Symbol::Kind kind);
+    void parameters(const RecipeStmt* recipe);
+    void body(const Statement* stmt);
+    void expression(const Expression* expr);
+};
+
+} // namespace cook
+
+#endif // COOK_SYMBOLS_H
@@ -0,0 +1,47 @@
+#ifndef COOK_THREAD_POOL_H
+#define COOK_THREAD_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cook {
+
+// Fixed set of worker threads running queued tasks in submission order
+class ThreadPool {
+public:
+    // 0 picks one thread per hardware thread
+    explicit ThreadPool(size_t threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    void submit(std::function<void()> task);
+
+    // Block until every submitted task has finished. If any task threw since
+    // the last wait, rethrows the first of those exceptions.
+    void wait();
+
+    size_t size() const { return workers.size(); }
+
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable available;
+    std::condition_variable idle;
+    size_t running = 0;
+    bool stopping = false;
+    std::exception_ptr failure;
+
+    void work();
+};
+
+} // namespace cook
+
+#endif // COOK_THREAD_POOL_H
@@ -0,0 +1,91 @@
+#ifndef COOK_TRANSPILER_H
+#define COOK_TRANSPILER_H
+
+#include "ast.h"
+#include <map>
+#include <string>
+#include <vector>
+
+namespace cook {
+
+// Translation of a Cook program to a C++ program (`cook compile`).
+//
+// Each recipe declaration becomes a C++ function and each ingredient a field
+// of one global state, which a call copies and restores the way the
+// interpreter copies its environment. Ingredients that only ever hold one
+// type of value are stored as int64_t, double or std::string, and operators
+// on them compile to plain C++; the rest hold a runtime::Value. Expressions
+// are evaluated into temporaries in the interpreter's order, so output and
+// errors come out in the same sequence.
+//
+// The program includes runtime.h and prints what `cook <script>` prints,
+// from the "Loading file" line to "Execution complete.".
+class Transpiler {
+public:
+    // 'sourceName' is the script's path as shown by the program
+    explicit Transpiler(const std::string& sourceName);
+
+    // C++ source for 'program'; throws for cookbooks, which need the
+    // interpreter's module loading
+    std::string translate(const Program& program);
+
+private:
+    // What an ingredient or expression can hold. NONE is what was never
+    // assigned; reading it always fails, and it counts as any type.
+    enum class Type { NONE, INTEGER, NUMBER, STRING, DYNAMIC };
+
+    struct Slot {
+        std::string field;  // C++ member of the state
+        Type type = Type::NONE;
+    };
+
+    struct Declaration {
+        const RecipeStmt* stmt;
+        std::string function;
+    };
+
+    // A generated expression: C++ text, and its type
+    struct Code {
+        std::string text;
+        Type type;
+    };
+
+    std::string sourceName;
+    std::map<std::string, Slot> slots;
+    std::vector<Declaration> declarations;
+    std::map<std::string, std::vector<size_t>> recipes;  // declarations by name
+
+    bool widened = false;
+    std::string output;
+    int indent = 0;
+    int temporaries = 0;
+
+    Slot& slotFor(const std::string& name);
+
+    // Type inference: each pass widens slots to fit every value stored in
+    // them, until a pass changes nothing
+    void collect(const std::vector<std::unique_ptr<Statement>>& statements, bool topLevel);
+    void inferStatement(const Statement* stmt);
+    Type infer(const Expression* expr);
+    void widen(const std::string& name, Type type);
+    static Type binaryType(BinaryExpr::Operator op, Type left, Type right);
+    static Type unaryType(UnaryExpr::Operator op, Type operand);
+
+    void line(const std::string& text);
+    void emitStatement(const Statement* stmt);
+    void emitRecipe(const Declaration& declaration);
+    Code emitExpression(const Expression* expr);
+    Code emitBinary(const BinaryExpr* expr);
+    Code emitCall(const CallExpr* expr);
+    Code temporary(const Code& code);
+    void checkDefined(const std::string& name);
+
+    static const char* cppType(Type type);
+    static std::string boxed(const Code& code);
+    static std::string converted(const Code& code, Type type);
+    static std::string quoted(const std::string& text);
+};
+
+} // namespace cook
+
+#endif // COOK_TRANSPILER_H
@@ -0,0 +1,71 @@
+#ifndef COOK_WATCH_H
+#define COOK_WATCH_H
+
+#include "interpreter.h"
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace cook {
+
+// Runs a script again each time it is saved (`cook --watch`).
+//
+// Every top-level statement that ran is remembered with a hash of its source
+// and the output it printed. The hashed source starts where the statement
+// before it ended, so comments and blank lines in between count too. After a
+// change, the statements up to the first one whose source differs are not
+// run again: their output comes from the cache, and the interpreter starts
+// from a saved state. Only the source after them is lexed and parsed.
+//
+// States are saved with Interpreter::saveState at the first changed
+// statement and every CHECKPOINT_INTERVAL statements. An edit anywhere in a
+// large file then replays at most that many unchanged statements, quietly,
+// before running the changed ones. Statements act only on the interpreter's
+// state and on their output, and both are cached. Cookbooks are loaded once
+// per process, so changes to them take a restart.
+class Watcher {
+public:
+    static const size_t CHECKPOINT_INTERVAL = 256;
+
+    Watcher(std::string path, const ExecutionBudget& budget);
+    ~Watcher();
+
+    Watcher(const Watcher&) = delete;
+    Watcher& operator=(const Watcher&) = delete;
+
+    // Run the script as it is on disk, reusing what has not changed. Output
+    // goes to 'out' and errors to 'err'; false if the script failed.
+    bool update(std::ostream& out, std::ostream& err);
+
+    // Statements of the last update() whose source had not changed
+    size_t reusedStatements() const { return reused; }
+
+    // Block until the file has been written again
+    void waitForChange();
+
+    // Run the script, then again after every change; returns the exit code
+    int run();
+
+private:
+    struct Entry {
+        size_t end;          // offset just past the statement
+        uint64_t hash;       // of the source from the previous entry's end
+        std::string output;
+    };
+
+    std::string path;
+    ExecutionBudget budget;
+    std::vector<Entry> entries;
+    std::map<size_t, std::string> checkpoints;  // state after the first N entries
+    size_t reused = 0;
+
+    int notifyFd = -1;
+    uint64_t lastSize = 0;
+    uint64_t lastModified = 0;
+};
+
+} // namespace cook
+
+#endif // COOK_WATCH_H
@@ -1,6 +1,24 @@
 #include "ast.h"
+#include <cerrno>
+#include <cstdlib>
 
 namespace cook {
-    // This file is mostly empty since our AST classes are primarily defined in the header
-    // We might add more complex functionality here as the language evolves
+
+LiteralExpr::LiteralExpr(Type type, const std::string& value) : type(type), value(value) {
+    if (type == Type::INTEGER) {
+        errno = 0;
+        long long parsed = std::strtoll(value.c_str(), nullptr, 10);
+        if (errno != ERANGE) {
+            integer = static_cast<int64_t>(parsed);
+            number = static_cast<double>(integer);
+            return;
+        }
+        this->type = Type::NUMBER;
+    }
+
+    if (this->type == Type::NUMBER) {
+        number = std::strtod(value.c_str(), nullptr);
+    }
+}
+
 } // namespace cook
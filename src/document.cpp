@@ -0,0 +1,363 @@
+#include "document.h"
+#include <algorithm>
+#include <unordered_set>
+
+namespace cook {
+
+namespace {
+
+// Whether one-based line:column falls on a name that starts at line:start
+bool covers(const std::string& name, int line, int start, int atLine, int atColumn) {
+    return line == atLine && atColumn >= start && atColumn <= start + static_cast<int>(name.size());
+}
+
+} // namespace
+
+Document::Document(std::string text) {
+    replace(std::move(text));
+}
+
+void Document::replace(std::string newText) {
+    text = std::move(newText);
+
+    lineStarts.assign(1, 0);
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '\n') lineStarts.push_back(i + 1);
+    }
+
+    index.clear();
+    segments.clear();
+    lexRegion(0, text.size(), segments);
+    for (const auto& segment : segments) {
+        addToIndex(segment.get());
+    }
+    rebuilt = segments.size();
+}
+
+void Document::edit(TextPosition from, TextPosition to, const std::string& replacement) {
+    size_t start = offsetOf(from);
+    size_t end = offsetOf(to);
+    if (end < start) std::swap(start, end);
+
+    if (segments.empty()) {
+        std::string newText = text;
+        newText.replace(start, end - start, replacement);
+        replace(std::move(newText));
+        return;
+    }
+
+    // Segments whose text changes; the edit is inserted at the front of the
+    // segment that starts at 'start'
+    size_t first = segmentAt(start);
+    size_t last = end > start ? segmentAt(end - 1) : first;
+
+    text.replace(start, end - start, replacement);
+    updateLineStarts(start, end, replacement);
+    for (size_t i = last + 1; i < segments.size(); i++) {
+        segments[i]->start = segments[i]->start + replacement.size() - (end - start);
+    }
+
+    rebuild(first, last);
+}
+
+std::vector<Diagnostic> Document::diagnostics() const {
+    std::vector<Diagnostic> result;
+    for (const auto& segment : segments) {
+        for (Diagnostic diagnostic : segment->diagnostics) {
+            toCurrent(*segment, diagnostic.line, diagnostic.column);
+            result.push_back(diagnostic);
+        }
+    }
+    return result;
+}
+
+std::vector<Symbol> Document::visibleSymbols(TextPosition position) const {
+    std::vector<Symbol> symbols;
+    std::unordered_set<std::string> seen;
+
+    if (!segments.empty()) {
+        const Segment& segment = *segments[segmentAt(offsetOf(position))];
+        if (segment.recipe) {
+            for (Symbol symbol : segment.locals) {
+                if (!seen.insert(symbol.name).second) continue;
+                toCurrent(segment, symbol.line, symbol.column);
+                symbols.push_back(symbol);
+            }
+        }
+    }
+
+    for (const auto& entry : index) {
+        if (seen.count(entry.first)) continue;
+        // Report the first definition in the document
+        const Segment* segment = entry.second.front();
+        for (const Segment* definer : entry.second) {
+            if (definer->start < segment->start) segment = definer;
+        }
+        for (Symbol symbol : segment->globals) {
+            if (symbol.name != entry.first) continue;
+            toCurrent(*segment, symbol.line, symbol.column);
+            symbols.push_back(symbol);
+            break;
+        }
+    }
+
+    std::sort(symbols.begin(), symbols.end(), [](const Symbol& a, const Symbol& b) {
+        return a.name < b.name;
+    });
+    return symbols;
+}
+
+std::vector<SymbolLocation> Document::definitions(TextPosition position, Reference& reference) const {
+    std::vector<SymbolLocation> result;
+    reference = Reference{"", false, 0, 0, ""};
+    if (segments.empty()) return result;
+
+    const Segment& segment = *segments[segmentAt(offsetOf(position))];
+    int line = position.line + 1;
+    int column = position.character + 1;
+    toLexed(segment, line, column);
+
+    // A definition resolves to itself
+    for (const auto* symbols : {&segment.globals, &segment.locals}) {
+        for (const auto& symbol : *symbols) {
+            if (!covers(symbol.name, symbol.line, symbol.column, line, column)) continue;
+            SymbolLocation location{symbol.kind, symbol.line, symbol.column};
+            toCurrent(segment, location.line, location.column);
+            reference = Reference{symbol.name, symbol.kind == Symbol::Kind::RECIPE, location.line, location.column,
+                                  symbol.scope};
+            result.push_back(location);
+            return result;
+        }
+    }
+
+    const Reference* found = nullptr;
+    for (const auto& candidate : segment.references) {
+        if (covers(candidate.name, candidate.line, candidate.column, line, column)) {
+            found = &candidate;
+            break;
+        }
+    }
+    if (!found) return result;
+
+    reference = *found;
+    toCurrent(segment, reference.line, reference.column);
+
+    // Parameters and ingredients of the enclosing recipe shadow globals
+    if (!found->call && segment.recipe) {
+        for (const auto& symbol : segment.locals) {
+            if (symbol.name != found->name) continue;
+            SymbolLocation location{symbol.kind, symbol.line, symbol.column};
+            toCurrent(segment, location.line, location.column);
+            result.push_back(location);
+        }
+        if (!result.empty()) return result;
+    }
+
+    Symbol::Kind kind = found->call ? Symbol::Kind::RECIPE : Symbol::Kind::INGREDIENT;
+    auto it = index.find(found->name);
+    if (it == index.end()) return result;
+
+    for (const Segment* definer : it->second) {
+        for (const auto& symbol : definer->globals) {
+            if (symbol.name != found->name || symbol.kind != kind) continue;
+            SymbolLocation location{symbol.kind, symbol.line, symbol.column};
+            toCurrent(*definer, location.line, location.column);
+            result.push_back(location);
+        }
+    }
+
+    std::sort(result.begin(), result.end(), [](const SymbolLocation& a, const SymbolLocation& b) {
+        return a.line < b.line || (a.line == b.line && a.column < b.column);
+    });
+    return result;
+}
+
+std::vector<std::string> Document::cookbooks() const {
+    std::vector<std::string> paths;
+    for (const auto& segment : segments) {
+        paths.insert(paths.end(), segment->cookbooks.begin(), segment->cookbooks.end());
+    }
+    return paths;
+}
+
+std::string_view Document::line(int index) const {
+    if (index < 0 || static_cast<size_t>(index) >= lineStarts.size()) return std::string_view();
+
+    size_t start = lineStarts[index];
+    size_t end = static_cast<size_t>(index) + 1 < lineStarts.size() ? lineStarts[index + 1] - 1 : text.size();
+    return std::string_view(text).substr(start, end - start);
+}
+
+size_t Document::offsetOf(TextPosition position) const {
+    if (position.line < 0) return 0;
+    if (static_cast<size_t>(position.line) >= lineStarts.size()) return text.size();
+
+    size_t start = lineStarts[position.line];
+    size_t lineEnd = static_cast<size_t>(position.line) + 1 < lineStarts.size()
+                   ? lineStarts[position.line + 1] - 1
+                   : text.size();
+    size_t character = position.character < 0 ? 0 : static_cast<size_t>(position.character);
+    return std::min(start + character, lineEnd);
+}
+
+TextPosition Document::positionOf(size_t offset) const {
+    auto it = std::upper_bound(lineStarts.begin(), lineStarts.end(), offset) - 1;
+    return TextPosition{static_cast<int>(it - lineStarts.begin()), static_cast<int>(offset - *it)};
+}
+
+size_t Document::segmentAt(size_t offset) const {
+    auto it = std::upper_bound(segments.begin(), segments.end(), offset,
+                               [](size_t value, const std::unique_ptr<Segment>& segment) {
+                                   return value < segment->start;
+                               });
+    return it == segments.begin() ? 0 : static_cast<size_t>(it - segments.begin()) - 1;
+}
+
+void Document::updateLineStarts(size_t start, size_t end, const std::string& replacement) {
+    // Line starts inside the replaced range go away, the replacement adds its own
+    size_t low = std::upper_bound(lineStarts.begin(), lineStarts.end(), start) - lineStarts.begin();
+    size_t high = std::upper_bound(lineStarts.begin(), lineStarts.end(), end) - lineStarts.begin();
+
+    for (size_t i = high; i < lineStarts.size(); i++) {
+        lineStarts[i] = lineStarts[i] + replacement.size() - (end - start);
+    }
+
+    std::vector<size_t> added;
+    for (size_t i = 0; i < replacement.size(); i++) {
+        if (replacement[i] == '\n') added.push_back(start + i + 1);
+    }
+
+    lineStarts.erase(lineStarts.begin() + low, lineStarts.begin() + high);
+    lineStarts.insert(lineStarts.begin() + low, added.begin(), added.end());
+}
+
+void Document::rebuild(size_t first, size_t last) {
+    size_t start = segments[first]->start;
+    size_t next = last + 1;
+    size_t step = 1;
+    std::vector<std::unique_ptr<Segment>> built;
+
+    while (true) {
+        built.clear();
+        size_t end = next < segments.size() ? segments[next]->start : text.size();
+        if (lexRegion(start, end, built)) break;
+
+        // The edit changed how the following text lexes (an unclosed string,
+        // comment or brace), so take in more segments, doubling each time
+        next = std::min(next + step, segments.size());
+        step *= 2;
+    }
+
+    for (size_t i = first; i < next; i++) {
+        removeFromIndex(segments[i].get());
+    }
+    segments.erase(segments.begin() + first, segments.begin() + next);
+    for (const auto& segment : built) {
+        addToIndex(segment.get());
+    }
+    rebuilt = built.size();
+    segments.insert(segments.begin() + first,
+                    std::make_move_iterator(built.begin()), std::make_move_iterator(built.end()));
+}
+
+bool Document::lexRegion(size_t start, size_t end, std::vector<std::unique_ptr<Segment>>& built) const {
+    TextPosition at = positionOf(start);
+    Lexer lexer(text.substr(start, end - start), at.line + 1, at.character + 1);
+    std::vector<Token> tokens = lexer.tokenize();
+    Token eof = tokens.back();
+    tokens.pop_back();
+
+    int depth = 0;
+    size_t groupStart = 0;
+    size_t segmentStart = start;
+
+    for (size_t i = 0; i < tokens.size(); i++) {
+        const Token& token = tokens[i];
+        bool terminator = false;
+        if (token.type == TokenType::LBRACE) {
+            depth++;
+        } else if (token.type == TokenType::RBRACE) {
+            if (depth > 0) depth--;
+            terminator = depth == 0;
+        } else if (token.type == TokenType::SEMICOLON) {
+            terminator = depth == 0;
+        }
+        if (!terminator) continue;
+
+        std::vector<Token> group(tokens.begin() + groupStart, tokens.begin() + i + 1);
+        group.push_back(Token(TokenType::EOF_TOKEN, "", token.line, token.column + 1));
+        built.push_back(buildSegment(segmentStart, std::move(group)));
+
+        segmentStart = offsetOf(TextPosition{token.line - 1, token.column - 1}) + 1;
+        groupStart = i + 1;
+    }
+
+    // The region must end exactly where a statement does, unless it runs to
+    // the end of the document
+    if (groupStart < tokens.size() || segmentStart < end) {
+        if (end != text.size()) return false;
+
+        std::vector<Token> group(tokens.begin() + groupStart, tokens.end());
+        group.push_back(eof);
+        built.push_back(buildSegment(segmentStart, std::move(group)));
+    }
+
+    return true;
+}
+
+std::unique_ptr<Document::Segment> Document::buildSegment(size_t start, std::vector<Token> tokens) const {
+    auto segment = std::make_unique<Segment>();
+    segment->start = start;
+    TextPosition at = positionOf(start);
+    segment->lexedLine = at.line + 1;
+    segment->lexedColumn = at.character + 1;
+
+    Parser parser(tokens);
+    std::unique_ptr<Program> program = parser.parse();
+    segment->diagnostics = parser.getDiagnostics();
+    segment->statements = std::move(program->statements);
+
+    SymbolCollector collector(tokens);
+    for (const auto& stmt : segment->statements) {
+        collector.collect(stmt.get());
+        if (dynamic_cast<const RecipeStmt*>(stmt.get())) segment->recipe = true;
+    }
+    segment->globals = std::move(collector.globals);
+    segment->locals = std::move(collector.locals);
+    segment->references = std::move(collector.references);
+    segment->cookbooks = std::move(collector.cookbooks);
+
+    return segment;
+}
+
+void Document::addToIndex(const Segment* segment) {
+    for (const auto& symbol : segment->globals) {
+        auto& definers = index[symbol.name];
+        if (definers.empty() || definers.back() != segment) definers.push_back(segment);
+    }
+}
+
+void Document::removeFromIndex(const Segment* segment) {
+    for (const auto& symbol : segment->globals) {
+        auto it = index.find(symbol.name);
+        if (it == index.end()) continue;
+
+        auto& definers = it->second;
+        definers.erase(std::remove(definers.begin(), definers.end(), segment), definers.end());
+        if (definers.empty()) index.erase(it);
+    }
+}
+
+void Document::toCurrent(const Segment& segment, int& line, int& column) const {
+    TextPosition at = positionOf(segment.start);
+    if (line == segment.lexedLine) column += at.character + 1 - segment.lexedColumn;
+    line += at.line + 1 - segment.lexedLine;
+}
+
+void Document::toLexed(const Segment& segment, int& line, int& column) const {
+    TextPosition at = positionOf(segment.start);
+    if (line == at.line + 1) column += segment.lexedColumn - (at.character + 1);
+    line += segment.lexedLine - (at.line + 1);
+}
+
+} // namespace cook
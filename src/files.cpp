@@ -0,0 +1,198 @@
+#include "files.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace cook {
+
+bool readWholeFile(const std::string& path, std::string& contents) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return false;
+
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    contents = buffer.str();
+    return true;
+}
+
+bool isDirectory(const std::string& path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 && (info.st_mode & S_IFMT) == S_IFDIR;
+}
+
+bool fileStatus(const std::string& path, uint64_t& size, uint64_t& modified) {
+    struct stat info;
+    if (stat(path.c_str(), &info) != 0) return false;
+
+    size = static_cast<uint64_t>(info.st_size);
+#if defined(__linux__)
+    modified = static_cast<uint64_t>(info.st_mtim.tv_sec) * 1000000000ull + info.st_mtim.tv_nsec;
+#elif defined(__APPLE__)
+    modified = static_cast<uint64_t>(info.st_mtimespec.tv_sec) * 1000000000ull + info.st_mtimespec.tv_nsec;
+#else
+    modified = static_cast<uint64_t>(info.st_mtime) * 1000000000ull;
+#endif
+    return true;
+}
+
+static bool hasCookExtension(const std::string& name) {
+    return name.size() > 5 && name.compare(name.size() - 5, 5, ".cook") == 0;
+}
+
+static void collectCookFiles(const std::string& directory, std::vector<std::string>& files) {
+#ifdef _WIN32
+    WIN32_FIND_DATAA entry;
+    HANDLE handle = FindFirstFileA((directory + "\\*").c_str(), &entry);
+    if (handle == INVALID_HANDLE_VALUE) return;
+
+    do {
+        std::string name = entry.cFileName;
+        if (name == "." || name == "..") continue;
+
+        std::string path = directory + "/" + name;
+        if (entry.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
+            collectCookFiles(path, files);
+        } else if (hasCookExtension(name)) {
+            files.push_back(path);
+        }
+    } while (FindNextFileA(handle, &entry));
+    FindClose(handle);
+#else
+    DIR* dir = opendir(directory.c_str());
+    if (!dir) return;
+
+    while (struct dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name == "." || name == "..") continue;
+
+        std::string path = directory + "/" + name;
+        if (isDirectory(path)) {
+            collectCookFiles(path, files);
+        } else if (hasCookExtension(name)) {
+            files.push_back(path);
+        }
+    }
+    closedir(dir);
+#endif
+}
+
+uint64_t contentHash(const std::string& data) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : data) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+std::vector<std::string> findCookFiles(const std::string& root) {
+    std::vector<std::string> files;
+    collectCookFiles(root, files);
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const std::string& path) {
+    close();
+
+#ifdef _WIN32
+    HANDLE handle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                                FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (handle == INVALID_HANDLE_VALUE) return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(handle, &fileSize)) {
+        CloseHandle(handle);
+        return false;
+    }
+    file = handle;
+    length = static_cast<size_t>(fileSize.QuadPart);
+    if (length == 0) {
+        bytes = "";
+        return true;
+    }
+
+    mapping = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapping) {
+        close();
+        return false;
+    }
+    bytes = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!bytes) {
+        close();
+        return false;
+    }
+    return true;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+    length = static_cast<size_t>(info.st_size);
+    if (length == 0) {
+        ::close(fd);
+        bytes = "";
+        return true;
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    void* memory = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (memory == MAP_FAILED) {
+        length = 0;
+        return false;
+    }
+    bytes = static_cast<const char*>(memory);
+    return true;
+#endif
+}
+
+void MappedFile::adviseSequential() {
+#ifndef _WIN32
+    if (bytes && length > 0) madvise(const_cast<char*>(bytes), length, MADV_SEQUENTIAL);
+#endif
+}
+
+void MappedFile::release(size_t offset) {
+#ifndef _WIN32
+    size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t end = std::min(offset, length) / page * page;
+    if (bytes && end > 0) madvise(const_cast<char*>(bytes), end, MADV_DONTNEED);
+#else
+    (void)offset;
+#endif
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (bytes && length > 0) UnmapViewOfFile(bytes);
+    if (mapping) CloseHandle(mapping);
+    if (file) CloseHandle(file);
+    mapping = nullptr;
+    file = nullptr;
+#else
+    if (bytes && length > 0) munmap(const_cast<char*>(bytes), length);
+#endif
+    bytes = nullptr;
+    length = 0;
+}
+
+} // namespace cook
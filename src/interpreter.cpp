@@ -1,43 +1,488 @@
 #include "interpreter.h"
+#include "pantry.h"
+#include "serializer.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <sstream>
 #include <stdexcept>
+#include <thread>
 
 namespace cook {
 
+// Tracks recipe nesting, including calls that unwind with an error
+class CallDepthScope {
+public:
+    CallDepthScope(int& depth) : depth(depth) { ++depth; }
+    ~CallDepthScope() { --depth; }
+
+private:
+    int& depth;
+};
+
+// Keeps the interpreter's count of string bytes held by saved environments
+class SavedBytesScope {
+public:
+    SavedBytesScope(size_t& total, size_t bytes) : total(total), bytes(bytes) { total += bytes; }
+    ~SavedBytesScope() { total -= bytes; }
+
+private:
+    size_t& total;
+    size_t bytes;
+};
+
+// The interpreter and call of the native recipe running on this thread, for
+// native::reserveString
+static thread_local Interpreter* nativeCaller = nullptr;
+static thread_local const CallExpr* nativeCall = nullptr;
+
+class NativeCallScope {
+public:
+    NativeCallScope(Interpreter* caller, const CallExpr* call)
+        : previousCaller(nativeCaller), previousCall(nativeCall) {
+        nativeCaller = caller;
+        nativeCall = call;
+    }
+    ~NativeCallScope() {
+        nativeCaller = previousCaller;
+        nativeCall = previousCall;
+    }
+
+private:
+    Interpreter* previousCaller;
+    const CallExpr* previousCall;
+};
+
+// Lets variable reads return views of the stored strings while an expression
+// that cannot change the environment is evaluated
+class BorrowScope {
+public:
+    BorrowScope(bool& borrowing, bool enabled) : borrowing(borrowing) { borrowing = enabled; }
+    ~BorrowScope() { borrowing = false; }
+
+private:
+    bool& borrowing;
+};
+
+// Whether evaluating an expression can assign or define a variable: only
+// assignments and calls, which run recipe bodies, can
+static bool mayChangeEnvironment(const Expression* expr) {
+    if (auto binaryExpr = dynamic_cast<const BinaryExpr*>(expr)) {
+        return mayChangeEnvironment(binaryExpr->left.get()) || mayChangeEnvironment(binaryExpr->right.get());
+    } else if (auto unaryExpr = dynamic_cast<const UnaryExpr*>(expr)) {
+        return mayChangeEnvironment(unaryExpr->operand.get());
+    }
+    return dynamic_cast<const AssignExpr*>(expr) || dynamic_cast<const CallExpr*>(expr);
+}
+
+namespace native {
+
+void wrongArgument(const std::string& recipe, size_t position, const char* expected) {
+    throw std::runtime_error("Argument " + std::to_string(position) + " of '" + recipe + "' must be " +
+                             expected);
+}
+
+void reserveString(size_t bytes) {
+    if (nativeCaller && nativeCaller->budget.maxStringBytes) {
+        nativeCaller->checkStringBytes(nativeCall, bytes);
+    }
+}
+
+} // namespace native
+
+// Steps between checks of the clock and the step limit
+static const uint64_t BUDGET_CHECK_INTERVAL = 4096;
+
+// Largest run of parallel calls, per thread of the pool
+static const size_t CALLS_PER_THREAD = 4;
+
 // Environment implementation
 void Environment::define(const std::string& name, const Value& value) {
-    values[name] = value;
+    Value& slot = values[name];
+    if (slot.isString()) bytes -= slot.stringSize();
+    slot = value.promoted();
+    if (slot.isString()) bytes += slot.stringSize();
 }
 
-Value Environment::get(const std::string& name) {
+const Value* Environment::find(const std::string& name) const {
     auto it = values.find(name);
-    if (it != values.end()) {
-        return it->second;
+    if (it != values.end()) return &it->second;
+    return shared ? shared->find(name) : nullptr;
+}
+
+const Value& Environment::get(const std::string& name) {
+    COOK_STAT_ADD(environmentLookups, 1);
+    if (const Value* value = find(name)) {
+        return *value;
     }
 
+    COOK_STAT_ADD(environmentMisses, 1);
     throw std::runtime_error("Undefined ingredient '" + name + "'");
 }
 
 void Environment::assign(const std::string& name, const Value& value) {
+    COOK_STAT_ADD(environmentLookups, 1);
     auto it = values.find(name);
     if (it != values.end()) {
-        it->second = value;
+        if (it->second.isString()) bytes -= it->second.stringSize();
+        it->second = value.promoted();
+        if (it->second.isString()) bytes += it->second.stringSize();
+        return;
+    }
+
+    // The shared environment is read-only; its value is shadowed here
+    if (shared && shared->find(name)) {
+        define(name, value);
         return;
     }
 
+    COOK_STAT_ADD(environmentMisses, 1);
     throw std::runtime_error("Undefined ingredient '" + name + "'");
 }
 
 // Interpreter implementation
-Interpreter::Interpreter() {}
+Interpreter::Interpreter() : out(&std::cout) {}
 
 void Interpreter::interpret(const Program& program) {
-    for (const auto& stmt : program.statements) {
-        executeStatement(stmt.get());
+    interpret(program, 0, program.statements.size());
+}
+
+void Interpreter::interpret(const Program& program, size_t first, size_t last) {
+    startRun();
+    last = std::min(last, program.statements.size());
+    bool parallel = runsInParallel();
+    std::vector<CallAccess> accesses;
+
+    // Independent calls run a few per thread at a time, so their output
+    // appears as the run goes and only one batch of it is held at once
+    size_t batch = 0;
+    if (parallel) {
+        if (!pool) pool = std::make_unique<ThreadPool>(jobs);
+        batch = pool->size() * CALLS_PER_THREAD;
+    }
+
+    size_t i = first;
+    while (i < last) {
+        if (parallel && independentCalls(program, i, std::min(last, i + batch), accesses) >= 2) {
+            interpretParallel(program, i, accesses);
+            i += accesses.size();
+        } else {
+            interpretStatement(*program.statements[i]);
+            i++;
+        }
+    }
+}
+
+void Interpreter::startRun() {
+    region.reset();
+    startBudget();
+}
+
+void Interpreter::interpretStatement(const Statement& stmt) {
+    executeStatement(&stmt);
+
+    // Values that outlive a top-level statement have been promoted into the
+    // environment, so its transient strings can all be dropped
+    region.reset();
+}
+
+// Ingredients a top-level call reads, and those its arguments assign, which
+// are the only writes that outlive the call
+struct Interpreter::CallAccess {
+    std::unordered_set<std::string> reads;
+    std::unordered_set<std::string> writes;
+    std::unordered_set<const Recipe*> recipes;  // bodies already analyzed
+};
+
+// Profiles, budgets and the counters of a COOK_STATS build all follow the
+// steps in the order they are taken
+bool Interpreter::runsInParallel() const {
+#ifdef COOK_STATS
+    return false;
+#else
+    size_t threads = jobs ? jobs : std::thread::hardware_concurrency();
+    return threads > 1 && !parent && !profiler && !budget.maxSteps && !budget.maxMillis &&
+           !budget.maxCallDepth && !budget.maxStringBytes;
+#endif
+}
+
+// Number of statements from 'first' on that are calls which can run at the
+// same time: no call writes an ingredient that another reads or writes
+size_t Interpreter::independentCalls(const Program& program, size_t first, size_t last,
+                                     std::vector<CallAccess>& accesses) {
+    accesses.clear();
+    std::unordered_set<std::string> reads;
+    std::unordered_set<std::string> writes;
+
+    for (size_t i = first; i < last; i++) {
+        CallAccess access;
+        if (!analyzeCall(program.statements[i].get(), access)) break;
+
+        bool conflicts = false;
+        for (const auto& name : access.writes) {
+            if (reads.count(name) || writes.count(name)) conflicts = true;
+        }
+        for (const auto& name : access.reads) {
+            if (writes.count(name)) conflicts = true;
+        }
+        if (conflicts) break;
+
+        reads.insert(access.reads.begin(), access.reads.end());
+        writes.insert(access.writes.begin(), access.writes.end());
+        accesses.push_back(std::move(access));
+    }
+    return accesses.size();
+}
+
+// Whether 'stmt' is a recipe call that a worker can run
+bool Interpreter::analyzeCall(const Statement* stmt, CallAccess& access) {
+    auto exprStmt = dynamic_cast<const ExpressionStmt*>(stmt);
+    if (!exprStmt || !dynamic_cast<const CallExpr*>(exprStmt->expression.get())) return false;
+    return analyzeExpression(exprStmt->expression.get(), true, access);
+}
+
+// 'persistent' is false inside recipe bodies, whose assignments are undone
+// when the call returns
+bool Interpreter::analyzeExpression(const Expression* expr, bool persistent, CallAccess& access) {
+    if (auto variableExpr = dynamic_cast<const VariableExpr*>(expr)) {
+        access.reads.insert(variableExpr->name);
+    } else if (auto binaryExpr = dynamic_cast<const BinaryExpr*>(expr)) {
+        return analyzeExpression(binaryExpr->left.get(), persistent, access) &&
+               analyzeExpression(binaryExpr->right.get(), persistent, access);
+    } else if (auto unaryExpr = dynamic_cast<const UnaryExpr*>(expr)) {
+        return analyzeExpression(unaryExpr->operand.get(), persistent, access);
+    } else if (auto assignExpr = dynamic_cast<const AssignExpr*>(expr)) {
+        if (persistent) access.writes.insert(assignExpr->name);
+        return analyzeExpression(assignExpr->value.get(), persistent, access);
+    } else if (auto callExpr = dynamic_cast<const CallExpr*>(expr)) {
+        for (const auto& arg : callExpr->arguments) {
+            if (!analyzeExpression(arg.get(), persistent, access)) return false;
+        }
+
+        // Calls that fail are left to run in order, where they report the
+        // error; this also materializes cookbook recipes before any worker
+        // looks them up
+        const Recipe* recipe = findRecipe(callExpr->callee);
+        if (!recipe) {
+            const NativeRecipe* native = findNative(callExpr->callee);
+            return native && native->arity() == callExpr->arguments.size();
+        }
+        if (recipe->parameters.size() != callExpr->arguments.size()) return false;
+        return analyzeRecipe(*recipe, access);
+    }
+    return true;
+}
+
+// Reads of a recipe body, which include its parameters and local
+// ingredients; treating those as globals only makes the analysis stricter
+bool Interpreter::analyzeRecipe(const Recipe& recipe, CallAccess& access) {
+    if (!access.recipes.insert(&recipe).second) return true;
+
+    for (const auto& stmt : recipe.body) {
+        const Expression* expr = nullptr;
+        if (auto exprStmt = dynamic_cast<const ExpressionStmt*>(stmt.get())) {
+            expr = exprStmt->expression.get();
+        } else if (auto tasteStmt = dynamic_cast<const TasteStmt*>(stmt.get())) {
+            expr = tasteStmt->expression.get();
+        } else if (auto ingredientStmt = dynamic_cast<const IngredientStmt*>(stmt.get())) {
+            expr = ingredientStmt->initializer.get();
+        } else {
+            // A cookbook adds recipes, which only the parent can do
+            return false;
+        }
+        if (expr && !analyzeExpression(expr, false, access)) return false;
+    }
+    return true;
+}
+
+// Run the calls starting at statement 'first' on the pool, each writing to
+// its own buffer. The buffers and the ingredients the calls assign are then
+// applied in program order. A call that failed runs again in order, with
+// the ones after it, so its output and error are those of a serial run.
+void Interpreter::interpretParallel(const Program& program, size_t first,
+                                    const std::vector<CallAccess>& accesses) {
+    struct Result {
+        std::ostringstream output;
+        std::vector<std::pair<std::string, Value>> written;
+        bool failed = false;
+    };
+    std::vector<Result> results(accesses.size());
+
+    for (size_t i = 0; i < accesses.size(); i++) {
+        pool->submit([this, &program, &accesses, &results, first, i] {
+            Result& result = results[i];
+            try {
+                Interpreter worker;
+                worker.parent = this;
+                worker.environment = Environment(&environment);
+                worker.baseDirectory = baseDirectory;
+                worker.out = &result.output;
+                worker.startRun();
+                worker.interpretStatement(*program.statements[first + i]);
+
+                for (const auto& name : accesses[i].writes) {
+                    result.written.emplace_back(name, worker.environment.get(name));
+                }
+            } catch (...) {
+                result.failed = true;
+            }
+        });
+    }
+    pool->wait();
+
+    for (size_t i = 0; i < results.size(); i++) {
+        if (results[i].failed) {
+            for (size_t j = first + i; j < first + results.size(); j++) {
+                interpretStatement(*program.statements[j]);
+            }
+            return;
+        }
+
+        std::string text = results[i].output.str();
+        out->write(text.data(), static_cast<std::streamsize>(text.size()));
+        out->flush();
+        for (const auto& entry : results[i].written) {
+            environment.assign(entry.first, entry.second);
+        }
+    }
+}
+
+// Names of a map's keys in sorted order, so snapshots of the same state are
+// byte-identical
+template <typename Map>
+static std::vector<std::string> sortedKeys(const Map& map) {
+    std::vector<std::string> keys;
+    keys.reserve(map.size());
+    for (const auto& entry : map) {
+        keys.push_back(entry.first);
+    }
+    std::sort(keys.begin(), keys.end());
+    return keys;
+}
+
+void Interpreter::saveState(AstWriter& writer) const {
+    const auto& values = environment.entries();
+    writer.writeU32(static_cast<uint32_t>(values.size()));
+    for (const auto& name : sortedKeys(values)) {
+        const Value& value = values.at(name);
+        writer.writeString(name);
+        if (value.isInteger()) {
+            writer.writeU8(2);
+            writer.writeU64(static_cast<uint64_t>(value.getInteger()));
+        } else if (value.isNumber()) {
+            double number = value.getNumber();
+            uint64_t bits;
+            std::memcpy(&bits, &number, sizeof(bits));
+            writer.writeU8(0);
+            writer.writeU64(bits);
+        } else {
+            writer.writeU8(1);
+            writer.writeString(std::string(value.stringData(), value.stringSize()));
+        }
+    }
+
+    writer.writeU32(static_cast<uint32_t>(recipes.size()));
+    for (const auto& name : sortedKeys(recipes)) {
+        const Recipe& recipe = recipes.at(name);
+        writer.writeString(name);
+        writer.writeU32(static_cast<uint32_t>(recipe.parameters.size()));
+        for (const auto& parameter : recipe.parameters) {
+            writer.writeString(parameter);
+        }
+        writer.writeU32(static_cast<uint32_t>(recipe.body.size()));
+        for (const auto& stmt : recipe.body) {
+            writer.writeStatement(stmt.get());
+        }
+    }
+
+    // Cookbooks are stored by path and loaded again on restore
+    std::vector<std::string> modulePaths;
+    for (const Module* module : importedModules) {
+        modulePaths.push_back(module->getPath());
+    }
+    std::sort(modulePaths.begin(), modulePaths.end());
+    writer.writeU32(static_cast<uint32_t>(modulePaths.size()));
+    for (const auto& path : modulePaths) {
+        writer.writeString(path);
+    }
+
+    writer.writeU32(static_cast<uint32_t>(pendingRecipes.size()));
+    for (const auto& name : sortedKeys(pendingRecipes)) {
+        writer.writeString(name);
+        writer.writeString(pendingRecipes.at(name)->getPath());
+    }
+
+    // Native recipes come back with their built-in cookbooks; those the
+    // host defined are its to define again
+    std::vector<std::string> builtins(builtinImports.begin(), builtinImports.end());
+    std::sort(builtins.begin(), builtins.end());
+    writer.writeU32(static_cast<uint32_t>(builtins.size()));
+    for (const auto& path : builtins) {
+        writer.writeString(path);
+    }
+}
+
+void Interpreter::restoreState(AstReader& reader) {
+    environment = Environment();
+    recipes.clear();
+    importedModules.clear();
+    pendingRecipes.clear();
+
+    uint32_t valueCount = reader.readU32();
+    for (uint32_t i = 0; i < valueCount; i++) {
+        std::string name = reader.readString();
+        uint8_t type = reader.readU8();
+        if (type == 2) {
+            environment.define(name, Value::integer(static_cast<int64_t>(reader.readU64())));
+        } else if (type == 0) {
+            uint64_t bits = reader.readU64();
+            double number;
+            std::memcpy(&number, &bits, sizeof(number));
+            environment.define(name, number);
+        } else {
+            environment.define(name, reader.readString());
+        }
+    }
+
+    uint32_t recipeCount = reader.readU32();
+    for (uint32_t i = 0; i < recipeCount; i++) {
+        std::string name = reader.readString();
+        std::vector<std::string> parameters(reader.readU32());
+        for (auto& parameter : parameters) {
+            parameter = reader.readString();
+        }
+        std::vector<std::unique_ptr<Statement>> body(reader.readU32());
+        for (auto& stmt : body) {
+            stmt = reader.readStatement();
+        }
+        recipes[name] = Recipe(std::move(parameters), std::move(body));
+    }
+
+    uint32_t moduleCount = reader.readU32();
+    for (uint32_t i = 0; i < moduleCount; i++) {
+        importedModules.insert(&ModuleCache::instance().load(reader.readString()));
+    }
+
+    uint32_t pendingCount = reader.readU32();
+    for (uint32_t i = 0; i < pendingCount; i++) {
+        std::string name = reader.readString();
+        pendingRecipes[name] = &ModuleCache::instance().load(reader.readString());
+    }
+
+    builtinImports.clear();
+    uint32_t builtinCount = reader.readU32();
+    for (uint32_t i = 0; i < builtinCount; i++) {
+        importBuiltin(reader.readString());
     }
 }
 
 void Interpreter::executeStatement(const Statement* stmt) {
+    COOK_STAT_ADD(nodesEvaluated, 1);
+    if (--fuel < 0) refuel(stmt);
+    if (profiler) profiler->enterStatement(stmt->line);
+    ProfileScope scope(profiler);
+
     if (auto exprStmt = dynamic_cast<const ExpressionStmt*>(stmt)) {
         executeExpressionStmt(exprStmt);
     } else if (auto ingredientStmt = dynamic_cast<const IngredientStmt*>(stmt)) {
@@ -46,6 +491,8 @@ void Interpreter::executeStatement(const Statement* stmt) {
         executeRecipeStmt(recipeStmt);
     } else if (auto tasteStmt = dynamic_cast<const TasteStmt*>(stmt)) {
         executeTasteStmt(tasteStmt);
+    } else if (auto cookbookStmt = dynamic_cast<const CookbookStmt*>(stmt)) {
+        executeCookbookStmt(cookbookStmt);
     } else {
         throw std::runtime_error("Unknown statement type");
     }
@@ -73,6 +520,8 @@ void Interpreter::executeRecipeStmt(const RecipeStmt* stmt) {
 
     // Deep copy the body statements
     for (const auto& statement : stmt->body) {
+        size_t copied = bodyCopy.size();
+
         if (auto exprStmt = dynamic_cast<const ExpressionStmt*>(statement.get())) {
             bodyCopy.push_back(std::make_unique<ExpressionStmt>(
                 std::unique_ptr<Expression>(exprStmt->expression->clone())));
@@ -84,34 +533,81 @@ void Interpreter::executeRecipeStmt(const RecipeStmt* stmt) {
                 ingredientStmt->name,
                 ingredientStmt->initializer ?
                     std::unique_ptr<Expression>(ingredientStmt->initializer->clone()) : nullptr));
+        } else if (auto cookbookStmt = dynamic_cast<const CookbookStmt*>(statement.get())) {
+            bodyCopy.push_back(std::make_unique<CookbookStmt>(cookbookStmt->path));
         }
         // We're skipping nested recipes for simplicity
+
+        if (bodyCopy.size() > copied) {
+            bodyCopy.back()->setLocation(statement->line, statement->column);
+        }
     }
 
     recipes[stmt->name] = Recipe(stmt->parameters, std::move(bodyCopy));
 
-    std::cout << "Recipe '" << stmt->name << "' defined with "
+    *out << "Recipe '" << stmt->name << "' defined with "
               << stmt->parameters.size() << " parameters" << std::endl;
 }
 
 void Interpreter::executeTasteStmt(const TasteStmt* stmt) {
+    BorrowScope borrow(borrowVariables, !mayChangeEnvironment(stmt->expression.get()));
     Value value = evaluateExpression(stmt->expression.get());
 
     // Print the value
-    if (value.isNumber()) {
-        std::cout << value.getNumber() << std::endl;
+    if (value.isInteger()) {
+        *out << value.getInteger() << std::endl;
+    } else if (value.isNumber()) {
+        *out << value.getNumber() << std::endl;
     } else if (value.isString()) {
-        std::cout << value.getString() << std::endl;
+        out->write(value.stringData(), static_cast<std::streamsize>(value.stringSize()));
+        *out << std::endl;
+    }
+}
+
+void Interpreter::executeCookbookStmt(const CookbookStmt* stmt) {
+    if (isBuiltinCookbook(stmt->path)) {
+        importBuiltin(stmt->path);
+        return;
+    }
+
+    const Module& module = ModuleCache::instance().load(
+        resolveModulePath(baseDirectory, stmt->path));
+
+    // Importing the same cookbook twice is a no-op
+    if (!importedModules.insert(&module).second) return;
+
+    for (const auto& name : module.getRecipeNames()) {
+        pendingRecipes[name] = &module;
+    }
+
+    for (const auto& statement : module.getPrelude()) {
+        executeStatement(statement.get());
+    }
+}
+
+void Interpreter::importBuiltin(const std::string& path) {
+    const std::vector<NativeDefinition>* definitions = builtinCookbook(path);
+    if (!definitions) {
+        throw std::runtime_error("Unknown built-in cookbook '" + path + "'");
+    }
+    if (!builtinImports.insert(path).second) return;
+
+    for (const auto& definition : *definitions) {
+        natives.insert_or_assign(definition.name, definition.recipe);
     }
 }
 
 Value Interpreter::evaluateExpression(const Expression* expr) {
+    COOK_STAT_ADD(nodesEvaluated, 1);
+
     if (auto literalExpr = dynamic_cast<const LiteralExpr*>(expr)) {
         return evaluateLiteralExpr(literalExpr);
     } else if (auto variableExpr = dynamic_cast<const VariableExpr*>(expr)) {
         return evaluateVariableExpr(variableExpr);
     } else if (auto binaryExpr = dynamic_cast<const BinaryExpr*>(expr)) {
         return evaluateBinaryExpr(binaryExpr);
+    } else if (auto unaryExpr = dynamic_cast<const UnaryExpr*>(expr)) {
+        return evaluateUnaryExpr(unaryExpr);
     } else if (auto assignExpr = dynamic_cast<const AssignExpr*>(expr)) {
         return evaluateAssignExpr(assignExpr);
     } else if (auto callExpr = dynamic_cast<const CallExpr*>(expr)) {
@@ -122,27 +618,151 @@ Value Interpreter::evaluateExpression(const Expression* expr) {
 }
 
 Value Interpreter::evaluateLiteralExpr(const LiteralExpr* expr) {
-    if (expr->type == LiteralExpr::Type::NUMBER) {
-        return std::stod(expr->value);
-    } else {
-        return expr->value;
+    switch (expr->type) {
+        case LiteralExpr::Type::INTEGER:
+            return Value::integer(expr->integer);
+        case LiteralExpr::Type::NUMBER:
+            return expr->number;
+        default:
+            return Value::borrowed(expr->value.data(), expr->value.size());
     }
 }
 
 Value Interpreter::evaluateVariableExpr(const VariableExpr* expr) {
-    return environment.get(expr->name);
+    const Value& value = environment.get(expr->name);
+    if (value.isNumber()) {
+        return value;
+    }
+
+    if (borrowVariables) {
+        return Value::borrowed(value.stringData(), value.stringSize());
+    }
+
+    // The stored string can be replaced by a recipe call before the current
+    // statement finishes, so hand out a region copy rather than a view
+    COOK_STAT_ADD(stringBytesCopied, value.stringSize());
+    return Value::borrowed(region.copy(value.stringData(), value.stringSize()), value.stringSize());
+}
+
+Value Interpreter::evaluateUnaryExpr(const UnaryExpr* expr) {
+    Value operand = evaluateExpression(expr->operand.get());
+
+    if (expr->op == UnaryExpr::Operator::NOT) {
+        // 0 and the empty string are false
+        bool isFalse = operand.isInteger() ? operand.getInteger() == 0
+                     : operand.isNumber() ? operand.getNumber() == 0
+                     : operand.stringSize() == 0;
+        return Value::integer(isFalse ? 1 : 0);
+    }
+
+    if (!operand.isNumber()) {
+        throw std::runtime_error("Operand of '-' must be a number");
+    }
+    if (operand.isInteger() && operand.getInteger() != INT64_MIN) {
+        return Value::integer(-operand.getInteger());
+    }
+    return -operand.getNumber();
+}
+
+// Comparison results are integers: 1 for true, 0 for false
+static Value truth(bool value) {
+    return Value::integer(value ? 1 : 0);
+}
+
+// Integer arithmetic that reports overflow instead of wrapping
+static bool addOverflows(int64_t a, int64_t b, int64_t& result) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_add_overflow(a, b, &result);
+#else
+    if ((b > 0 && a > INT64_MAX - b) || (b < 0 && a < INT64_MIN - b)) return true;
+    result = a + b;
+    return false;
+#endif
+}
+
+static bool subtractOverflows(int64_t a, int64_t b, int64_t& result) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_sub_overflow(a, b, &result);
+#else
+    if ((b < 0 && a > INT64_MAX + b) || (b > 0 && a < INT64_MIN + b)) return true;
+    result = a - b;
+    return false;
+#endif
+}
+
+static bool multiplyOverflows(int64_t a, int64_t b, int64_t& result) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_mul_overflow(a, b, &result);
+#else
+    if (a != 0 && b != 0) {
+        if ((a == -1 && b == INT64_MIN) || (b == -1 && a == INT64_MIN)) return true;
+        if (a != -1 && b != -1 && (a * b) / b != a) return true;
+    }
+    result = a * b;
+    return false;
+#endif
+}
+
+// Operations on two integers that have an exact integer result; false when
+// the caller has to fall back to doubles
+static bool integerArithmetic(BinaryExpr::Operator op, int64_t a, int64_t b, Value& result) {
+    int64_t exact = 0;
+    switch (op) {
+        case BinaryExpr::Operator::ADD:
+            if (addOverflows(a, b, exact)) return false;
+            break;
+        case BinaryExpr::Operator::SUBTRACT:
+            if (subtractOverflows(a, b, exact)) return false;
+            break;
+        case BinaryExpr::Operator::MULTIPLY:
+            if (multiplyOverflows(a, b, exact)) return false;
+            break;
+        case BinaryExpr::Operator::DIVIDE:
+            // Only divisions without a remainder stay integers
+            if (b == 0 || (b == -1 && a == INT64_MIN) || a % b != 0) return false;
+            exact = a / b;
+            break;
+        case BinaryExpr::Operator::EQUAL: result = truth(a == b); return true;
+        case BinaryExpr::Operator::NOT_EQUAL: result = truth(a != b); return true;
+        case BinaryExpr::Operator::LESS: result = truth(a < b); return true;
+        case BinaryExpr::Operator::LESS_EQUAL: result = truth(a <= b); return true;
+        case BinaryExpr::Operator::GREATER: result = truth(a > b); return true;
+        case BinaryExpr::Operator::GREATER_EQUAL: result = truth(a >= b); return true;
+    }
+    result = Value::integer(exact);
+    return true;
 }
 
 Value Interpreter::evaluateBinaryExpr(const BinaryExpr* expr) {
     Value left = evaluateExpression(expr->left.get());
     Value right = evaluateExpression(expr->right.get());
+    BinaryExpr::Operator op = expr->op;
+
+    if (left.isInteger() && right.isInteger()) {
+        Value exact;
+        if (integerArithmetic(op, left.getInteger(), right.getInteger(), exact)) return exact;
+    }
+
+    // Values of different types are never equal
+    if (op == BinaryExpr::Operator::EQUAL || op == BinaryExpr::Operator::NOT_EQUAL) {
+        bool equal;
+        if (left.isNumber() != right.isNumber()) {
+            equal = false;
+        } else if (left.isNumber()) {
+            equal = left.getNumber() == right.getNumber();
+        } else {
+            equal = left.stringSize() == right.stringSize() &&
+                    std::memcmp(left.stringData(), right.stringData(), left.stringSize()) == 0;
+        }
+        return truth(equal == (op == BinaryExpr::Operator::EQUAL));
+    }
 
     // Handle numeric operations
     if (left.isNumber() && right.isNumber()) {
         double leftVal = left.getNumber();
         double rightVal = right.getNumber();
 
-        switch (expr->op) {
+        switch (op) {
             case BinaryExpr::Operator::ADD:
                 return leftVal + rightVal;
             case BinaryExpr::Operator::SUBTRACT:
@@ -154,26 +774,45 @@ Value Interpreter::evaluateBinaryExpr(const BinaryExpr* expr) {
                     throw std::runtime_error("Division by zero");
                 }
                 return leftVal / rightVal;
+            case BinaryExpr::Operator::LESS:
+                return truth(leftVal < rightVal);
+            case BinaryExpr::Operator::LESS_EQUAL:
+                return truth(leftVal <= rightVal);
+            case BinaryExpr::Operator::GREATER:
+                return truth(leftVal > rightVal);
+            case BinaryExpr::Operator::GREATER_EQUAL:
+                return truth(leftVal >= rightVal);
+            case BinaryExpr::Operator::EQUAL:
+            case BinaryExpr::Operator::NOT_EQUAL:
+                break;
         }
     }
 
     // Handle string concatenation
-    if (expr->op == BinaryExpr::Operator::ADD) {
-        std::string leftStr, rightStr;
+    if (op == BinaryExpr::Operator::ADD) {
+        Value result = concatenate(left, right);
+        if (budget.maxStringBytes) checkStringBytes(expr);
+        return result;
+    }
 
-        if (left.isString()) {
-            leftStr = left.getString();
-        } else {
-            leftStr = std::to_string(left.getNumber());
+    // Strings compare byte by byte
+    if (op >= BinaryExpr::Operator::LESS && op <= BinaryExpr::Operator::GREATER_EQUAL) {
+        if (left.isNumber() || right.isNumber()) {
+            throw std::runtime_error("Cannot compare a number with a string");
         }
 
-        if (right.isString()) {
-            rightStr = right.getString();
-        } else {
-            rightStr = std::to_string(right.getNumber());
+        size_t common = std::min(left.stringSize(), right.stringSize());
+        int order = std::memcmp(left.stringData(), right.stringData(), common);
+        if (order == 0 && left.stringSize() != right.stringSize()) {
+            order = left.stringSize() < right.stringSize() ? -1 : 1;
         }
 
-        return leftStr + rightStr;
+        switch (op) {
+            case BinaryExpr::Operator::LESS: return truth(order < 0);
+            case BinaryExpr::Operator::LESS_EQUAL: return truth(order <= 0);
+            case BinaryExpr::Operator::GREATER: return truth(order > 0);
+            default: return truth(order >= 0);
+        }
     }
 
     throw std::runtime_error("Invalid operands for binary operator");
@@ -187,12 +826,15 @@ Value Interpreter::evaluateAssignExpr(const AssignExpr* expr) {
 
 Value Interpreter::evaluateCallExpr(const CallExpr* expr) {
     // Look up the recipe
-    auto it = recipes.find(expr->callee);
-    if (it == recipes.end()) {
+    const Recipe* found = findRecipe(expr->callee);
+    if (!found) {
+        if (const NativeRecipe* native = findNative(expr->callee)) {
+            return callNative(*native, expr);
+        }
         throw std::runtime_error("Undefined recipe '" + expr->callee + "'");
     }
 
-    const Recipe& recipe = it->second;
+    const Recipe& recipe = *found;
 
     // Evaluate arguments
     std::vector<Value> arguments;
@@ -200,30 +842,175 @@ Value Interpreter::evaluateCallExpr(const CallExpr* expr) {
         arguments.push_back(evaluateExpression(arg.get()));
     }
 
-    // Check argument count
+    invokeRecipe(recipe, arguments, expr);
+
+    // For now, return a default value
+    return std::string("recipe result");
+}
+
+// Native recipes take their arguments from an array on the stack and return
+// what the function returns
+Value Interpreter::callNative(const NativeRecipe& native, const CallExpr* call) {
+    if (call->arguments.size() != native.arity()) {
+        // The arguments are still evaluated first, as for recipes in Cook
+        for (const auto& arg : call->arguments) {
+            evaluateExpression(arg.get());
+        }
+        throw std::runtime_error("Expected " + std::to_string(native.arity()) +
+                                " arguments but got " + std::to_string(call->arguments.size()));
+    }
+
+    Value arguments[NativeRecipe::MAX_PARAMETERS];
+    for (size_t i = 0; i < call->arguments.size(); i++) {
+        arguments[i] = evaluateExpression(call->arguments[i].get());
+    }
+
+    if (--fuel < 0) refuel(call);
+    if (profiler) profiler->enterRecipe(call->callee);
+    ProfileScope scope(profiler);
+    COOK_STAT_ADD(recipeCalls, 1);
+
+    // A string result lives outside the region, so count it here
+    Value result;
+    {
+        NativeCallScope caller(this, call);
+        result = native.call(call->callee, arguments);
+    }
+    if (budget.maxStringBytes && result.isString()) checkStringBytes(call, result.stringSize());
+    return result;
+}
+
+const std::vector<std::string>* Interpreter::recipeParameters(const std::string& name) {
+    const Recipe* recipe = findRecipe(name);
+    return recipe ? &recipe->parameters : nullptr;
+}
+
+void Interpreter::callRecipe(const std::string& name, const std::vector<Value>& arguments) {
+    const Recipe* recipe = findRecipe(name);
+    if (!recipe) {
+        throw std::runtime_error("Undefined recipe '" + name + "'");
+    }
+
+    // The call has no place in the source; budget errors report line 0
+    CallExpr call(name, {});
+    startRun();
+    invokeRecipe(*recipe, arguments, &call);
+    region.reset();
+}
+
+// Check the arguments and budget, then run the recipe
+void Interpreter::invokeRecipe(const Recipe& recipe, const std::vector<Value>& arguments, const CallExpr* call) {
     if (arguments.size() != recipe.parameters.size()) {
         throw std::runtime_error("Expected " + std::to_string(recipe.parameters.size()) +
                                 " arguments but got " + std::to_string(arguments.size()));
     }
 
-    // Execute the recipe body with the arguments
-    executeRecipeBody(recipe, arguments);
+    if (--fuel < 0) refuel(call);
+    if (profiler) profiler->enterRecipe(call->callee);
+    ProfileScope scope(profiler);
+    CallDepthScope depth(callDepth);
+    if (budget.maxCallDepth && callDepth > budget.maxCallDepth) {
+        throw BudgetExceeded(BudgetExceeded::Kind::CALL_DEPTH,
+                             "Call depth limit of " + std::to_string(budget.maxCallDepth) +
+                             " exceeded calling '" + call->callee + "' at line " +
+                             std::to_string(call->line) + ", column " + std::to_string(call->column),
+                             call->line, call->column);
+    }
+    COOK_STAT_ADD(recipeCalls, 1);
+    COOK_STAT_MAX(maxCallDepth, callDepth);
+    executeRecipeBody(recipe, arguments, call);
+}
+
+// Text of a value for concatenation, formatted into the caller's buffer.
+// Integers are exact; doubles are formatted like std::to_string.
+static const char* textOf(const Value& value, char (&buffer)[64], std::string& fallback,
+                          size_t& size) {
+    if (value.isString()) {
+        size = value.stringSize();
+        return value.stringData();
+    }
 
-    // For now, return a default value
-    return std::string("recipe result");
+    int written = value.isInteger()
+                ? std::snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(value.getInteger()))
+                : std::snprintf(buffer, sizeof(buffer), "%f", value.getNumber());
+    if (written >= 0 && written < static_cast<int>(sizeof(buffer))) {
+        size = static_cast<size_t>(written);
+        return buffer;
+    }
+
+    fallback = std::to_string(value.getNumber());
+    size = fallback.size();
+    return fallback.data();
+}
+
+Value Interpreter::concatenate(const Value& left, const Value& right) {
+    char leftBuffer[64];
+    char rightBuffer[64];
+    std::string leftFallback, rightFallback;
+    size_t leftSize, rightSize;
+    const char* leftText = textOf(left, leftBuffer, leftFallback, leftSize);
+    const char* rightText = textOf(right, rightBuffer, rightFallback, rightSize);
+
+    size_t size = leftSize + rightSize;
+    if (size == 0) {
+        return Value::borrowed("", 0);
+    }
+
+    char* result = region.allocate(size);
+    std::memcpy(result, leftText, leftSize);
+    std::memcpy(result + leftSize, rightText, rightSize);
+    COOK_STAT_ADD(stringBytesCopied, size);
+    return Value::borrowed(result, size);
+}
+
+const Recipe* Interpreter::findRecipe(const std::string& name) {
+    // Recipes a worker calls were all materialized by the analysis
+    if (parent) {
+        auto shared = parent->recipes.find(name);
+        return shared != parent->recipes.end() ? &shared->second : nullptr;
+    }
+
+    auto it = recipes.find(name);
+    if (it != recipes.end()) {
+        return &it->second;
+    }
+
+    // Materialize cookbook recipes on first use
+    auto pending = pendingRecipes.find(name);
+    if (pending == pendingRecipes.end()) {
+        return nullptr;
+    }
+
+    std::unique_ptr<RecipeStmt> stmt = pending->second->materializeRecipe(name);
+    pendingRecipes.erase(pending);
+
+    Recipe& recipe = recipes[name];
+    recipe = Recipe(std::move(stmt->parameters), std::move(stmt->body));
+    return &recipe;
+}
+
+const NativeRecipe* Interpreter::findNative(const std::string& name) const {
+    const auto& table = parent ? parent->natives : natives;
+    auto it = table.find(name);
+    return it != table.end() ? &it->second : nullptr;
 }
 
-void Interpreter::executeRecipeBody(const Recipe& recipe, const std::vector<Value>& arguments) {
+void Interpreter::executeRecipeBody(const Recipe& recipe, const std::vector<Value>& arguments,
+                                    const CallExpr* call) {
     // Create a new environment for the recipe execution
     Environment previousEnv = environment;
+    SavedBytesScope saved(savedStringBytes, previousEnv.stringBytes());
 
     // Bind parameters to arguments
     for (size_t i = 0; i < recipe.parameters.size(); i++) {
         environment.define(recipe.parameters[i], arguments[i]);
     }
+    if (budget.maxStringBytes) checkStringBytes(call);
 
-    // Execute the recipe body
+    // Execute the recipe body; each statement's transient strings are
+    // released when it finishes, leaving the caller's values intact
     for (const auto& stmt : recipe.body) {
+        RegionScope scope(region);
         executeStatement(stmt.get());
     }
 
@@ -231,4 +1018,50 @@ void Interpreter::executeRecipeBody(const Recipe& recipe, const std::vector<Valu
     environment = previousEnv;
 }
 
+void Interpreter::startBudget() {
+    stepsTaken = 0;
+    granted = budget.maxSteps && budget.maxSteps < BUDGET_CHECK_INTERVAL ? budget.maxSteps
+                                                                         : BUDGET_CHECK_INTERVAL;
+    fuel = static_cast<int64_t>(granted);
+    if (budget.maxMillis) {
+        deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(budget.maxMillis);
+    }
+}
+
+// Called when 'fuel' runs out: every step granted at the last refill is
+// used, and 'node' is about to take one more
+void Interpreter::refuel(const ASTNode* node) {
+    stepsTaken += granted;
+    std::string location = " at line " + std::to_string(node->line) + ", column " + std::to_string(node->column);
+
+    if (budget.maxSteps && stepsTaken >= budget.maxSteps) {
+        throw BudgetExceeded(BudgetExceeded::Kind::STEPS,
+                             "Step limit of " + std::to_string(budget.maxSteps) + " exceeded" + location,
+                             node->line, node->column);
+    }
+
+    if (budget.maxMillis && std::chrono::steady_clock::now() >= deadline) {
+        throw BudgetExceeded(BudgetExceeded::Kind::TIME,
+                             "Time limit of " + std::to_string(budget.maxMillis) + " ms exceeded" + location,
+                             node->line, node->column);
+    }
+
+    granted = BUDGET_CHECK_INTERVAL;
+    if (budget.maxSteps && budget.maxSteps - stepsTaken < granted) {
+        granted = budget.maxSteps - stepsTaken;
+    }
+    fuel = static_cast<int64_t>(granted) - 1;
+}
+
+void Interpreter::checkStringBytes(const ASTNode* node, size_t pending) {
+    size_t live = environment.stringBytes() + savedStringBytes + region.used();
+    if (pending <= budget.maxStringBytes && live <= budget.maxStringBytes - pending) return;
+
+    throw BudgetExceeded(BudgetExceeded::Kind::STRING_BYTES,
+                         "String memory limit of " + std::to_string(budget.maxStringBytes) +
+                         " bytes exceeded at line " + std::to_string(node->line) + ", column " +
+                         std::to_string(node->column),
+                         node->line, node->column);
+}
+
 } // namespace cook
@@ -0,0 +1,303 @@
+#include "json.h"
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace cook {
+
+namespace {
+
+// Recursive descent reader over a JSON text
+class JsonReader {
+public:
+    JsonReader(const std::string& text) : text(text) {}
+
+    Json readDocument() {
+        Json value = readValue();
+        skipWhitespace();
+        if (position != text.size()) fail("trailing characters");
+        return value;
+    }
+
+private:
+    const std::string& text;
+    size_t position = 0;
+
+    [[noreturn]] void fail(const std::string& message) {
+        throw std::runtime_error("Invalid JSON at offset " + std::to_string(position) + ": " + message);
+    }
+
+    void skipWhitespace() {
+        while (position < text.size()) {
+            char c = text[position];
+            if (c != ' ' && c != '\t' && c != '\n' && c != '\r') break;
+            position++;
+        }
+    }
+
+    bool consume(char expected) {
+        skipWhitespace();
+        if (position < text.size() && text[position] == expected) {
+            position++;
+            return true;
+        }
+        return false;
+    }
+
+    void expectWord(const char* word) {
+        for (const char* c = word; *c; c++) {
+            if (position >= text.size() || text[position] != *c) fail("unexpected token");
+            position++;
+        }
+    }
+
+    Json readValue() {
+        skipWhitespace();
+        if (position >= text.size()) fail("unexpected end of input");
+
+        char c = text[position];
+        switch (c) {
+            case '{': return readObject();
+            case '[': return readArray();
+            case '"': return Json(readString());
+            case 't': expectWord("true"); return Json(true);
+            case 'f': expectWord("false"); return Json(false);
+            case 'n': expectWord("null"); return Json();
+            default:
+                if (c == '-' || (c >= '0' && c <= '9')) return readNumber();
+                fail(std::string("unexpected character '") + c + "'");
+        }
+    }
+
+    Json readObject() {
+        position++;
+        Json object = Json::object();
+        if (consume('}')) return object;
+
+        do {
+            skipWhitespace();
+            if (position >= text.size() || text[position] != '"') fail("expected member name");
+            std::string key = readString();
+            if (!consume(':')) fail("expected ':'");
+            object[key] = readValue();
+        } while (consume(','));
+
+        if (!consume('}')) fail("expected '}'");
+        return object;
+    }
+
+    Json readArray() {
+        position++;
+        Json array = Json::array();
+        if (consume(']')) return array;
+
+        do {
+            array.push(readValue());
+        } while (consume(','));
+
+        if (!consume(']')) fail("expected ']'");
+        return array;
+    }
+
+    Json readNumber() {
+        const char* start = text.c_str() + position;
+        char* end = nullptr;
+        double value = std::strtod(start, &end);
+        if (end == start) fail("malformed number");
+        position += end - start;
+        return Json(value);
+    }
+
+    unsigned readHex4() {
+        if (position + 4 > text.size()) fail("truncated escape");
+        unsigned value = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = text[position++];
+            value <<= 4;
+            if (c >= '0' && c <= '9') value |= c - '0';
+            else if (c >= 'a' && c <= 'f') value |= c - 'a' + 10;
+            else if (c >= 'A' && c <= 'F') value |= c - 'A' + 10;
+            else fail("malformed escape");
+        }
+        return value;
+    }
+
+    static void appendUtf8(std::string& out, unsigned code) {
+        if (code < 0x80) {
+            out += static_cast<char>(code);
+        } else if (code < 0x800) {
+            out += static_cast<char>(0xC0 | (code >> 6));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            out += static_cast<char>(0xE0 | (code >> 12));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            out += static_cast<char>(0xF0 | (code >> 18));
+            out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    std::string readString() {
+        position++;
+        std::string value;
+        while (true) {
+            if (position >= text.size()) fail("unterminated string");
+            char c = text[position++];
+            if (c == '"') return value;
+            if (c != '\\') {
+                value += c;
+                continue;
+            }
+
+            if (position >= text.size()) fail("unterminated string");
+            char escape = text[position++];
+            switch (escape) {
+                case '"': value += '"'; break;
+                case '\\': value += '\\'; break;
+                case '/': value += '/'; break;
+                case 'b': value += '\b'; break;
+                case 'f': value += '\f'; break;
+                case 'n': value += '\n'; break;
+                case 'r': value += '\r'; break;
+                case 't': value += '\t'; break;
+                case 'u': {
+                    unsigned code = readHex4();
+                    // Combine a surrogate pair into one code point
+                    if (code >= 0xD800 && code < 0xDC00 &&
+                        position + 1 < text.size() && text[position] == '\\' && text[position + 1] == 'u') {
+                        position += 2;
+                        unsigned low = readHex4();
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUtf8(value, code);
+                    break;
+                }
+                default:
+                    fail("unknown escape");
+            }
+        }
+    }
+};
+
+void writeString(std::string& out, const std::string& value) {
+    out += '"';
+    for (char c : value) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escape[8];
+                    std::snprintf(escape, sizeof(escape), "\\u%04x", c);
+                    out += escape;
+                } else {
+                    out += c;
+                }
+        }
+    }
+    out += '"';
+}
+
+} // namespace
+
+Json Json::array() {
+    Json value;
+    value.type = Type::ARRAY;
+    return value;
+}
+
+Json Json::object() {
+    Json value;
+    value.type = Type::OBJECT;
+    return value;
+}
+
+Json Json::parse(const std::string& text) {
+    return JsonReader(text).readDocument();
+}
+
+const Json& Json::operator[](const std::string& key) const {
+    static const Json null;
+    for (const auto& member : members) {
+        if (member.first == key) return member.second;
+    }
+    return null;
+}
+
+Json& Json::operator[](const std::string& key) {
+    if (type == Type::NUL) type = Type::OBJECT;
+    for (auto& member : members) {
+        if (member.first == key) return member.second;
+    }
+    members.emplace_back(key, Json());
+    return members.back().second;
+}
+
+bool Json::has(const std::string& key) const {
+    for (const auto& member : members) {
+        if (member.first == key) return true;
+    }
+    return false;
+}
+
+void Json::push(Json value) {
+    if (type == Type::NUL) type = Type::ARRAY;
+    items.push_back(std::move(value));
+}
+
+std::string Json::dump() const {
+    std::string out;
+    write(out);
+    return out;
+}
+
+void Json::write(std::string& out) const {
+    switch (type) {
+        case Type::NUL:
+            out += "null";
+            break;
+        case Type::BOOLEAN:
+            out += boolValue ? "true" : "false";
+            break;
+        case Type::NUMBER: {
+            char buffer[32];
+            if (std::floor(numberValue) == numberValue && std::fabs(numberValue) < 1e15) {
+                std::snprintf(buffer, sizeof(buffer), "%.0f", numberValue);
+            } else {
+                std::snprintf(buffer, sizeof(buffer), "%.17g", numberValue);
+            }
+            out += buffer;
+            break;
+        }
+        case Type::STRING:
+            writeString(out, stringValue);
+            break;
+        case Type::ARRAY:
+            out += '[';
+            for (size_t i = 0; i < items.size(); i++) {
+                if (i > 0) out += ',';
+                items[i].write(out);
+            }
+            out += ']';
+            break;
+        case Type::OBJECT:
+            out += '{';
+            for (size_t i = 0; i < members.size(); i++) {
+                if (i > 0) out += ',';
+                writeString(out, members[i].first);
+                out += ':';
+                members[i].second.write(out);
+            }
+            out += '}';
+            break;
+    }
+}
+
+} // namespace cook
@@ -0,0 +1,520 @@
+#include "language_server.h"
+#include "files.h"
+#include "pantry.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace cook {
+
+namespace {
+
+// JSON-RPC error codes
+const int PARSE_ERROR = -32700;
+const int METHOD_NOT_FOUND = -32601;
+const int INTERNAL_ERROR = -32603;
+
+// LSP completion item kinds
+const int COMPLETION_FUNCTION = 3;
+const int COMPLETION_VARIABLE = 6;
+const int COMPLETION_KEYWORD = 14;
+
+const char* const KEYWORDS[] = {"ingredient", "recipe", "cookbook", "cook", "taste"};
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// "file:///dir/a%20b.cook" -> "/dir/a b.cook"; other schemes have no path
+std::string pathFromUri(const std::string& uri) {
+    if (uri.compare(0, 7, "file://") != 0) return "";
+
+    std::string path;
+    for (size_t i = 7; i < uri.size(); i++) {
+        if (uri[i] == '%' && i + 2 < uri.size() && hexValue(uri[i + 1]) >= 0 && hexValue(uri[i + 2]) >= 0) {
+            path += static_cast<char>(hexValue(uri[i + 1]) * 16 + hexValue(uri[i + 2]));
+            i += 2;
+        } else {
+            path += uri[i];
+        }
+    }
+
+#ifdef _WIN32
+    // file:///C:/dir -> C:/dir
+    if (path.size() > 2 && path[0] == '/' && path[2] == ':') path.erase(0, 1);
+#endif
+    return path;
+}
+
+std::string uriFromPath(const std::string& path) {
+    std::string uri = "file://";
+#ifdef _WIN32
+    if (!path.empty() && path[0] != '/') uri += '/';
+#endif
+    for (char c : path) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if (std::isalnum(byte) || c == '/' || c == '-' || c == '_' || c == '.' || c == '~' || c == ':') {
+            uri += c;
+        } else {
+            char escaped[4];
+            std::snprintf(escaped, sizeof(escaped), "%%%02X", byte);
+            uri += escaped;
+        }
+    }
+    return uri;
+}
+
+// UTF-16 code units in UTF-8 text; characters outside the Basic
+// Multilingual Plane take two
+int utf16Length(std::string_view text) {
+    int units = 0;
+    for (char c : text) {
+        unsigned char byte = static_cast<unsigned char>(c);
+        if ((byte & 0xC0) != 0x80) units++;
+        if (byte >= 0xF0) units++;
+    }
+    return units;
+}
+
+// Byte offset of the character 'units' UTF-16 code units into a line
+size_t utf8Offset(std::string_view line, size_t units) {
+    size_t offset = 0;
+    while (offset < line.size() && units > 0) {
+        unsigned char byte = static_cast<unsigned char>(line[offset]);
+        size_t length = byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : byte >= 0xC0 ? 2 : 1;
+        units -= std::min<size_t>(units, byte >= 0xF0 ? 2 : 1);
+        offset += length;
+    }
+    return std::min(offset, line.size()) + units;
+}
+
+// Zero-based line of a text ("" past the end)
+std::string_view lineOf(const std::string& text, int line) {
+    size_t start = 0;
+    for (int i = 0; i < line; i++) {
+        start = text.find('\n', start);
+        if (start == std::string::npos) return std::string_view();
+        start++;
+    }
+    size_t end = text.find('\n', start);
+    return std::string_view(text).substr(start, end == std::string::npos ? std::string::npos : end - start);
+}
+
+// LSP position from a one-based line and column
+Json lspPosition(int line, int column) {
+    Json position = Json::object();
+    position["line"] = line > 0 ? line - 1 : 0;
+    position["character"] = column > 0 ? column - 1 : 0;
+    return position;
+}
+
+const char* describe(Symbol::Kind kind) {
+    switch (kind) {
+        case Symbol::Kind::INGREDIENT: return "ingredient";
+        case Symbol::Kind::RECIPE: return "recipe";
+        case Symbol::Kind::PARAMETER: return "recipe parameter";
+    }
+    return "";
+}
+
+} // namespace
+
+LanguageServer::LanguageServer(std::istream& in, std::ostream& out) : in(in), out(out) {}
+
+int LanguageServer::run() {
+    std::string body;
+    while (readMessage(body)) {
+        Json message;
+        try {
+            message = Json::parse(body);
+        } catch (const std::exception& e) {
+            respondError(Json(), PARSE_ERROR, e.what());
+            continue;
+        }
+
+        if (!handle(message)) {
+            return shutdownRequested ? 0 : 1;
+        }
+    }
+
+    // The client went away without asking us to exit
+    return 1;
+}
+
+bool LanguageServer::readMessage(std::string& body) {
+    size_t length = 0;
+    bool haveLength = false;
+    std::string header;
+
+    while (std::getline(in, header)) {
+        if (!header.empty() && header.back() == '\r') header.pop_back();
+        if (header.empty()) {
+            if (!haveLength) continue;
+
+            body.resize(length);
+            in.read(&body[0], static_cast<std::streamsize>(length));
+            return static_cast<size_t>(in.gcount()) == length;
+        }
+
+        const std::string name = "Content-Length:";
+        if (header.compare(0, name.size(), name) == 0) {
+            length = std::strtoul(header.c_str() + name.size(), nullptr, 10);
+            haveLength = true;
+        }
+    }
+
+    return false;
+}
+
+void LanguageServer::send(const Json& message) {
+    std::string body = message.dump();
+    out << "Content-Length: " << body.size() << "\r\n\r\n" << body;
+    out.flush();
+}
+
+void LanguageServer::respond(const Json& id, Json result) {
+    Json response = Json::object();
+    response["jsonrpc"] = "2.0";
+    response["id"] = id;
+    response["result"] = std::move(result);
+    send(response);
+}
+
+void LanguageServer::respondError(const Json& id, int code, const std::string& message) {
+    Json error = Json::object();
+    error["code"] = code;
+    error["message"] = message;
+
+    Json response = Json::object();
+    response["jsonrpc"] = "2.0";
+    response["id"] = id;
+    response["error"] = std::move(error);
+    send(response);
+}
+
+bool LanguageServer::handle(const Json& message) {
+    const std::string& method = message["method"].asString();
+    const Json& params = message["params"];
+    bool request = message.has("id");
+    const Json& id = message["id"];
+
+    try {
+        if (method == "initialize") {
+            respond(id, initialize(params));
+        } else if (method == "shutdown") {
+            shutdownRequested = true;
+            respond(id, Json());
+        } else if (method == "exit") {
+            return false;
+        } else if (method == "textDocument/didOpen") {
+            didOpen(params);
+        } else if (method == "textDocument/didChange") {
+            didChange(params);
+        } else if (method == "textDocument/didClose") {
+            didClose(params);
+        } else if (method == "textDocument/completion") {
+            respond(id, completion(params));
+        } else if (method == "textDocument/definition") {
+            respond(id, definition(params));
+        } else if (request) {
+            respondError(id, METHOD_NOT_FOUND, "Unsupported method '" + method + "'");
+        }
+        // Other notifications ('initialized', '$/...') need no answer
+    } catch (const std::exception& e) {
+        if (request) respondError(id, INTERNAL_ERROR, e.what());
+    }
+
+    return true;
+}
+
+Json LanguageServer::initialize(const Json& params) {
+    // Positions are counted in UTF-16 code units unless the client accepts
+    // UTF-8, which is how the server counts them
+    const Json& encodings = params["capabilities"]["general"]["positionEncodings"];
+    utf8Positions = false;
+    for (size_t i = 0; i < encodings.size(); i++) {
+        if (encodings[i].asString() == "utf-8") utf8Positions = true;
+    }
+
+    Json sync = Json::object();
+    sync["openClose"] = true;
+    sync["change"] = 2; // incremental
+
+    Json capabilities = Json::object();
+    capabilities["positionEncoding"] = utf8Positions ? "utf-8" : "utf-16";
+    capabilities["textDocumentSync"] = std::move(sync);
+    capabilities["completionProvider"] = Json::object();
+    capabilities["definitionProvider"] = true;
+
+    Json info = Json::object();
+    info["name"] = "cook";
+    info["version"] = "0.1.0";
+
+    Json result = Json::object();
+    result["capabilities"] = std::move(capabilities);
+    result["serverInfo"] = std::move(info);
+    return result;
+}
+
+void LanguageServer::didOpen(const Json& params) {
+    const Json& item = params["textDocument"];
+    const std::string& uri = item["uri"].asString();
+
+    auto document = std::make_unique<Document>(item["text"].asString());
+    publishDiagnostics(uri, *document);
+    documents[uri] = std::move(document);
+}
+
+void LanguageServer::didChange(const Json& params) {
+    const std::string& uri = params["textDocument"]["uri"].asString();
+    auto it = documents.find(uri);
+    if (it == documents.end()) return;
+
+    Document& document = *it->second;
+    const Json& changes = params["contentChanges"];
+    for (size_t i = 0; i < changes.size(); i++) {
+        const Json& change = changes[i];
+        if (change.has("range")) {
+            const Json& range = change["range"];
+            document.edit(textPosition(document, range["start"]), textPosition(document, range["end"]),
+                          change["text"].asString());
+        } else {
+            document.replace(change["text"].asString());
+        }
+    }
+
+    publishDiagnostics(uri, document);
+}
+
+void LanguageServer::didClose(const Json& params) {
+    const std::string& uri = params["textDocument"]["uri"].asString();
+    documents.erase(uri);
+
+    // Clear the editor's markers for the closed file
+    Json notification = Json::object();
+    notification["jsonrpc"] = "2.0";
+    notification["method"] = "textDocument/publishDiagnostics";
+    notification["params"]["uri"] = uri;
+    notification["params"]["diagnostics"] = Json::array();
+    send(notification);
+}
+
+Json LanguageServer::completion(const Json& params) {
+    Json items = Json::array();
+    const std::string& uri = params["textDocument"]["uri"].asString();
+    const Document* document = find(uri);
+
+    if (document) {
+        for (const auto& symbol : document->visibleSymbols(textPosition(*document, params["position"]))) {
+            Json item = Json::object();
+            item["label"] = symbol.name;
+            item["kind"] = symbol.kind == Symbol::Kind::RECIPE ? COMPLETION_FUNCTION : COMPLETION_VARIABLE;
+            item["detail"] = describe(symbol.kind);
+            items.push(std::move(item));
+        }
+
+        for (const auto& cookbook : document->cookbooks()) {
+            const std::vector<NativeDefinition>* definitions = builtinCookbook(cookbook);
+            if (!definitions) continue;
+            for (const auto& definition : *definitions) {
+                Json item = Json::object();
+                item["label"] = definition.name;
+                item["kind"] = COMPLETION_FUNCTION;
+                item["detail"] = "recipe from " + cookbook;
+                items.push(std::move(item));
+            }
+        }
+
+        for (const Module* module : importedModules(uri, *document)) {
+            for (const auto& name : module->getRecipeNames()) {
+                Json item = Json::object();
+                item["label"] = name;
+                item["kind"] = COMPLETION_FUNCTION;
+                item["detail"] = "recipe from " + module->getPath();
+                items.push(std::move(item));
+            }
+            for (const auto& stmt : module->getPrelude()) {
+                auto* ingredient = dynamic_cast<const IngredientStmt*>(stmt.get());
+                if (!ingredient) continue;
+                Json item = Json::object();
+                item["label"] = ingredient->name;
+                item["kind"] = COMPLETION_VARIABLE;
+                item["detail"] = "ingredient from " + module->getPath();
+                items.push(std::move(item));
+            }
+        }
+    }
+
+    for (const char* keyword : KEYWORDS) {
+        Json item = Json::object();
+        item["label"] = keyword;
+        item["kind"] = COMPLETION_KEYWORD;
+        items.push(std::move(item));
+    }
+
+    return items;
+}
+
+Json LanguageServer::definition(const Json& params) {
+    Json locations = Json::array();
+    const std::string& uri = params["textDocument"]["uri"].asString();
+    const Document* document = find(uri);
+    if (!document) return locations;
+
+    Reference reference;
+    for (const auto& location : document->definitions(textPosition(*document, params["position"]), reference)) {
+        locations.push(lspLocation(uri, document->line(location.line - 1), location.line, location.column,
+                                   reference.name.size()));
+    }
+
+    // Names that are not defined in the document may come from a cookbook
+    if (locations.size() == 0 && !reference.name.empty()) {
+        for (const Module* module : importedModules(uri, *document)) {
+            // Columns in the cookbook are converted against its text on disk
+            std::string source;
+            if (!utf8Positions) readWholeFile(module->getPath(), source);
+
+            if (reference.call && module->hasRecipe(reference.name)) {
+                auto recipe = module->materializeRecipe(reference.name);
+                locations.push(lspLocation(uriFromPath(module->getPath()), lineOf(source, recipe->line - 1),
+                                           recipe->line, recipe->column, std::string("recipe").size()));
+                break;
+            }
+            if (reference.call) continue;
+
+            for (const auto& stmt : module->getPrelude()) {
+                auto* ingredient = dynamic_cast<const IngredientStmt*>(stmt.get());
+                if (!ingredient || ingredient->name != reference.name) continue;
+                locations.push(lspLocation(uriFromPath(module->getPath()), lineOf(source, stmt->line - 1),
+                                           stmt->line, stmt->column, std::string("ingredient").size()));
+            }
+            if (locations.size() > 0) break;
+        }
+    }
+
+    return locations;
+}
+
+void LanguageServer::publishDiagnostics(const std::string& uri, const Document& document) {
+    Json diagnostics = Json::array();
+    for (const auto& diagnostic : document.diagnostics()) {
+        Json item = Json::object();
+        item["range"] = lspRange(document.line(diagnostic.line - 1), diagnostic.line, diagnostic.column, 1);
+        item["severity"] = 1; // error
+        item["source"] = "cook";
+        item["message"] = diagnostic.message;
+        diagnostics.push(std::move(item));
+    }
+
+    Json notification = Json::object();
+    notification["jsonrpc"] = "2.0";
+    notification["method"] = "textDocument/publishDiagnostics";
+    notification["params"]["uri"] = uri;
+    notification["params"]["diagnostics"] = std::move(diagnostics);
+    send(notification);
+}
+
+const Document* LanguageServer::find(const std::string& uri) const {
+    auto it = documents.find(uri);
+    return it == documents.end() ? nullptr : it->second.get();
+}
+
+TextPosition LanguageServer::textPosition(const Document& document, const Json& position) const {
+    TextPosition result{position["line"].asInt(), position["character"].asInt()};
+    if (!utf8Positions && result.character > 0) {
+        result.character = static_cast<int>(utf8Offset(document.line(result.line),
+                                                       static_cast<size_t>(result.character)));
+    }
+    return result;
+}
+
+Json LanguageServer::lspRange(std::string_view line, int lineNumber, int column, size_t length) const {
+    int end = column + static_cast<int>(length);
+    if (!utf8Positions) {
+        auto units = [&](int at) {
+            size_t bytes = at > 1 ? static_cast<size_t>(at - 1) : 0;
+            return utf16Length(line.substr(0, std::min(bytes, line.size()))) + 1 +
+                   static_cast<int>(bytes > line.size() ? bytes - line.size() : 0);
+        };
+        column = units(column);
+        end = units(end);
+    }
+
+    Json range = Json::object();
+    range["start"] = lspPosition(lineNumber, column);
+    range["end"] = lspPosition(lineNumber, end);
+    return range;
+}
+
+Json LanguageServer::lspLocation(const std::string& uri, std::string_view line, int lineNumber, int column,
+                                 size_t length) const {
+    Json location = Json::object();
+    location["uri"] = uri;
+    location["range"] = lspRange(line, lineNumber, column, length);
+    return location;
+}
+
+const Module* LanguageServer::loadModule(const std::string& path) {
+    // Checked on every lookup, so a cookbook edited in another editor is
+    // seen by the next completion
+    uint64_t size = 0, modified = 0;
+    if (!fileStatus(path, size, modified)) {
+        modules.erase(path);
+        return nullptr;
+    }
+
+    auto it = modules.find(path);
+    if (it != modules.end() && it->second.size == size && it->second.modified == modified) {
+        return it->second.module.get();
+    }
+
+    CachedModule& entry = modules[path];
+    entry.size = size;
+    entry.modified = modified;
+    try {
+        entry.module = ModuleCache::compileFile(path);
+    } catch (const std::exception&) {
+        entry.module.reset();
+    }
+    return entry.module.get();
+}
+
+std::vector<const Module*> LanguageServer::importedModules(const std::string& uri, const Document& document) {
+    std::vector<const Module*> found;
+    std::string path = pathFromUri(uri);
+    if (path.empty()) return found;
+
+    for (const auto& cookbook : document.cookbooks()) {
+        collectModules(directoryOf(path), cookbook, found);
+    }
+    return found;
+}
+
+// Each cookbook once. Files that cannot be loaded are skipped; their errors
+// show up when they are opened.
+void LanguageServer::collectModules(const std::string& directory, const std::string& cookbook,
+                                    std::vector<const Module*>& found) {
+    if (isBuiltinCookbook(cookbook)) return;
+
+    // Different spellings of a path load separate copies, so compare the
+    // resolved paths the modules carry
+    const Module* module = loadModule(resolveModulePath(directory, cookbook));
+    if (!module) return;
+    for (const Module* other : found) {
+        if (other->getPath() == module->getPath()) return;
+    }
+    found.push_back(module);
+
+    for (const auto& stmt : module->getPrelude()) {
+        if (auto* nested = dynamic_cast<const CookbookStmt*>(stmt.get())) {
+            collectModules(directoryOf(module->getPath()), nested->path, found);
+        }
+    }
+}
+
+} // namespace cook
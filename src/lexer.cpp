@@ -15,60 +15,68 @@ static const std::unordered_map<std::string, TokenType> keywords = {
 
 Lexer::Lexer(const std::string& source) : source(source) {}
 
+Lexer::Lexer(const std::string& source, int line, int column)
+    : source(source), line(line), column(column) {}
+
 std::vector<Token> Lexer::tokenize() {
     std::vector<Token> tokens;
     
-    while (!isAtEnd()) {
+    while (true) {
+        tokens.push_back(next());
+        if (tokens.back().type == TokenType::EOF_TOKEN) break;
+    }
+    
+    return tokens;
+}
+
+Token Lexer::next() {
+    while (true) {
         // Skip whitespace and comments
         skipWhitespace();
         
-        if (isAtEnd()) break;
+        if (isAtEnd()) return Token(TokenType::EOF_TOKEN, "", line, column);
         
         // Process the next token
         char c = advance();
         
         switch (c) {
             // Single-character tokens
-            case '(': tokens.push_back(makeToken(TokenType::LPAREN)); break;
-            case ')': tokens.push_back(makeToken(TokenType::RPAREN)); break;
-            case '{': tokens.push_back(makeToken(TokenType::LBRACE)); break;
-            case '}': tokens.push_back(makeToken(TokenType::RBRACE)); break;
-            case ',': tokens.push_back(makeToken(TokenType::COMMA)); break;
-            case ';': tokens.push_back(makeToken(TokenType::SEMICOLON)); break;
+            case '(': return makeToken(TokenType::LPAREN);
+            case ')': return makeToken(TokenType::RPAREN);
+            case '{': return makeToken(TokenType::LBRACE);
+            case '}': return makeToken(TokenType::RBRACE);
+            case ',': return makeToken(TokenType::COMMA);
+            case ';': return makeToken(TokenType::SEMICOLON);
             
             // Operators
-            case '+': tokens.push_back(makeToken(TokenType::PLUS)); break;
-            case '-': tokens.push_back(makeToken(TokenType::MINUS)); break;
-            case '*': tokens.push_back(makeToken(TokenType::MULTIPLY)); break;
+            case '+': return makeToken(TokenType::PLUS);
+            case '-': return makeToken(TokenType::MINUS);
+            case '*': return makeToken(TokenType::MULTIPLY);
             case '/': 
                 if (match('/')) {
                     skipComment();
-                } else {
-                    tokens.push_back(makeToken(TokenType::DIVIDE));
+                    continue;
                 }
-                break;
-            case '=': tokens.push_back(makeToken(TokenType::ASSIGN)); break;
+                return makeToken(TokenType::DIVIDE);
+            case '=':
+                return match('=') ? makeToken(TokenType::EQUAL_EQUAL, 2) : makeToken(TokenType::ASSIGN);
+            case '!':
+                return match('=') ? makeToken(TokenType::BANG_EQUAL, 2) : makeToken(TokenType::BANG);
+            case '<':
+                return match('=') ? makeToken(TokenType::LESS_EQUAL, 2) : makeToken(TokenType::LESS);
+            case '>':
+                return match('=') ? makeToken(TokenType::GREATER_EQUAL, 2) : makeToken(TokenType::GREATER);
             
             // String literals
-            case '"': tokens.push_back(stringToken()); break;
+            case '"': return stringToken();
             
             // Number literals and identifiers
             default:
-                if (std::isdigit(c)) {
-                    tokens.push_back(numberToken());
-                } else if (std::isalpha(c) || c == '_') {
-                    tokens.push_back(identifierToken());
-                } else {
-                    tokens.push_back(makeToken(TokenType::UNKNOWN));
-                }
-                break;
+                if (std::isdigit(c)) return numberToken();
+                if (std::isalpha(c) || c == '_') return identifierToken();
+                return unknownToken(c);
         }
     }
-    
-    // Add EOF token
-    tokens.push_back(Token(TokenType::EOF_TOKEN, "", line, column));
-    
-    return tokens;
 }
 
 char Lexer::peek() {
@@ -97,14 +105,31 @@ Token Lexer::makeToken(TokenType type) {
     return Token(type, std::string(1, source[position - 1]), line, column - 1);
 }
 
+Token Lexer::makeToken(TokenType type, int length) {
+    return Token(type, source.substr(position - length, length), line, column - length);
+}
+
+Token Lexer::unknownToken(char first) {
+    // Keep a multi-byte UTF-8 character whole, so diagnostics can quote it
+    int length = 1;
+    if (static_cast<unsigned char>(first) >= 0xC0) {
+        while (!isAtEnd() && (static_cast<unsigned char>(peek()) & 0xC0) == 0x80) {
+            advance();
+            length++;
+        }
+    }
+    return makeToken(TokenType::UNKNOWN, length);
+}
+
 Token Lexer::stringToken() {
+    int startLine = line;
     int startColumn = column - 1;
     std::string value;
     
     while (!isAtEnd() && peek() != '"') {
         if (peek() == '\n') {
             line++;
-            column = 1;
+            column = 0; // advance() moves past the newline to column 1
         }
         value += advance();
     }
@@ -112,7 +137,7 @@ Token Lexer::stringToken() {
     // Consume the closing quote
     if (!isAtEnd()) advance();
     
-    return Token(TokenType::STRING, value, line, startColumn);
+    return Token(TokenType::STRING, value, startLine, startColumn);
 }
 
 Token Lexer::numberToken() {
@@ -123,10 +148,12 @@ Token Lexer::numberToken() {
         advance();
     }
     
-    // Look for a decimal part
+    // Look for a decimal part; without one the literal is an integer
+    TokenType type = TokenType::INTEGER;
     if (!isAtEnd() && peek() == '.' && std::isdigit(source[position + 1])) {
         // Consume the '.'
         advance();
+        type = TokenType::NUMBER;
         
         while (!isAtEnd() && std::isdigit(peek())) {
             advance();
@@ -134,7 +161,7 @@ Token Lexer::numberToken() {
     }
     
     std::string value = source.substr(start, position - start);
-    return Token(TokenType::NUMBER, value, line, startColumn);
+    return Token(type, value, line, startColumn);
 }
 
 Token Lexer::identifierToken() {
@@ -168,7 +195,7 @@ void Lexer::skipWhitespace() {
                 break;
             case '\n':
                 line++;
-                column = 1;
+                column = 0; // advance() moves past the newline to column 1
                 advance();
                 break;
             default:
@@ -1,6 +1,17 @@
 #include "lexer.h"
 #include "parser.h"
 #include "interpreter.h"
+#include "profiler.h"
+#include "stats.h"
+#include "files.h"
+#include "language_server.h"
+#include "symbol_index.h"
+#include "server.h"
+#include "snapshot.h"
+#include "records.h"
+#include "pipeline.h"
+#include "transpiler.h"
+#include "watch.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -8,6 +19,59 @@
 
 using namespace cook;
 
+// Command line options
+struct Options {
+    std::string script;
+    std::string profilePath;
+    Profiler::Mode profileMode = Profiler::Mode::INSTRUMENT;
+    std::string statsFormat;
+    bool check = false;
+    std::vector<std::string> checkPaths;
+    bool lsp = false;
+    std::string indexRoot;
+    std::string indexQuery;
+    std::string indexName;
+    bool serve = false;
+    std::string socketPath;
+    size_t workers = 0;
+    std::vector<std::string> servePaths;
+    int snapshotAfter = 0;
+    std::string outputPath;
+    std::string restorePath;
+    std::string forEachPath;
+    std::string recipeName;
+    bool pipeline = false;
+    size_t jobs = 1;
+    bool watch = false;
+    bool compile = false;
+    ExecutionBudget budget;
+};
+
+// Per-run settings passed from the command line to run()
+struct RunContext {
+    std::string sourceName = "<stdin>";
+    std::string baseDirectory;
+    Profiler* profiler = nullptr;
+    PhaseTimings* timings = nullptr;
+    ExecutionBudget budget;
+
+    // Stop after the statements starting on or before 'snapshotAfter' and
+    // save the state to 'snapshotPath'; start from the state in 'restorePath'
+    int snapshotAfter = 0;
+    std::string snapshotPath;
+    std::string restorePath;
+
+    // After the script, call 'recipeName' once for each row of 'forEachPath'
+    std::string forEachPath;
+    std::string recipeName;
+
+    // Lex, parse and execute on separate threads at the same time
+    bool pipeline = false;
+
+    // Threads for independent top-level recipe calls; 0 is one per core
+    size_t jobs = 1;
+};
+
 // Read file contents into a string
 std::string readFile(const std::string& path) {
     std::ifstream file(path);
@@ -21,32 +85,347 @@ std::string readFile(const std::string& path) {
     return buffer.str();
 }
 
+// Holds what recipes taste while rows stream through them and writes it in
+// large blocks. Taste flushes after every line, which would otherwise cost a
+// write per row.
+class BlockOutput : public std::streambuf {
+public:
+    explicit BlockOutput(std::ostream& target) : target(target) {}
+    ~BlockOutput() override { drain(); }
+
+    void drain() {
+        target.write(pending.data(), static_cast<std::streamsize>(pending.size()));
+        target.flush();
+        pending.clear();
+    }
+
+protected:
+    int_type overflow(int_type c) override {
+        if (c != traits_type::eof()) pending += static_cast<char>(c);
+        if (pending.size() >= BLOCK_SIZE) drain();
+        return c;
+    }
+
+    std::streamsize xsputn(const char* data, std::streamsize size) override {
+        pending.append(data, static_cast<size_t>(size));
+        if (pending.size() >= BLOCK_SIZE) drain();
+        return size;
+    }
+
+private:
+    static const size_t BLOCK_SIZE = 64 * 1024;
+    std::ostream& target;
+    std::string pending;
+};
+
+// Call a recipe once per row of a CSV or JSON Lines file. Columns or members
+// are matched to the recipe's parameters by name.
+void forEachRow(Interpreter& interpreter, const RunContext& context) {
+    const std::vector<std::string>* parameters = interpreter.recipeParameters(context.recipeName);
+    if (!parameters) {
+        throw std::runtime_error("Undefined recipe '" + context.recipeName + "'");
+    }
+
+    RecordReader::Format format;
+    if (!RecordReader::formatOf(context.forEachPath, format)) {
+        throw std::runtime_error("'" + context.forEachPath + "' is not a .csv, .jsonl or .ndjson file");
+    }
+    RecordReader rows(context.forEachPath, format, *parameters);
+
+    // Output written before an error is drained when 'block' goes away
+    BlockOutput block(std::cout);
+    std::ostream output(&block);
+    interpreter.setOutput(output);
+
+    std::vector<Value> values;
+    while (rows.next(values)) {
+        try {
+            interpreter.callRecipe(context.recipeName, values);
+        } catch (const std::exception& e) {
+            interpreter.setOutput(std::cout);
+            throw std::runtime_error(context.forEachPath + ":" + std::to_string(rows.line()) + ": " + e.what());
+        }
+    }
+    interpreter.setOutput(std::cout);
+}
+
+// Print syntax errors and throw if there are any
+void reportSyntaxErrors(const std::vector<Diagnostic>& diagnostics, const std::string& sourceName) {
+    if (diagnostics.empty()) return;
+    for (const auto& diagnostic : diagnostics) {
+        std::cerr << diagnostic.format(sourceName) << std::endl;
+    }
+    size_t count = diagnostics.size();
+    throw std::runtime_error(std::to_string(count) + (count == 1 ? " syntax error" : " syntax errors"));
+}
+
 // Run a Cook program from source
-void run(const std::string& source) {
-    // Lexical analysis
-    Lexer lexer(source);
-    std::vector<Token> tokens = lexer.tokenize();
+void run(const std::string& source, const RunContext& context = RunContext()) {
+    PhaseTimings unused;
+    PhaseTimings& timings = context.timings ? *context.timings : unused;
+    Stopwatch phase;
 
-    // Parsing
-    Parser parser(tokens);
-    std::unique_ptr<Program> program = parser.parse();
+    // A snapshot replaces the statements before its resume point, which are
+    // then neither lexed nor parsed
+    Snapshot snapshot;
+    if (!context.restorePath.empty()) {
+        snapshot.open(context.restorePath, source);
+    }
+
+    Lexer lexer = context.restorePath.empty()
+                      ? Lexer(source)
+                      : Lexer(source.substr(snapshot.resumeOffset()), snapshot.resumeLine(), snapshot.resumeColumn());
+
+    // Without the pipeline the whole file is lexed and parsed before anything
+    // runs, and a program with syntax errors is refused
+    std::unique_ptr<Program> program;
+    if (!context.pipeline) {
+        std::vector<Token> tokens = lexer.tokenize();
+        timings.lexMs = phase.elapsedMillis();
+
+        phase.reset();
+        Parser parser(std::move(tokens));
+        program = parser.parse();
+        timings.parseMs = phase.elapsedMillis();
+        reportSyntaxErrors(parser.getDiagnostics(), context.sourceName);
+    }
 
     // Interpretation
+    phase.reset();
     Interpreter interpreter;
-    interpreter.interpret(*program);
+    interpreter.setBaseDirectory(context.baseDirectory);
+    interpreter.setProfiler(context.profiler);
+    interpreter.setBudget(context.budget);
+    interpreter.setJobs(context.jobs);
+
+    if (!context.restorePath.empty()) {
+        snapshot.restore(interpreter);
+    }
+
+    size_t last = program ? program->statements.size() : 0;
+    if (context.snapshotAfter > 0) {
+        last = 0;
+        while (last < program->statements.size() && program->statements[last]->line <= context.snapshotAfter) {
+            last++;
+        }
+    }
+
+    auto execute = [&] {
+        if (context.pipeline) {
+            interpreter.startRun();
+            PipelineReport report = runPipelined(std::move(lexer), [&](const Statement& stmt) {
+                interpreter.interpretStatement(stmt);
+            });
+            timings.lexMs = report.lexMs;
+            timings.parseMs = report.parseMs;
+            reportSyntaxErrors(report.diagnostics, context.sourceName);
+        } else {
+            interpreter.interpret(*program, 0, last);
+        }
+        if (!context.forEachPath.empty()) forEachRow(interpreter, context);
+    };
+
+    if (!context.profiler) {
+        execute();
+    } else {
+        context.profiler->start();
+        try {
+            execute();
+        } catch (...) {
+            context.profiler->stop();
+            throw;
+        }
+        context.profiler->stop();
+    }
+
+    if (context.snapshotAfter > 0) {
+        Snapshot::write(context.snapshotPath, interpreter, source, static_cast<uint32_t>(context.snapshotAfter),
+                        last < program->statements.size() ? program->statements[last].get() : nullptr);
+    }
+    timings.executeMs = phase.elapsedMillis();
 }
 
 // Run a Cook program from a file
-void runFile(const std::string& path) {
+void runFile(const std::string& path, const Options& options) {
+    PhaseTimings timings;
+    RunContext context;
+    context.sourceName = path;
+    context.baseDirectory = directoryOf(path);
+    context.timings = &timings;
+    context.budget = options.budget;
+    context.snapshotAfter = options.snapshotAfter;
+    context.snapshotPath = options.outputPath;
+    context.restorePath = options.restorePath;
+    context.forEachPath = options.forEachPath;
+    context.recipeName = options.recipeName;
+    context.pipeline = options.pipeline;
+    context.jobs = options.jobs;
+
     std::cout << "Loading file: " << path << std::endl;
+    Stopwatch reading;
     std::string source = readFile(path);
+    timings.readMs = reading.elapsedMillis();
     std::cout << "File loaded, running..." << std::endl;
-    run(source);
+
+    if (options.profilePath.empty()) {
+        run(source, context);
+    } else {
+        Profiler profiler(options.profileMode);
+        context.profiler = &profiler;
+        run(source, context);
+
+        std::ofstream out(options.profilePath);
+        if (!out.is_open()) {
+            std::cerr << "Could not write profile: " << options.profilePath << std::endl;
+            exit(1);
+        }
+        profiler.writeFolded(out);
+        profiler.writeSummary(std::cerr);
+    }
+
     std::cout << "Execution complete." << std::endl;
+
+    if (options.statsFormat == "json") {
+        writeStatsJson(std::cerr, timings);
+    } else if (options.statsFormat == "text") {
+        writeStatsText(std::cerr, timings);
+    }
+}
+
+// Parse files without running them, reporting every syntax error
+int checkFiles(const std::vector<std::string>& paths) {
+    std::vector<std::string> files;
+    for (const auto& path : paths) {
+        if (isDirectory(path)) {
+            std::vector<std::string> found = findCookFiles(path);
+            files.insert(files.end(), found.begin(), found.end());
+        } else {
+            files.push_back(path);
+        }
+    }
+
+    size_t errors = 0;
+    size_t unreadable = 0;
+    std::string source;
+    for (const auto& file : files) {
+        if (!readWholeFile(file, source)) {
+            std::cerr << file << ": error: could not open file" << std::endl;
+            unreadable++;
+            continue;
+        }
+
+        Parser parser(Lexer(source).tokenize());
+        parser.parse();
+        for (const auto& diagnostic : parser.getDiagnostics()) {
+            std::cerr << diagnostic.format(file) << std::endl;
+        }
+        errors += parser.getDiagnostics().size();
+    }
+
+    std::cout << "Checked " << files.size() << (files.size() == 1 ? " file, " : " files, ")
+              << errors << (errors == 1 ? " error" : " errors") << std::endl;
+    return errors == 0 && unreadable == 0 ? 0 : 1;
+}
+
+// Translate a script to a C++ program
+int compileFile(const Options& options) {
+    std::string source = readFile(options.script);
+    Parser parser(Lexer(source).tokenize());
+    std::unique_ptr<Program> program = parser.parse();
+    reportSyntaxErrors(parser.getDiagnostics(), options.script);
+
+    std::string code = Transpiler(options.script).translate(*program);
+    std::ofstream out(options.outputPath, std::ios::binary);
+    if (!out.is_open() || !out.write(code.data(), static_cast<std::streamsize>(code.size()))) {
+        std::cerr << "Could not write " << options.outputPath << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+// Build the symbol index of a directory, or answer a query from it
+int runIndex(const Options& options) {
+    const std::string& root = options.indexRoot;
+
+    if (options.indexQuery.empty()) {
+        Stopwatch timer;
+        IndexReport report = SymbolIndex::build(root);
+        std::cout << "Indexed " << report.files << (report.files == 1 ? " file (" : " files (")
+                  << report.parsed << " parsed), " << report.entries << " symbols in "
+                  << static_cast<long>(timer.elapsedMillis()) << " ms" << std::endl;
+        if (report.syntaxErrors > 0) {
+            std::cerr << "warning: parsed files have " << report.syntaxErrors
+                      << " syntax errors; run 'cook --check " << root << "' for details" << std::endl;
+        }
+        for (const auto& path : report.unreadable) {
+            std::cerr << "warning: could not read '" << path << "'; its entries were not updated" << std::endl;
+        }
+        return 0;
+    }
+
+    SymbolIndex index;
+    if (!index.open(root)) {
+        std::cerr << "No symbol index in '" << root << "'; run 'cook index " << root << "' first" << std::endl;
+        return 1;
+    }
+
+    size_t matches = 0;
+    for (const auto& entry : index.find(options.indexName)) {
+        bool definition = entry.kind == IndexEntry::Kind::INGREDIENT || entry.kind == IndexEntry::Kind::RECIPE;
+        if (options.indexQuery == "definitions" && !definition) continue;
+        if (options.indexQuery == "references" && definition) continue;
+        if (options.indexQuery == "callers" && entry.kind != IndexEntry::Kind::CALL) continue;
+
+        static const char* const labels[] = {"ingredient", "recipe", "use of", "call to"};
+        std::cout << root << "/" << entry.file << ":" << entry.line << ":" << entry.column << ": "
+                  << labels[static_cast<int>(entry.kind)] << " " << entry.name;
+        if (!entry.scope.empty()) std::cout << " in recipe " << entry.scope;
+        std::cout << "\n";
+        matches++;
+    }
+    std::cout.flush();
+    return matches > 0 ? 0 : 1;
+}
+
+// Load scripts and serve requests for them on a Unix socket
+int runServer(const Options& options) {
+    // Runaway recursion would overflow a worker's stack and take every other
+    // request down with it, so the server always limits call depth
+    ExecutionBudget budget = options.budget;
+    if (budget.maxCallDepth == 0) budget.maxCallDepth = 2000;
+
+    Server server(options.socketPath, options.workers, budget);
+
+    // Files are served under their name without ".cook"; files found in a
+    // directory keep their path below it, e.g. "reports/daily"
+    for (const auto& path : options.servePaths) {
+        if (!isDirectory(path)) {
+            std::string name = path.substr(path.find_last_of("/\\") + 1);
+            if (name.size() > 5 && name.compare(name.size() - 5, 5, ".cook") == 0) name.resize(name.size() - 5);
+            server.addScript(name, path);
+            continue;
+        }
+
+        std::string root = path;
+        while (root.size() > 1 && (root.back() == '/' || root.back() == '\\')) root.pop_back();
+        for (const auto& file : findCookFiles(root)) {
+            std::string name = file.substr(root.size() + 1, file.size() - root.size() - 6);
+            server.addScript(name, file);
+        }
+    }
+
+    if (server.scriptCount() == 0) {
+        std::cerr << "No scripts to serve" << std::endl;
+        return 1;
+    }
+    return server.run();
 }
 
 // Run an interactive REPL
-void runPrompt() {
+void runPrompt(const Options& options) {
+    RunContext context;
+    context.budget = options.budget;
+    context.jobs = options.jobs;
     std::string line;
     std::cout << "Cook Programming Language v0.1.0" << std::endl;
 
@@ -57,22 +436,229 @@ void runPrompt() {
         }
 
         try {
-            run(line);
+            run(line, context);
         } catch (const std::exception& e) {
             std::cerr << "Error: " << e.what() << std::endl;
         }
     }
 }
 
+void printUsage() {
+    std::cout << "Usage: cook [options] [script]" << std::endl;
+    std::cout << "Options:" << std::endl;
+    std::cout << "  --profile=<file>          Write a collapsed-stack profile to <file>" << std::endl;
+    std::cout << "  --profile-mode=<mode>     'instrument' (default) or 'sample'" << std::endl;
+    std::cout << "  --stats=<format>          Print phase timings and counters as 'json' or 'text'" << std::endl;
+    std::cout << "  --check <paths...>        Report syntax errors in files and directories" << std::endl;
+    std::cout << "  --lsp                     Run a language server on stdin/stdout" << std::endl;
+    std::cout << "  --snapshot-after=<line> -o <file>" << std::endl;
+    std::cout << "                            Run statements up to <line>, then save the state to <file>" << std::endl;
+    std::cout << "  --restore <file>          Start from a snapshot of the same script" << std::endl;
+    std::cout << "  --pipeline                Start running statements while the rest of the script" << std::endl;
+    std::cout << "                            is lexed and parsed on other threads" << std::endl;
+    std::cout << "  --watch                   Run the script again whenever it is saved, reusing the" << std::endl;
+    std::cout << "                            statements before the first change" << std::endl;
+    std::cout << "  --jobs=<n>                Run independent top-level recipe calls on <n> threads" << std::endl;
+    std::cout << "                            (default: 1, which runs them in order)" << std::endl;
+    std::cout << "  --for-each <rows> --recipe <name>" << std::endl;
+    std::cout << "                            After the script, call <name> for each row of a .csv or" << std::endl;
+    std::cout << "                            .jsonl file, matching fields to parameters by name" << std::endl;
+    std::cout << "  --max-steps=<n>           Stop after <n> statements and recipe calls" << std::endl;
+    std::cout << "  --max-time=<ms>           Stop after <ms> milliseconds" << std::endl;
+    std::cout << "  --max-depth=<n>           Limit nested recipe calls to <n>" << std::endl;
+    std::cout << "  --max-memory=<bytes>      Limit live string data (K, M or G suffix allowed)" << std::endl;
+    std::cout << std::endl;
+    std::cout << "       cook index <dir> [query]" << std::endl;
+    std::cout << "Build or update the symbol index of <dir>, or query it with:" << std::endl;
+    std::cout << "  --definitions=<name>      Where an ingredient or recipe is declared" << std::endl;
+    std::cout << "  --references=<name>       Every use of an ingredient or call of a recipe" << std::endl;
+    std::cout << "  --callers=<name>          Every call of a recipe" << std::endl;
+    std::cout << std::endl;
+    std::cout << "       cook serve --socket <path> [--workers <n>] [--max-...] <scripts or dirs...>" << std::endl;
+    std::cout << "Keep scripts loaded and run them for requests on a Unix socket" << std::endl;
+    std::cout << std::endl;
+    std::cout << "       cook compile <script> -o <file.cpp>" << std::endl;
+    std::cout << "Translate a script to a C++ program; build it with g++ -std=c++17 -I <cook>/include" << std::endl;
+}
+
+// Parse a positive count such as "5000" or, with suffixes allowed, "64M"
+bool parseLimit(const std::string& text, bool suffixes, uint64_t& value) {
+    size_t end = 0;
+    while (end < text.size() && text[end] >= '0' && text[end] <= '9') end++;
+    if (end == 0 || end > 18) return false;
+
+    value = std::stoull(text.substr(0, end));
+    if (end < text.size()) {
+        if (!suffixes || end + 1 != text.size()) return false;
+        switch (text[end]) {
+            case 'K': case 'k': value <<= 10; break;
+            case 'M': case 'm': value <<= 20; break;
+            case 'G': case 'g': value <<= 30; break;
+            default: return false;
+        }
+    }
+    return value > 0;
+}
+
+// Parse command line arguments; returns false on invalid usage
+bool parseOptions(int argc, char* argv[], Options& options) {
+    if (argc > 1 && std::string(argv[1]) == "index") {
+        if (argc < 3 || argc > 4) return false;
+        options.indexRoot = argv[2];
+        if (argc == 4) {
+            std::string query = argv[3];
+            for (const char* name : {"definitions", "references", "callers"}) {
+                std::string prefix = std::string("--") + name + "=";
+                if (query.compare(0, prefix.size(), prefix) == 0) {
+                    options.indexQuery = name;
+                    options.indexName = query.substr(prefix.size());
+                }
+            }
+            if (options.indexQuery.empty() || options.indexName.empty()) return false;
+        }
+        return true;
+    }
+
+    int first = 1;
+    if (argc > 1 && std::string(argv[1]) == "serve") {
+        options.serve = true;
+        first = 2;
+    } else if (argc > 1 && std::string(argv[1]) == "compile") {
+        options.compile = true;
+        first = 2;
+    }
+
+    for (int i = first; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (options.serve && (arg == "--socket" || arg == "--workers")) {
+            if (i + 1 >= argc) return false;
+            std::string value = argv[++i];
+            if (arg == "--socket") {
+                options.socketPath = value;
+            } else {
+                uint64_t workers = 0;
+                if (!parseLimit(value, false, workers) || workers > 1024) return false;
+                options.workers = static_cast<size_t>(workers);
+            }
+        } else if (options.serve && arg.compare(0, 2, "--") != 0) {
+            options.servePaths.push_back(arg);
+        } else if (arg == "-o" || arg == "--restore") {
+            if (i + 1 >= argc) return false;
+            (arg == "-o" ? options.outputPath : options.restorePath) = argv[++i];
+        } else if (arg == "--for-each" || arg == "--recipe") {
+            if (i + 1 >= argc) return false;
+            (arg == "--for-each" ? options.forEachPath : options.recipeName) = argv[++i];
+        } else if (arg.compare(0, 17, "--snapshot-after=") == 0) {
+            uint64_t line = 0;
+            if (!parseLimit(arg.substr(17), false, line) || line > 1000000000) return false;
+            options.snapshotAfter = static_cast<int>(line);
+        } else if (arg.compare(0, 10, "--profile=") == 0) {
+            options.profilePath = arg.substr(10);
+        } else if (arg == "--profile-mode=instrument") {
+            options.profileMode = Profiler::Mode::INSTRUMENT;
+        } else if (arg == "--profile-mode=sample") {
+            options.profileMode = Profiler::Mode::SAMPLE;
+        } else if (arg == "--stats=json" || arg == "--stats=text") {
+            options.statsFormat = arg.substr(8);
+        } else if (arg == "--pipeline") {
+            options.pipeline = true;
+        } else if (arg == "--watch") {
+            options.watch = true;
+        } else if (arg.compare(0, 7, "--jobs=") == 0) {
+            uint64_t jobs = 0;
+            if (!parseLimit(arg.substr(7), false, jobs) || jobs > 1024) return false;
+            options.jobs = static_cast<size_t>(jobs);
+        } else if (arg == "--lsp") {
+            options.lsp = true;
+        } else if (arg.compare(0, 12, "--max-steps=") == 0) {
+            if (!parseLimit(arg.substr(12), false, options.budget.maxSteps)) return false;
+        } else if (arg.compare(0, 11, "--max-time=") == 0) {
+            if (!parseLimit(arg.substr(11), false, options.budget.maxMillis)) return false;
+        } else if (arg.compare(0, 12, "--max-depth=") == 0) {
+            uint64_t depth = 0;
+            if (!parseLimit(arg.substr(12), false, depth) || depth > 1000000) return false;
+            options.budget.maxCallDepth = static_cast<int>(depth);
+        } else if (arg.compare(0, 13, "--max-memory=") == 0) {
+            uint64_t bytes = 0;
+            if (!parseLimit(arg.substr(13), true, bytes)) return false;
+            options.budget.maxStringBytes = static_cast<size_t>(bytes);
+        } else if (arg == "--check") {
+            options.check = true;
+        } else if (options.check && arg.compare(0, 2, "--") != 0) {
+            options.checkPaths.push_back(arg);
+        } else if (arg.compare(0, 2, "--") == 0 || !options.script.empty()) {
+            return false;
+        } else {
+            options.script = arg;
+        }
+    }
+
+    if (options.check) {
+        return !options.checkPaths.empty();
+    }
+
+    if (options.serve) {
+        return !options.socketPath.empty() && !options.servePaths.empty() && !options.lsp &&
+               options.profilePath.empty() && options.statsFormat.empty();
+    }
+
+    if (options.lsp) {
+        return options.script.empty() && options.profilePath.empty() && options.statsFormat.empty();
+    }
+
+    // Only the script and the output file apply to a translation
+    if (options.compile) {
+        return !options.script.empty() && !options.outputPath.empty() &&
+               options.snapshotAfter == 0 && options.restorePath.empty() && options.forEachPath.empty() &&
+               options.recipeName.empty() && !options.pipeline && options.profilePath.empty() &&
+               options.statsFormat.empty();
+    }
+
+    // A snapshot needs both the line and the output file, and rows need a
+    // recipe. A snapshot is taken before any rows would be read, and needs
+    // the whole program parsed to find where to stop.
+    if ((options.snapshotAfter > 0) != !options.outputPath.empty()) return false;
+    if (options.forEachPath.empty() != options.recipeName.empty()) return false;
+    if (!options.forEachPath.empty() && options.snapshotAfter > 0) return false;
+    if (options.pipeline && options.snapshotAfter > 0) return false;
+
+    // Watching reruns the script alone, with its output as it is printed
+    if (options.watch && (options.pipeline || options.snapshotAfter > 0 || !options.restorePath.empty() ||
+                          !options.forEachPath.empty() || !options.profilePath.empty() ||
+                          !options.statsFormat.empty())) {
+        return false;
+    }
+
+    bool needsScript = !options.profilePath.empty() || !options.statsFormat.empty() ||
+                       options.snapshotAfter > 0 || !options.restorePath.empty() ||
+                       !options.forEachPath.empty() || options.pipeline || options.watch;
+    return !needsScript || !options.script.empty();
+}
+
 int main(int argc, char* argv[]) {
     try {
-        if (argc > 2) {
-            std::cout << "Usage: cook [script]" << std::endl;
+        Options options;
+        if (!parseOptions(argc, argv, options)) {
+            printUsage();
             return 1;
-        } else if (argc == 2) {
-            runFile(argv[1]);
+        } else if (options.check) {
+            return checkFiles(options.checkPaths);
+        } else if (!options.indexRoot.empty()) {
+            return runIndex(options);
+        } else if (options.serve) {
+            return runServer(options);
+        } else if (options.compile) {
+            return compileFile(options);
+        } else if (options.lsp) {
+            LanguageServer server(std::cin, std::cout);
+            return server.run();
+        } else if (options.watch) {
+            return Watcher(options.script, options.budget).run();
+        } else if (!options.script.empty()) {
+            runFile(options.script, options);
         } else {
-            runPrompt();
+            runPrompt(options);
         }
     } catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
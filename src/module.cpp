@@ -0,0 +1,302 @@
+#include "module.h"
+#include "lexer.h"
+#include "parser.h"
+#include "serializer.h"
+#include "files.h"
+#include <fstream>
+#include <stdexcept>
+#include <atomic>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace cook {
+
+// Compiled module header: magic "COOK" followed by the format version
+static const uint32_t MODULE_MAGIC = 0x4B4F4F43;
+static const uint32_t MODULE_VERSION = 7;
+
+// Magic, version, source size, source hash and image length
+static const size_t HEADER_SIZE = 32;
+
+static std::string canonicalPath(const std::string& path) {
+#ifdef _WIN32
+    char buffer[_MAX_PATH];
+    if (_fullpath(buffer, path.c_str(), _MAX_PATH)) return buffer;
+#else
+    char buffer[PATH_MAX];
+    if (realpath(path.c_str(), buffer)) return buffer;
+#endif
+    return path;
+}
+
+// A name beside 'path' that no other process or thread writes at the same
+// time: two processes compiling one cookbook must not share a temporary file
+static std::string temporaryPath(const std::string& path) {
+    static std::atomic<unsigned> counter{0};
+#ifdef _WIN32
+    long pid = static_cast<long>(_getpid());
+#else
+    long pid = static_cast<long>(getpid());
+#endif
+    return path + "." + std::to_string(pid) + "." + std::to_string(counter++) + ".tmp";
+}
+
+static bool isAbsolutePath(const std::string& path) {
+    if (!path.empty() && (path[0] == '/' || path[0] == '\\')) return true;
+    return path.size() > 1 && path[1] == ':';
+}
+
+std::string directoryOf(const std::string& path) {
+    size_t slash = path.find_last_of("/\\");
+    if (slash == std::string::npos) return "";
+    return path.substr(0, slash);
+}
+
+bool isBuiltinCookbook(const std::string& path) {
+    return path.compare(0, 8, "builtin:") == 0;
+}
+
+std::string resolveModulePath(const std::string& baseDirectory, const std::string& path) {
+    if (baseDirectory.empty() || isAbsolutePath(path) || isBuiltinCookbook(path)) return path;
+    return baseDirectory + "/" + path;
+}
+
+// Rewrite nested cookbook paths so they resolve against the module's directory
+static void resolveNestedCookbooks(std::vector<std::unique_ptr<Statement>>& statements,
+                                   const std::string& directory) {
+    for (auto& stmt : statements) {
+        if (auto cookbookStmt = dynamic_cast<CookbookStmt*>(stmt.get())) {
+            cookbookStmt->path = resolveModulePath(directory, cookbookStmt->path);
+        }
+    }
+}
+
+// Module implementation
+std::vector<std::string> Module::getRecipeNames() const {
+    std::vector<std::string> names;
+    for (const auto& entry : recipeOffsets) {
+        names.push_back(entry.first);
+    }
+    return names;
+}
+
+bool Module::hasRecipe(const std::string& name) const {
+    return recipeOffsets.find(name) != recipeOffsets.end();
+}
+
+std::unique_ptr<RecipeStmt> Module::materializeRecipe(const std::string& name) const {
+    auto it = recipeOffsets.find(name);
+    if (it == recipeOffsets.end()) {
+        throw std::runtime_error("Cookbook '" + path + "' has no recipe '" + name + "'");
+    }
+
+    AstReader reader(image.data(), image.size());
+    reader.seek(bodiesOffset + it->second);
+    std::unique_ptr<Statement> stmt = reader.readStatement();
+
+    auto recipe = dynamic_cast<RecipeStmt*>(stmt.get());
+    if (!recipe) {
+        throw std::runtime_error("Corrupt recipe '" + name + "' in cookbook '" + path + "'");
+    }
+    stmt.release();
+
+    std::unique_ptr<RecipeStmt> result(recipe);
+    resolveNestedCookbooks(result->body, directory);
+    return result;
+}
+
+// ModuleCache implementation
+ModuleCache& ModuleCache::instance() {
+    static ModuleCache cache;
+    return cache;
+}
+
+std::string ModuleCache::compile(const std::string& source) {
+    Lexer lexer(source);
+    Parser parser(lexer.tokenize());
+    std::unique_ptr<Program> program = parser.parse();
+
+    if (parser.hadError()) {
+        const Diagnostic& first = parser.getDiagnostics().front();
+        throw std::runtime_error("line " + std::to_string(first.line) + ", column " +
+                                 std::to_string(first.column) + ": " + first.message);
+    }
+
+    // Split top-level statements into eagerly run statements and recipes
+    AstWriter prelude;
+    AstWriter bodies;
+    std::vector<std::pair<std::string, uint64_t>> recipes;
+    uint32_t preludeCount = 0;
+
+    for (const auto& stmt : program->statements) {
+        if (auto recipeStmt = dynamic_cast<const RecipeStmt*>(stmt.get())) {
+            recipes.emplace_back(recipeStmt->name, bodies.size());
+            bodies.writeStatement(recipeStmt);
+        } else {
+            prelude.writeStatement(stmt.get());
+            preludeCount++;
+        }
+    }
+
+    AstWriter index;
+    index.writeU32(preludeCount);
+    index.writeU32(static_cast<uint32_t>(recipes.size()));
+    for (const auto& recipe : recipes) {
+        index.writeString(recipe.first);
+        index.writeU64(recipe.second);
+    }
+
+    // The length lets a load tell a cache cut short from a complete one
+    AstWriter image;
+    image.writeU32(MODULE_MAGIC);
+    image.writeU32(MODULE_VERSION);
+    image.writeU64(source.size());
+    image.writeU64(contentHash(source));
+    image.writeU64(HEADER_SIZE + index.size() + prelude.size() + bodies.size());
+
+    return image.data() + index.data() + prelude.data() + bodies.data();
+}
+
+std::unique_ptr<Module> ModuleCache::decode(const std::string& path, std::string image) {
+    auto module = std::make_unique<Module>();
+    module->path = path;
+    module->directory = directoryOf(path);
+    module->image = std::move(image);
+
+    AstReader reader(module->image.data(), module->image.size());
+    reader.seek(HEADER_SIZE);
+    uint32_t preludeCount = reader.readU32();
+    uint32_t recipeCount = reader.readU32();
+
+    for (uint32_t i = 0; i < recipeCount; i++) {
+        std::string name = reader.readString();
+        module->recipeOffsets[name] = reader.readU64();
+    }
+
+    for (uint32_t i = 0; i < preludeCount; i++) {
+        module->prelude.push_back(reader.readStatement());
+    }
+    module->bodiesOffset = reader.position();
+
+    resolveNestedCookbooks(module->prelude, module->directory);
+    return module;
+}
+
+void ModuleCache::setRevalidate(bool enabled) {
+    std::lock_guard<std::mutex> lock(mutex);
+    revalidate = enabled;
+}
+
+std::unique_ptr<Module> ModuleCache::compileFile(const std::string& path) {
+    std::string key = canonicalPath(path);
+    std::string source;
+    if (!readWholeFile(key, source)) {
+        throw std::runtime_error("Could not open cookbook '" + path + "'");
+    }
+
+    std::string image;
+    try {
+        image = compile(source);
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Syntax error in cookbook '" + path + "' at " + e.what());
+    }
+    return decode(key, std::move(image));
+}
+
+const Module& ModuleCache::load(const std::string& path) {
+    std::string key = canonicalPath(path);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    auto it = modules.find(key);
+    if (it != modules.end()) {
+        if (!revalidate) return *it->second;
+
+        // A file that has gone away keeps its last version
+        uint64_t size = 0, modified = 0;
+        if (!fileStatus(key, size, modified) ||
+            (size == it->second->sourceSize && modified == it->second->sourceModified)) {
+            return *it->second;
+        }
+        retired.push_back(std::move(it->second));
+        modules.erase(it);
+    }
+
+    // Taken before reading, so a write racing the read shows up next time
+    uint64_t sourceSize = 0, sourceModified = 0;
+    fileStatus(key, sourceSize, sourceModified);
+
+    std::string source;
+    if (!readWholeFile(key, source)) {
+        throw std::runtime_error("Could not open cookbook '" + path + "'");
+    }
+
+    // Reuse the compiled form when it was made from the same source. Times
+    // are too coarse to notice a quick same-size edit, so compare contents.
+    std::string cachePath = key + "c";
+    std::string image;
+    std::unique_ptr<Module> module;
+    if (readWholeFile(cachePath, image) && image.size() >= HEADER_SIZE) {
+        AstReader header(image.data(), image.size());
+        bool fresh = header.readU32() == MODULE_MAGIC &&
+                     header.readU32() == MODULE_VERSION &&
+                     header.readU64() == source.size() &&
+                     header.readU64() == contentHash(source) &&
+                     header.readU64() == image.size();
+        if (fresh) {
+            // A damaged cache is rebuilt from the source below
+            try {
+                module = decode(key, std::move(image));
+            } catch (const std::exception&) {
+                module.reset();
+            }
+        }
+    }
+
+    if (!module) {
+        try {
+            image = compile(source);
+        } catch (const std::exception& e) {
+            throw std::runtime_error("Syntax error in cookbook '" + path + "' at " + e.what());
+        }
+
+        // The cache is best effort; a read-only directory just means
+        // recompiling. Write beside it and rename, so a concurrent load never
+        // reads a partial file.
+        std::string temporary = temporaryPath(cachePath);
+        bool written;
+        {
+            std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+            out.write(image.data(), static_cast<std::streamsize>(image.size()));
+            written = out.is_open() && static_cast<bool>(out);
+        }
+        if (written) {
+#ifdef _WIN32
+            std::remove(cachePath.c_str());
+#endif
+            if (std::rename(temporary.c_str(), cachePath.c_str()) != 0) written = false;
+        }
+        if (!written) std::remove(temporary.c_str());
+
+        try {
+            module = decode(key, std::move(image));
+        } catch (const std::exception& e) {
+            throw std::runtime_error("Could not load cookbook '" + path + "': " + e.what());
+        }
+    }
+
+    module->sourceSize = sourceSize;
+    module->sourceModified = sourceModified;
+    const Module& result = *module;
+    modules[key] = std::move(module);
+    return result;
+}
+
+} // namespace cook
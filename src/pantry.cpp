@@ -0,0 +1,208 @@
+#include "pantry.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <stdexcept>
+
+namespace cook {
+
+namespace {
+
+// Whole numbers that fit in 64 bits become integers
+Value whole(double number) {
+    if (number >= -9223372036854775808.0 && number < 9223372036854775808.0) {
+        return Value::integer(static_cast<int64_t>(number));
+    }
+    return number;
+}
+
+// Math
+
+Value absolute(const Value& x) {
+    if (!x.isNumber()) native::wrongArgument("abs", 1, "a number");
+    if (x.isInteger() && x.getInteger() != INT64_MIN) return Value::integer(std::abs(x.getInteger()));
+    return std::fabs(x.getNumber());
+}
+
+// The smaller or larger of two numbers, keeping its type
+Value pick(const char* recipe, const Value& a, const Value& b, bool larger) {
+    if (!a.isNumber()) native::wrongArgument(recipe, 1, "a number");
+    if (!b.isNumber()) native::wrongArgument(recipe, 2, "a number");
+    bool first = a.isInteger() && b.isInteger() ? (a.getInteger() < b.getInteger()) != larger
+                                                 : (a.getNumber() < b.getNumber()) != larger;
+    return first ? a : b;
+}
+
+Value minimum(const Value& a, const Value& b) {
+    return pick("min", a, b, false);
+}
+
+Value maximum(const Value& a, const Value& b) {
+    return pick("max", a, b, true);
+}
+
+Value roundDown(double x) {
+    return whole(std::floor(x));
+}
+
+Value roundUp(double x) {
+    return whole(std::ceil(x));
+}
+
+Value roundNearest(double x) {
+    return whole(std::round(x));
+}
+
+// 'x' rounded to 'places' decimal places (tens, hundreds... when negative)
+double roundTo(double x, int64_t places) {
+    if (places < -308 || places > 308) throw std::runtime_error("round_to: places must be within 308");
+    double scale = std::pow(10.0, static_cast<double>(places));
+    return std::round(x * scale) / scale;
+}
+
+double squareRoot(double x) {
+    if (x < 0) throw std::runtime_error("Square root of a negative number");
+    return std::sqrt(x);
+}
+
+double power(double base, double exponent) {
+    return std::pow(base, exponent);
+}
+
+// Strings. Positions count bytes from 0.
+
+int64_t length(std::string_view s) {
+    return static_cast<int64_t>(s.size());
+}
+
+std::string upper(std::string s) {
+    for (char& c : s) c = static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+    return s;
+}
+
+std::string lower(std::string s) {
+    for (char& c : s) c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    return s;
+}
+
+std::string trim(std::string_view s) {
+    const char* space = " \t\r\n\f\v";
+    size_t first = s.find_first_not_of(space);
+    if (first == std::string_view::npos) return "";
+    return std::string(s.substr(first, s.find_last_not_of(space) - first + 1));
+}
+
+std::string repeat(std::string_view s, int64_t count) {
+    if (count < 0) throw std::runtime_error("repeat: count must not be negative");
+    if (count > 0 && s.size() > std::string().max_size() / static_cast<uint64_t>(count)) {
+        throw std::runtime_error("repeat: result is too long");
+    }
+    size_t size = s.size() * static_cast<size_t>(count);
+    native::reserveString(size);
+
+    std::string result;
+    result.reserve(size);
+    for (int64_t i = 0; i < count; i++) result += s;
+    return result;
+}
+
+bool contains(std::string_view s, std::string_view part) {
+    return s.find(part) != std::string_view::npos;
+}
+
+// Position of the first 'part' in 's', or -1
+int64_t find(std::string_view s, std::string_view part) {
+    size_t position = s.find(part);
+    return position == std::string_view::npos ? -1 : static_cast<int64_t>(position);
+}
+
+// Up to 'count' bytes from 'start'; parts outside the string are left out
+std::string substring(std::string_view s, int64_t start, int64_t count) {
+    int64_t size = static_cast<int64_t>(s.size());
+    start = std::min(std::max<int64_t>(start, 0), size);
+    count = std::min(std::max<int64_t>(count, 0), size - start);
+    return std::string(s.substr(static_cast<size_t>(start), static_cast<size_t>(count)));
+}
+
+// Every 'from' in 's' replaced with 'to'
+std::string replace(std::string_view s, std::string_view from, std::string_view to) {
+    if (from.empty()) return std::string(s);
+
+    std::string result;
+    size_t position = 0;
+    for (size_t found; (found = s.find(from, position)) != std::string_view::npos; position = found + from.size()) {
+        result.append(s, position, found - position);
+        result.append(to);
+    }
+    result.append(s, position, std::string_view::npos);
+    return result;
+}
+
+// Conversions
+
+// The text concatenation would give for a value
+std::string text(const Value& value) {
+    if (value.isString()) return value.getString();
+    if (value.isInteger()) return std::to_string(static_cast<long long>(value.getInteger()));
+    return std::to_string(value.getNumber());
+}
+
+// The number written in 's': an integer if it is whole and fits, otherwise
+// a double. Only the lexer's number syntax is accepted, with an optional
+// leading '-': digits, optionally followed by '.' and more digits
+Value number(std::string s) {
+    size_t position = !s.empty() && s[0] == '-' ? 1 : 0;
+    size_t digits = position;
+    while (position < s.size() && std::isdigit(static_cast<unsigned char>(s[position]))) position++;
+    bool valid = position > digits;
+    bool fraction = valid && position < s.size() && s[position] == '.';
+    if (fraction) {
+        size_t decimals = ++position;
+        while (position < s.size() && std::isdigit(static_cast<unsigned char>(s[position]))) position++;
+        valid = position > decimals;
+    }
+    if (!valid || position != s.size()) {
+        throw std::runtime_error("Cannot read '" + s + "' as a number");
+    }
+
+    if (!fraction) {
+        errno = 0;
+        long long integer = std::strtoll(s.c_str(), nullptr, 10);
+        if (errno == 0) return Value::integer(integer);
+    }
+    return std::strtod(s.c_str(), nullptr);
+}
+
+} // namespace
+
+const std::vector<NativeDefinition>* builtinCookbook(const std::string& path) {
+    static const std::vector<NativeDefinition> pantry = {
+        {"abs", absolute},
+        {"min", minimum},
+        {"max", maximum},
+        {"floor", roundDown},
+        {"ceil", roundUp},
+        {"round", roundNearest},
+        {"round_to", roundTo},
+        {"sqrt", squareRoot},
+        {"pow", power},
+        {"length", length},
+        {"upper", upper},
+        {"lower", lower},
+        {"trim", trim},
+        {"repeat", repeat},
+        {"contains", contains},
+        {"find", find},
+        {"substring", substring},
+        {"replace", replace},
+        {"text", text},
+        {"number", number},
+    };
+
+    if (path == "builtin:pantry") return &pantry;
+    return nullptr;
+}
+
+} // namespace cook
@@ -1,42 +1,140 @@
 #include "parser.h"
-#include <stdexcept>
 
 namespace cook {
 
+namespace {
+
+// Binding strength of operators, loosest first
+enum Precedence {
+    PREC_NONE,
+    PREC_ASSIGNMENT,  // =
+    PREC_EQUALITY,    // == !=
+    PREC_COMPARISON,  // < <= > >=
+    PREC_TERM,        // + -
+    PREC_FACTOR,      // * /
+    PREC_UNARY        // - !
+};
+
+struct InfixOperator {
+    TokenType type;
+    Precedence precedence;
+    BinaryExpr::Operator op;
+};
+
+// Every binary operator and its precedence
+const InfixOperator INFIX_OPERATORS[] = {
+    {TokenType::EQUAL_EQUAL,   PREC_EQUALITY,   BinaryExpr::Operator::EQUAL},
+    {TokenType::BANG_EQUAL,    PREC_EQUALITY,   BinaryExpr::Operator::NOT_EQUAL},
+    {TokenType::LESS,          PREC_COMPARISON, BinaryExpr::Operator::LESS},
+    {TokenType::LESS_EQUAL,    PREC_COMPARISON, BinaryExpr::Operator::LESS_EQUAL},
+    {TokenType::GREATER,       PREC_COMPARISON, BinaryExpr::Operator::GREATER},
+    {TokenType::GREATER_EQUAL, PREC_COMPARISON, BinaryExpr::Operator::GREATER_EQUAL},
+    {TokenType::PLUS,          PREC_TERM,       BinaryExpr::Operator::ADD},
+    {TokenType::MINUS,         PREC_TERM,       BinaryExpr::Operator::SUBTRACT},
+    {TokenType::MULTIPLY,      PREC_FACTOR,     BinaryExpr::Operator::MULTIPLY},
+    {TokenType::DIVIDE,        PREC_FACTOR,     BinaryExpr::Operator::DIVIDE},
+};
+
+// INFIX_OPERATORS indexed by token type; null for other tokens
+struct InfixTable {
+    const InfixOperator* rules[static_cast<size_t>(TokenType::UNKNOWN) + 1] = {};
+    
+    InfixTable() {
+        for (const auto& infix : INFIX_OPERATORS) {
+            rules[static_cast<size_t>(infix.type)] = &infix;
+        }
+    }
+};
+
+const InfixTable INFIX_TABLE;
+
+} // namespace
+
+std::string Diagnostic::format(const std::string& sourceName) const {
+    return sourceName + ":" + std::to_string(line) + ":" + std::to_string(column) +
+           ": error: " + message;
+}
+
 Parser::Parser(const std::vector<Token>& tokens) : tokens(tokens) {}
 
+Parser::Parser(std::vector<Token>&& tokens) : tokens(std::move(tokens)) {}
+
+Parser::Parser(std::function<Token()> source) : source(std::move(source)) {
+    tokens.reserve(256);
+    tokens.push_back(this->source());
+}
+
 std::unique_ptr<Program> Parser::parse() {
     auto program = std::make_unique<Program>();
     
+    while (auto stmt = next()) {
+        program->statements.push_back(std::move(stmt));
+    }
+    
+    return program;
+}
+
+std::unique_ptr<Statement> Parser::next() {
     while (!isAtEnd()) {
-        try {
-            program->statements.push_back(declaration());
-        } catch (const std::exception& e) {
-            synchronize();
+        // A streaming parser only needs the previous token from here on
+        if (source && current > 1) {
+            tokens.erase(tokens.begin(), tokens.begin() + (current - 1));
+            current = 1;
+            retired.clear();
         }
+        
+        // A stray '}' has nothing to close at the top level; report it once
+        // and drop it, rather than letting it end every statement after it
+        if (check(TokenType::RBRACE)) {
+            error(peek(), "Unexpected '}' outside a recipe body");
+            advance();
+            continue;
+        }
+        
+        auto stmt = declaration();
+        if (stmt) return stmt;
+        
+        synchronize();
     }
     
-    return program;
+    return nullptr;
 }
 
-Token Parser::peek() {
+const Token& Parser::peek() const {
     return tokens[current];
 }
 
-Token Parser::previous() {
+const Token& Parser::previous() const {
     return tokens[current - 1];
 }
 
-Token Parser::advance() {
-    if (!isAtEnd()) current++;
+const Token& Parser::advance() {
+    if (!isAtEnd()) {
+        current++;
+        if (source && current == static_cast<int>(tokens.size())) pull();
+    }
     return previous();
 }
 
-bool Parser::isAtEnd() {
+void Parser::pull() {
+    // Growing the buffer would move tokens that the rules being parsed still
+    // refer to, so copy them to a larger one and keep this one until the
+    // statement is finished
+    if (tokens.size() == tokens.capacity()) {
+        std::vector<Token> larger;
+        larger.reserve(tokens.capacity() * 2);
+        larger.insert(larger.end(), tokens.begin(), tokens.end());
+        retired.push_back(std::move(tokens));
+        tokens = std::move(larger);
+    }
+    tokens.push_back(source());
+}
+
+bool Parser::isAtEnd() const {
     return peek().type == TokenType::EOF_TOKEN;
 }
 
-bool Parser::check(TokenType type) {
+bool Parser::check(TokenType type) const {
     if (isAtEnd()) return false;
     return peek().type == type;
 }
@@ -59,142 +157,208 @@ bool Parser::match(std::initializer_list<TokenType> types) {
     return false;
 }
 
-Token Parser::consume(TokenType type, const std::string& message) {
-    if (check(type)) return advance();
+bool Parser::consume(TokenType type, const char* message) {
+    if (check(type)) {
+        advance();
+        return true;
+    }
     
-    throw std::runtime_error(message + " at line " + 
-                            std::to_string(peek().line) + 
-                            ", column " + std::to_string(peek().column));
+    error(peek(), message);
+    return false;
+}
+
+void Parser::error(const Token& token, const std::string& message) {
+    // A character the lexer did not recognize is the error, whatever rule
+    // ran into it
+    if (token.type == TokenType::UNKNOWN) {
+        diagnostics.push_back(Diagnostic{token.line, token.column, "Unexpected character '" + token.lexeme + "'"});
+        return;
+    }
+    diagnostics.push_back(Diagnostic{token.line, token.column, message});
 }
 
 std::unique_ptr<Statement> Parser::declaration() {
     if (match(TokenType::INGREDIENT)) return ingredientDeclaration();
     if (match(TokenType::RECIPE)) return recipeDeclaration();
+    if (match(TokenType::COOKBOOK)) return cookbookDeclaration();
     
     return statement();
 }
 
 std::unique_ptr<Statement> Parser::ingredientDeclaration() {
-    Token name = consume(TokenType::IDENTIFIER, "Expect ingredient name");
+    const Token& keyword = previous();
+    if (!consume(TokenType::IDENTIFIER, "Expect ingredient name")) return nullptr;
+    const Token& name = previous();
     
     std::unique_ptr<Expression> initializer = nullptr;
     if (match(TokenType::ASSIGN)) {
         initializer = expression();
+        if (!initializer) return nullptr;
     }
     
-    consume(TokenType::SEMICOLON, "Expect ';' after ingredient declaration");
-    return std::make_unique<IngredientStmt>(name.lexeme, std::move(initializer));
+    if (!consume(TokenType::SEMICOLON, "Expect ';' after ingredient declaration")) return nullptr;
+    return located(std::make_unique<IngredientStmt>(name.lexeme, std::move(initializer)), keyword);
 }
 
 std::unique_ptr<Statement> Parser::recipeDeclaration() {
-    Token name = consume(TokenType::IDENTIFIER, "Expect recipe name");
+    const Token& keyword = previous();
+    if (!consume(TokenType::IDENTIFIER, "Expect recipe name")) return nullptr;
+    const Token& name = previous();
     
-    consume(TokenType::LPAREN, "Expect '(' after recipe name");
+    if (!consume(TokenType::LPAREN, "Expect '(' after recipe name")) return nullptr;
     
     std::vector<std::string> parameters;
     if (!check(TokenType::RPAREN)) {
         do {
-            Token param = consume(TokenType::IDENTIFIER, "Expect parameter name");
-            parameters.push_back(param.lexeme);
+            if (!consume(TokenType::IDENTIFIER, "Expect parameter name")) return nullptr;
+            parameters.push_back(previous().lexeme);
         } while (match(TokenType::COMMA));
     }
     
-    consume(TokenType::RPAREN, "Expect ')' after parameters");
-    consume(TokenType::LBRACE, "Expect '{' before recipe body");
+    if (!consume(TokenType::RPAREN, "Expect ')' after parameters")) return nullptr;
+    if (!consume(TokenType::LBRACE, "Expect '{' before recipe body")) return nullptr;
     
+    // Recover inside the body so one bad statement does not end the recipe
     std::vector<std::unique_ptr<Statement>> body;
     while (!check(TokenType::RBRACE) && !isAtEnd()) {
-        body.push_back(declaration());
+        auto stmt = declaration();
+        if (stmt) {
+            body.push_back(std::move(stmt));
+        } else {
+            synchronize();
+        }
     }
     
+    // An unclosed body is still reported, but keep the recipe so tools that
+    // read partial programs see its parameters and statements
     consume(TokenType::RBRACE, "Expect '}' after recipe body");
     
-    return std::make_unique<RecipeStmt>(name.lexeme, std::move(parameters), std::move(body));
+    return located(std::make_unique<RecipeStmt>(name.lexeme, std::move(parameters), std::move(body)),
+                   keyword);
+}
+
+std::unique_ptr<Statement> Parser::cookbookDeclaration() {
+    const Token& keyword = previous();
+    if (!consume(TokenType::STRING, "Expect cookbook path")) return nullptr;
+    const Token& path = previous();
+    if (!consume(TokenType::SEMICOLON, "Expect ';' after cookbook path")) return nullptr;
+    return located(std::make_unique<CookbookStmt>(path.lexeme), keyword);
 }
 
 std::unique_ptr<Statement> Parser::statement() {
     if (match(TokenType::TASTE)) {
+        const Token& keyword = previous();
+        auto expr = expression();
+        if (!expr) return nullptr;
+        if (!consume(TokenType::SEMICOLON, "Expect ';' after taste statement")) return nullptr;
+        return located(std::make_unique<TasteStmt>(std::move(expr)), keyword);
+    }
+    
+    if (match(TokenType::COOK)) {
+        const Token& keyword = previous();
+        const Token& start = peek();
         auto expr = expression();
-        consume(TokenType::SEMICOLON, "Expect ';' after taste statement");
-        return std::make_unique<TasteStmt>(std::move(expr));
+        if (!expr) return nullptr;
+        if (!dynamic_cast<CallExpr*>(expr.get())) {
+            error(start, "Expect recipe call after 'cook'");
+            return nullptr;
+        }
+        if (!consume(TokenType::SEMICOLON, "Expect ';' after cook statement")) return nullptr;
+        return located(std::make_unique<ExpressionStmt>(std::move(expr)), keyword);
     }
     
     return expressionStatement();
 }
 
 std::unique_ptr<Statement> Parser::expressionStatement() {
+    const Token& start = peek();
     auto expr = expression();
-    consume(TokenType::SEMICOLON, "Expect ';' after expression");
-    return std::make_unique<ExpressionStmt>(std::move(expr));
+    if (!expr) return nullptr;
+    if (!consume(TokenType::SEMICOLON, "Expect ';' after expression")) return nullptr;
+    return located(std::make_unique<ExpressionStmt>(std::move(expr)), start);
 }
 
 std::unique_ptr<Expression> Parser::expression() {
-    return assignment();
+    return parsePrecedence(PREC_ASSIGNMENT);
 }
 
-std::unique_ptr<Expression> Parser::assignment() {
-    auto expr = term();
+std::unique_ptr<Expression> Parser::parsePrecedence(int minimum) {
+    const Token& start = peek();
+    auto expr = unary();
+    if (!expr) return nullptr;
     
-    if (match(TokenType::ASSIGN)) {
-        auto value = assignment();
-        
-        if (auto* varExpr = dynamic_cast<VariableExpr*>(expr.get())) {
-            return std::make_unique<AssignExpr>(varExpr->name, std::move(value));
+    while (true) {
+        // Assignment is right-associative and needs a variable on the left
+        if (minimum <= PREC_ASSIGNMENT && check(TokenType::ASSIGN)) {
+            const Token& equals = advance();
+            auto value = parsePrecedence(PREC_ASSIGNMENT);
+            if (!value) return nullptr;
+            
+            if (auto* varExpr = dynamic_cast<VariableExpr*>(expr.get())) {
+                return located(std::make_unique<AssignExpr>(varExpr->name, std::move(value)), start);
+            }
+            
+            error(equals, "Invalid assignment target");
+            return nullptr;
         }
         
-        throw std::runtime_error("Invalid assignment target");
-    }
-    
-    return expr;
-}
-
-std::unique_ptr<Expression> Parser::term() {
-    auto expr = factor();
-    
-    while (match({TokenType::PLUS, TokenType::MINUS})) {
-        TokenType op = previous().type;
-        auto right = factor();
+        const InfixOperator* infix = INFIX_TABLE.rules[static_cast<size_t>(peek().type)];
+        if (!infix || infix->precedence < minimum) break;
         
-        BinaryExpr::Operator binOp = (op == TokenType::PLUS) 
-                                    ? BinaryExpr::Operator::ADD 
-                                    : BinaryExpr::Operator::SUBTRACT;
+        // Operands on the right bind tighter, so operators of equal
+        // precedence group to the left
+        const Token& opToken = advance();
+        auto right = parsePrecedence(infix->precedence + 1);
+        if (!right) return nullptr;
         
-        expr = std::make_unique<BinaryExpr>(binOp, std::move(expr), std::move(right));
+        expr = located(std::make_unique<BinaryExpr>(infix->op, std::move(expr), std::move(right)), opToken);
     }
     
     return expr;
 }
 
-std::unique_ptr<Expression> Parser::factor() {
-    auto expr = primary();
+std::unique_ptr<Expression> Parser::unary() {
+    if (!match({TokenType::MINUS, TokenType::BANG})) return primary();
     
-    while (match({TokenType::MULTIPLY, TokenType::DIVIDE})) {
-        TokenType op = previous().type;
-        auto right = primary();
-        
-        BinaryExpr::Operator binOp = (op == TokenType::MULTIPLY) 
-                                    ? BinaryExpr::Operator::MULTIPLY 
-                                    : BinaryExpr::Operator::DIVIDE;
-        
-        expr = std::make_unique<BinaryExpr>(binOp, std::move(expr), std::move(right));
+    const Token& opToken = previous();
+    auto operand = unary();
+    if (!operand) return nullptr;
+    
+    // Negative number literals are folded into the literal. A literal without
+    // a decimal point is an integer even if it was too large on its own, so
+    // that -9223372036854775808 is INT64_MIN rather than a double.
+    auto* literal = dynamic_cast<LiteralExpr*>(operand.get());
+    if (opToken.type == TokenType::MINUS && literal && literal->type != LiteralExpr::Type::STRING) {
+        const std::string& value = literal->value;
+        LiteralExpr::Type type = value.find('.') == std::string::npos ? LiteralExpr::Type::INTEGER : literal->type;
+        return located(std::make_unique<LiteralExpr>(type, value[0] == '-' ? value.substr(1) : "-" + value),
+                       opToken);
     }
     
-    return expr;
+    UnaryExpr::Operator op = opToken.type == TokenType::MINUS ? UnaryExpr::Operator::NEGATE
+                                                              : UnaryExpr::Operator::NOT;
+    return located(std::make_unique<UnaryExpr>(op, std::move(operand)), opToken);
 }
 
 std::unique_ptr<Expression> Parser::primary() {
     if (match(TokenType::NUMBER)) {
-        return std::make_unique<LiteralExpr>(
-            LiteralExpr::Type::NUMBER, previous().lexeme);
+        return located(std::make_unique<LiteralExpr>(
+            LiteralExpr::Type::NUMBER, previous().lexeme), previous());
+    }
+    
+    if (match(TokenType::INTEGER)) {
+        return located(std::make_unique<LiteralExpr>(
+            LiteralExpr::Type::INTEGER, previous().lexeme), previous());
     }
     
     if (match(TokenType::STRING)) {
-        return std::make_unique<LiteralExpr>(
-            LiteralExpr::Type::STRING, previous().lexeme);
+        return located(std::make_unique<LiteralExpr>(
+            LiteralExpr::Type::STRING, previous().lexeme), previous());
     }
     
     if (match(TokenType::IDENTIFIER)) {
-        std::string name = previous().lexeme;
+        const Token& nameToken = previous();
+        std::string name = nameToken.lexeme;
         
         // Check if it's a function call
         if (match(TokenType::LPAREN)) {
@@ -202,39 +366,50 @@ std::unique_ptr<Expression> Parser::primary() {
             
             if (!check(TokenType::RPAREN)) {
                 do {
-                    arguments.push_back(expression());
+                    auto arg = expression();
+                    if (!arg) return nullptr;
+                    arguments.push_back(std::move(arg));
                 } while (match(TokenType::COMMA));
             }
             
-            consume(TokenType::RPAREN, "Expect ')' after arguments");
+            if (!consume(TokenType::RPAREN, "Expect ')' after arguments")) return nullptr;
             
-            return std::make_unique<CallExpr>(name, std::move(arguments));
+            return located(std::make_unique<CallExpr>(name, std::move(arguments)), nameToken);
         }
         
         // Otherwise it's a variable reference
-        return std::make_unique<VariableExpr>(name);
+        return located(std::make_unique<VariableExpr>(name), nameToken);
     }
     
     if (match(TokenType::LPAREN)) {
         auto expr = expression();
-        consume(TokenType::RPAREN, "Expect ')' after expression");
+        if (!expr) return nullptr;
+        if (!consume(TokenType::RPAREN, "Expect ')' after expression")) return nullptr;
         return expr;
     }
     
-    throw std::runtime_error("Expect expression");
+    if (peek().type == TokenType::UNKNOWN) {
+        error(peek(), "Unexpected character '" + peek().lexeme + "'");
+    } else {
+        error(peek(), "Expect expression");
+    }
+    return nullptr;
 }
 
 void Parser::synchronize() {
-    advance();
+    // A closing brace ends the enclosing recipe body, so leave it in place
+    if (!check(TokenType::RBRACE)) advance();
     
     while (!isAtEnd()) {
-        if (previous().type == TokenType::SEMICOLON) return;
+        if (current > 0 && previous().type == TokenType::SEMICOLON) return;
         
         switch (peek().type) {
             case TokenType::INGREDIENT:
             case TokenType::RECIPE:
             case TokenType::COOKBOOK:
+            case TokenType::COOK:
             case TokenType::TASTE:
+            case TokenType::RBRACE:
                 return;
             default:
                 break;
@@ -0,0 +1,98 @@
+#include "pipeline.h"
+#include "bounded_queue.h"
+#include "stats.h"
+#include <exception>
+#include <memory>
+#include <thread>
+
+#ifndef _WIN32
+#include <csignal>
+#include <pthread.h>
+#endif
+
+namespace cook {
+
+// Tokens and statements in flight between the stages
+static const size_t TOKEN_QUEUE_DEPTH = 1024;
+static const size_t STATEMENT_QUEUE_DEPTH = 64;
+
+// The sampling profiler reads the executing thread's frame stack from its
+// SIGPROF handler, so the lexer and parser threads must never take the signal
+static void blockProfileSignal() {
+#ifndef _WIN32
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGPROF);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+#endif
+}
+
+PipelineReport runPipelined(Lexer lexer, const std::function<void(const Statement&)>& execute) {
+    BoundedQueue<Token> tokens(TOKEN_QUEUE_DEPTH);
+    BoundedQueue<std::unique_ptr<Statement>> statements(STATEMENT_QUEUE_DEPTH);
+    PipelineReport report;
+    std::exception_ptr lexerError;
+    std::exception_ptr parserError;
+
+    std::thread lexing([&] {
+        blockProfileSignal();
+        Stopwatch timer;
+        try {
+            while (true) {
+                Token token = lexer.next();
+                bool last = token.type == TokenType::EOF_TOKEN;
+                if (!tokens.push(std::move(token)) || last) break;
+            }
+        } catch (...) {
+            lexerError = std::current_exception();
+        }
+        tokens.close();
+        report.lexMs = timer.elapsedMillis();
+    });
+
+    std::thread parsing([&] {
+        blockProfileSignal();
+        Stopwatch timer;
+        try {
+            // An end of file stands in for the tokens of a lexer that failed
+            Parser parser([&tokens] {
+                Token token(TokenType::EOF_TOKEN, "", 0, 0);
+                tokens.pop(token);
+                return token;
+            });
+            while (auto stmt = parser.next()) {
+                if (parser.hadError()) continue;
+                if (!statements.push(std::move(stmt))) break;
+            }
+            report.diagnostics = parser.getDiagnostics();
+        } catch (...) {
+            parserError = std::current_exception();
+        }
+        statements.close();
+
+        // Release the lexer if parsing stopped early
+        tokens.cancel();
+        report.parseMs = timer.elapsedMillis();
+    });
+
+    try {
+        std::unique_ptr<Statement> stmt;
+        while (statements.pop(stmt)) {
+            execute(*stmt);
+            stmt.reset();
+        }
+    } catch (...) {
+        statements.cancel();
+        parsing.join();
+        lexing.join();
+        throw;
+    }
+    parsing.join();
+    lexing.join();
+
+    if (lexerError) std::rethrow_exception(lexerError);
+    if (parserError) std::rethrow_exception(parserError);
+    return report;
+}
+
+} // namespace cook
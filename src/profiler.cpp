@@ -0,0 +1,319 @@
+#include "profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <iomanip>
+#include <map>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/time.h>
+#endif
+
+namespace cook {
+
+// Profiler that receives SIGPROF samples
+static Profiler* activeProfiler = nullptr;
+
+#ifndef _WIN32
+static struct sigaction previousAction;
+
+static void handleProfSignal(int) {
+    if (activeProfiler) activeProfiler->recordSample();
+}
+#endif
+
+static uint64_t elapsedNanos(std::chrono::steady_clock::time_point from,
+                             std::chrono::steady_clock::time_point to) {
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(to - from).count());
+}
+
+Profiler::Profiler(Mode mode, int sampleIntervalMicros)
+    : mode(mode), intervalMicros(sampleIntervalMicros) {
+    // Recipe 0 is the top level of the program
+    recipeNames.push_back("main");
+    recipeIds["main"] = 0;
+    recipeCalls.push_back(1);
+
+    nodes.emplace_back(-1, recipeFrame(0));
+    nodes[0].count = 1;
+
+    stack[0] = recipeFrame(0);
+    depth = 1;
+}
+
+Profiler::~Profiler() {
+    if (running) stop();
+}
+
+void Profiler::start() {
+    lastTransition = std::chrono::steady_clock::now();
+    running = true;
+
+    if (mode != Mode::SAMPLE) return;
+
+#ifdef _WIN32
+    running = false;
+    throw std::runtime_error("Sampling profiler is not supported on this platform");
+#else
+    samples.reset(new uint32_t[SAMPLE_CAPACITY]);
+    sampleEnd = 0;
+    activeProfiler = this;
+
+    struct sigaction action;
+    action.sa_handler = handleProfSignal;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    sigaction(SIGPROF, &action, &previousAction);
+
+    struct itimerval timer;
+    timer.it_interval.tv_sec = intervalMicros / 1000000;
+    timer.it_interval.tv_usec = intervalMicros % 1000000;
+    timer.it_value = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, nullptr);
+#endif
+}
+
+void Profiler::stop() {
+    if (!running) return;
+    running = false;
+
+    if (mode == Mode::INSTRUMENT) {
+        chargeCurrent();
+        return;
+    }
+
+#ifndef _WIN32
+    struct itimerval timer = {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    sigaction(SIGPROF, &previousAction, nullptr);
+    activeProfiler = nullptr;
+
+    // Fold the recorded stacks into the call tree
+    uint64_t weight = static_cast<uint64_t>(intervalMicros) * 1000;
+    size_t position = 0;
+    while (position < sampleEnd) {
+        uint32_t count = samples[position++];
+        int node = 0;
+        for (uint32_t i = 1; i < count; i++) {
+            node = childNode(node, samples[position + i]);
+        }
+        nodes[node].selfNanos += weight;
+        position += count;
+    }
+    samples.reset();
+#endif
+}
+
+void Profiler::push(uint32_t frame) {
+    sig_atomic_t current = depth;
+    if (current < MAX_DEPTH) {
+        stack[current] = frame;
+    }
+    std::atomic_signal_fence(std::memory_order_release);
+    depth = current + 1;
+}
+
+void Profiler::chargeCurrent() {
+    auto now = std::chrono::steady_clock::now();
+    nodes[currentNode].selfNanos += elapsedNanos(lastTransition, now);
+    lastTransition = now;
+}
+
+int Profiler::childNode(int parent, uint32_t frame) {
+    auto it = nodes[parent].children.find(frame);
+    if (it != nodes[parent].children.end()) {
+        return it->second;
+    }
+
+    int index = static_cast<int>(nodes.size());
+    nodes.emplace_back(parent, frame);
+    nodes[parent].children[frame] = index;
+    return index;
+}
+
+void Profiler::enterRecipe(const std::string& name) {
+    auto it = recipeIds.find(name);
+    uint32_t id;
+    if (it != recipeIds.end()) {
+        id = it->second;
+    } else {
+        id = static_cast<uint32_t>(recipeNames.size());
+        recipeNames.push_back(name);
+        recipeIds[name] = id;
+        recipeCalls.push_back(0);
+    }
+    recipeCalls[id]++;
+
+    uint32_t frame = recipeFrame(id);
+    push(frame);
+
+    if (mode == Mode::INSTRUMENT) {
+        chargeCurrent();
+        currentNode = childNode(currentNode, frame);
+        nodes[currentNode].count++;
+    }
+}
+
+void Profiler::enterStatement(int line) {
+    uint32_t frame = lineFrame(line);
+    push(frame);
+
+    if (mode == Mode::INSTRUMENT) {
+        chargeCurrent();
+        currentNode = childNode(currentNode, frame);
+        nodes[currentNode].count++;
+    }
+}
+
+void Profiler::exit() {
+    if (depth > 1) {
+        depth = depth - 1;
+    }
+
+    if (mode == Mode::INSTRUMENT && currentNode != 0) {
+        chargeCurrent();
+        currentNode = nodes[currentNode].parent;
+    }
+}
+
+void Profiler::recordSample() {
+    sig_atomic_t current = depth;
+    std::atomic_signal_fence(std::memory_order_acquire);
+    uint32_t count = static_cast<uint32_t>(current < MAX_DEPTH ? current : MAX_DEPTH);
+
+    if (sampleEnd + count + 1 > SAMPLE_CAPACITY) {
+        droppedSamples = droppedSamples + 1;
+        return;
+    }
+
+    size_t position = sampleEnd;
+    samples[position++] = count;
+    for (uint32_t i = 0; i < count; i++) {
+        samples[position++] = stack[i];
+    }
+    sampleEnd = position;
+}
+
+uint32_t Profiler::ownerRecipe(int node) const {
+    while (isLineFrame(nodes[node].frame)) {
+        node = nodes[node].parent;
+    }
+    return nodes[node].frame >> 1;
+}
+
+std::string Profiler::frameLabel(int node) const {
+    uint32_t frame = nodes[node].frame;
+    if (!isLineFrame(frame)) {
+        return recipeNames[frame >> 1];
+    }
+    return recipeNames[ownerRecipe(nodes[node].parent)] + ":" + std::to_string(frame >> 1);
+}
+
+void Profiler::writeFolded(std::ostream& out) const {
+    for (size_t i = 0; i < nodes.size(); i++) {
+        uint64_t micros = nodes[i].selfNanos / 1000;
+        if (micros == 0) continue;
+
+        std::vector<std::string> path;
+        for (int node = static_cast<int>(i); node >= 0; node = nodes[node].parent) {
+            path.push_back(frameLabel(node));
+        }
+
+        for (size_t j = path.size(); j > 0; j--) {
+            out << path[j - 1] << (j > 1 ? ";" : " ");
+        }
+        out << micros << "\n";
+    }
+}
+
+void Profiler::writeSummary(std::ostream& out) const {
+    // Children are always created after their parents, so a reverse scan
+    // accumulates subtree totals
+    std::vector<uint64_t> totals(nodes.size());
+    for (size_t i = nodes.size(); i > 0; i--) {
+        totals[i - 1] += nodes[i - 1].selfNanos;
+        if (nodes[i - 1].parent >= 0) {
+            totals[nodes[i - 1].parent] += totals[i - 1];
+        }
+    }
+
+    struct Entry {
+        uint64_t count = 0;
+        uint64_t inclusive = 0;
+        uint64_t exclusive = 0;
+    };
+    std::vector<Entry> recipeEntries(recipeNames.size());
+    std::map<std::pair<uint32_t, int>, Entry> lineEntries;
+
+    for (size_t i = 0; i < nodes.size(); i++) {
+        uint32_t frame = nodes[i].frame;
+
+        // Recursive frames only count toward inclusive time once
+        bool outermost = true;
+        for (int node = nodes[i].parent; node >= 0; node = nodes[node].parent) {
+            if (nodes[node].frame == frame &&
+                (!isLineFrame(frame) || ownerRecipe(node) == ownerRecipe(static_cast<int>(i)))) {
+                outermost = false;
+                break;
+            }
+        }
+
+        uint32_t owner = ownerRecipe(static_cast<int>(i));
+        recipeEntries[owner].exclusive += nodes[i].selfNanos;
+
+        if (isLineFrame(frame)) {
+            Entry& entry = lineEntries[std::make_pair(owner, static_cast<int>(frame >> 1))];
+            entry.count += nodes[i].count;
+            entry.exclusive += nodes[i].selfNanos;
+            if (outermost) entry.inclusive += totals[i];
+        } else if (outermost) {
+            recipeEntries[frame >> 1].inclusive += totals[i];
+        }
+    }
+
+    bool counted = mode == Mode::INSTRUMENT;
+    auto millis = [](uint64_t nanos) { return static_cast<double>(nanos) / 1e6; };
+
+    out << "Profile (" << (counted ? "instrumented" : "sampled") << ")\n";
+    out << std::left << std::setw(28) << "recipe" << std::right
+        << std::setw(10) << "calls" << std::setw(16) << "inclusive ms"
+        << std::setw(16) << "exclusive ms" << "\n";
+    out << std::fixed << std::setprecision(3);
+    for (size_t id = 0; id < recipeNames.size(); id++) {
+        out << std::left << std::setw(28) << recipeNames[id] << std::right
+            << std::setw(10) << recipeCalls[id]
+            << std::setw(16) << millis(recipeEntries[id].inclusive)
+            << std::setw(16) << millis(recipeEntries[id].exclusive) << "\n";
+    }
+
+    // Hottest statements by exclusive time
+    std::vector<std::pair<std::pair<uint32_t, int>, Entry>> hot(lineEntries.begin(), lineEntries.end());
+    std::sort(hot.begin(), hot.end(), [](const std::pair<std::pair<uint32_t, int>, Entry>& a,
+                                         const std::pair<std::pair<uint32_t, int>, Entry>& b) {
+        return a.second.exclusive > b.second.exclusive;
+    });
+    if (hot.size() > 10) hot.resize(10);
+
+    out << "\n" << std::left << std::setw(28) << "statement" << std::right
+        << std::setw(10) << "count" << std::setw(16) << "inclusive ms"
+        << std::setw(16) << "self ms" << "\n";
+    for (const auto& item : hot) {
+        std::string label = recipeNames[item.first.first] + ":" + std::to_string(item.first.second);
+        out << std::left << std::setw(28) << label << std::right << std::setw(10);
+        if (counted) {
+            out << item.second.count;
+        } else {
+            out << "-";
+        }
+        out << std::setw(16) << millis(item.second.inclusive)
+            << std::setw(16) << millis(item.second.exclusive) << "\n";
+    }
+
+    if (droppedSamples > 0) {
+        out << "\n" << droppedSamples << " samples dropped (buffer full)\n";
+    }
+    out << std::defaultfloat;
+}
+
+} // namespace cook
@@ -0,0 +1,440 @@
+#include "records.h"
+#include "json.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+namespace cook {
+
+namespace {
+
+// Pages behind the reader are released after this many bytes
+const size_t RELEASE_INTERVAL = 4 << 20;
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+bool isNumberChar(char c) {
+    return isDigit(c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+bool endsWith(const std::string& text, const char* suffix) {
+    size_t length = std::strlen(suffix);
+    return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+}
+
+// Parse [-]digits[.digits], plus an exponent if 'exponents' is set. Whole
+// numbers that fit in 64 bits become integers, others doubles; false if
+// 'data' is not a number.
+bool parseNumber(const char* data, size_t size, bool exponents, Value& value) {
+    size_t i = 0;
+    bool negative = size > 0 && data[0] == '-';
+    if (negative) i++;
+
+    size_t digits = i;
+    while (i < size && isDigit(data[i])) i++;
+    if (i == digits) return false;
+    size_t integerEnd = i;
+
+    if (i < size && data[i] == '.') {
+        size_t fraction = ++i;
+        while (i < size && isDigit(data[i])) i++;
+        if (i == fraction) return false;
+    }
+    if (exponents && i < size && (data[i] == 'e' || data[i] == 'E')) {
+        i++;
+        if (i < size && (data[i] == '+' || data[i] == '-')) i++;
+        size_t exponent = i;
+        while (i < size && isDigit(data[i])) i++;
+        if (i == exponent) return false;
+    }
+    if (i != size) return false;
+
+    if (integerEnd == size) {
+        uint64_t limit = negative ? 9223372036854775808ULL : 9223372036854775807ULL;
+        uint64_t magnitude = 0;
+        bool fits = true;
+        for (size_t j = digits; j < size && fits; j++) {
+            uint64_t digit = static_cast<uint64_t>(data[j] - '0');
+            fits = magnitude <= (limit - digit) / 10;
+            magnitude = magnitude * 10 + digit;
+        }
+        if (fits) {
+            value = Value::integer(negative ? -static_cast<int64_t>(magnitude - 1) - 1
+                                            : static_cast<int64_t>(magnitude));
+            return true;
+        }
+    }
+
+    // strtod needs a terminated string, and the field is followed by the
+    // rest of the file
+    char buffer[64];
+    if (size < sizeof(buffer)) {
+        std::memcpy(buffer, data, size);
+        buffer[size] = '\0';
+        value = Value(std::strtod(buffer, nullptr));
+    } else {
+        value = Value(std::strtod(std::string(data, size).c_str(), nullptr));
+    }
+    return true;
+}
+
+} // namespace
+
+bool RecordReader::formatOf(const std::string& path, Format& format) {
+    if (endsWith(path, ".csv")) {
+        format = Format::CSV;
+    } else if (endsWith(path, ".jsonl") || endsWith(path, ".ndjson")) {
+        format = Format::JSONL;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+RecordReader::RecordReader(const std::string& path, Format format, std::vector<std::string> fields)
+    : path(path), format(format), fields(std::move(fields)) {
+    scratch.resize(this->fields.size());
+    filled.resize(this->fields.size());
+
+    if (!file.open(path)) {
+        throw std::runtime_error("Could not open file: " + path);
+    }
+    file.adviseSequential();
+
+    // Skip a UTF-8 byte order mark
+    if (file.size() >= 3 && std::memcmp(file.data(), "\xEF\xBB\xBF", 3) == 0) position = 3;
+
+    if (format == Format::CSV) readCsvHeader();
+}
+
+bool RecordReader::next(std::vector<Value>& values) {
+    // Pages before this row are no longer needed; the row's values borrow
+    // from the pages after it
+    if (position - released >= RELEASE_INTERVAL) releaseBefore(position);
+
+    values.resize(fields.size());
+    return format == Format::CSV ? nextCsv(values) : nextJson(values);
+}
+
+void RecordReader::readCsvHeader() {
+    const char* text = file.data();
+    size_t end = file.size();
+    if (position >= end) {
+        fail(1, "expected a header row naming the columns");
+    }
+
+    rowLine = currentLine;
+    std::vector<std::string> names;
+    std::string unescaped;
+    while (true) {
+        const char* data;
+        size_t size;
+        bool quoted;
+        readCsvField(data, size, quoted, &unescaped);
+        names.emplace_back(data, size);
+        if (position < end && text[position] == ',') {
+            position++;
+            continue;
+        }
+        break;
+    }
+    if (position < end) {
+        position++;
+        currentLine++;
+    }
+
+    columnSlots.assign(names.size(), -1);
+    for (size_t slot = 0; slot < fields.size(); slot++) {
+        auto column = std::find(names.begin(), names.end(), fields[slot]);
+        if (column == names.end()) {
+            throw std::runtime_error("'" + path + "' has no column named '" + fields[slot] + "'");
+        }
+        columnSlots[column - names.begin()] = static_cast<int>(slot);
+    }
+}
+
+bool RecordReader::nextCsv(std::vector<Value>& values) {
+    const char* text = file.data();
+    size_t end = file.size();
+
+    // Skip blank lines
+    while (position < end && (text[position] == '\n' ||
+                              (text[position] == '\r' && position + 1 < end && text[position + 1] == '\n'))) {
+        if (text[position] == '\n') currentLine++;
+        position++;
+    }
+    if (position >= end) return false;
+
+    rowLine = currentLine;
+    size_t column = 0;
+    while (true) {
+        int slot = column < columnSlots.size() ? columnSlots[column] : -1;
+        const char* data;
+        size_t size;
+        bool quoted;
+        readCsvField(data, size, quoted, slot >= 0 ? &scratch[slot] : nullptr);
+
+        // Quoted fields are always strings, so "007" keeps its zeros
+        if (slot >= 0 && (quoted || !parseNumber(data, size, false, values[slot]))) {
+            values[slot] = Value::borrowed(data, size);
+        }
+
+        column++;
+        if (position < end && text[position] == ',') {
+            position++;
+            continue;
+        }
+        break;
+    }
+
+    if (column != columnSlots.size()) {
+        fail(rowLine, "expected " + std::to_string(columnSlots.size()) + " fields but found " +
+                      std::to_string(column));
+    }
+    if (position < end) {
+        position++;
+        currentLine++;
+    }
+    return true;
+}
+
+void RecordReader::readCsvField(const char*& data, size_t& size, bool& quoted, std::string* unescaped) {
+    const char* text = file.data();
+    size_t end = file.size();
+
+    quoted = position < end && text[position] == '"';
+    if (!quoted) {
+        size_t start = position;
+        while (position < end && text[position] != ',' && text[position] != '\n') position++;
+        data = text + start;
+        size = position - start;
+        // Leave out the carriage return of a CRLF line ending
+        if (size > 0 && data[size - 1] == '\r' && position < end && text[position] == '\n') size--;
+        return;
+    }
+
+    size_t start = ++position;
+    bool doubledQuotes = false;
+    while (true) {
+        if (position >= end) fail(rowLine, "unterminated quoted field");
+        char c = text[position];
+        if (c == '"') {
+            if (position + 1 < end && text[position + 1] == '"') {
+                doubledQuotes = true;
+                position += 2;
+                continue;
+            }
+            break;
+        }
+        if (c == '\n') currentLine++;
+        position++;
+    }
+    data = text + start;
+    size = position - start;
+
+    // Step over the closing quote and the carriage return of a CRLF ending
+    position++;
+    if (position + 1 < end && text[position] == '\r' && text[position + 1] == '\n') position++;
+    if (position < end && text[position] != ',' && text[position] != '\n') {
+        fail(currentLine, "unexpected character after a quoted field");
+    }
+
+    if (doubledQuotes && unescaped) {
+        unescaped->clear();
+        for (size_t i = 0; i < size; i++) {
+            unescaped->push_back(data[i]);
+            if (data[i] == '"') i++;
+        }
+        data = unescaped->data();
+        size = unescaped->size();
+    }
+}
+
+bool RecordReader::nextJson(std::vector<Value>& values) {
+    const char* text = file.data();
+    size_t end = file.size();
+
+    // Skip blank lines
+    while (position < end && (text[position] == ' ' || text[position] == '\t' || text[position] == '\r' ||
+                              text[position] == '\n')) {
+        if (text[position] == '\n') currentLine++;
+        position++;
+    }
+    if (position >= end) return false;
+
+    rowLine = currentLine;
+    std::fill(filled.begin(), filled.end(), 0);
+
+    expectJson('{', "'{' at the start of a row");
+    skipJsonSpaces();
+    if (position < end && text[position] == '}') {
+        position++;
+    } else {
+        while (true) {
+            skipJsonSpaces();
+            if (position >= end || text[position] != '"') fail(rowLine, "expected a member name");
+            const char* name;
+            size_t nameSize;
+            readJsonString(name, nameSize, &nameBuffer);
+            int slot = slotOf(name, nameSize);
+
+            expectJson(':', "':' after a member name");
+            skipJsonSpaces();
+            readJsonValue(slot, values);
+
+            skipJsonSpaces();
+            if (position < end && text[position] == ',') {
+                position++;
+                continue;
+            }
+            expectJson('}', "',' or '}' after a member");
+            break;
+        }
+    }
+
+    skipJsonSpaces();
+    if (position < end && text[position] != '\n') fail(rowLine, "expected one object per line");
+    if (position < end) {
+        position++;
+        currentLine++;
+    }
+
+    for (size_t slot = 0; slot < fields.size(); slot++) {
+        if (!filled[slot]) fail(rowLine, "row has no value for '" + fields[slot] + "'");
+    }
+    return true;
+}
+
+void RecordReader::readJsonString(const char*& data, size_t& size, std::string* decoded) {
+    const char* text = file.data();
+    size_t end = file.size();
+
+    size_t quote = position++;
+    bool escapes = false;
+    while (position < end && text[position] != '"') {
+        if (text[position] == '\n') fail(rowLine, "unterminated string");
+        if (text[position] == '\\') {
+            escapes = true;
+            position++;
+        }
+        position++;
+    }
+    if (position >= end) fail(rowLine, "unterminated string");
+    position++;
+
+    data = text + quote + 1;
+    size = position - quote - 2;
+    if (!escapes || !decoded) return;
+
+    // Strings with escapes are rare enough to hand to the full JSON parser
+    try {
+        *decoded = Json::parse(std::string(text + quote, position - quote)).asString();
+    } catch (const std::exception&) {
+        fail(rowLine, "malformed escape in a string");
+    }
+    data = decoded->data();
+    size = decoded->size();
+}
+
+void RecordReader::readJsonValue(int slot, std::vector<Value>& values) {
+    const char* text = file.data();
+    size_t end = file.size();
+    if (position >= end) fail(rowLine, "expected a value");
+
+    auto matchWord = [&](const char* word) {
+        size_t length = std::strlen(word);
+        if (end - position < length || std::memcmp(text + position, word, length) != 0) return false;
+        position += length;
+        return true;
+    };
+
+    Value value;
+    char c = text[position];
+    if (c == '"') {
+        const char* data;
+        size_t size;
+        readJsonString(data, size, slot >= 0 ? &scratch[slot] : nullptr);
+        value = Value::borrowed(data, size);
+    } else if (c == '-' || isDigit(c)) {
+        size_t start = position;
+        while (position < end && isNumberChar(text[position])) position++;
+        if (!parseNumber(text + start, position - start, true, value)) fail(rowLine, "malformed number");
+    } else if (matchWord("true")) {
+        value = Value::integer(1);
+    } else if (matchWord("false")) {
+        value = Value::integer(0);
+    } else if (matchWord("null")) {
+        // Reads as a missing member
+        return;
+    } else if (c == '{' || c == '[') {
+        if (slot >= 0) fail(rowLine, "'" + fields[slot] + "' must be a string, number or boolean");
+        skipJsonNested();
+        return;
+    } else {
+        fail(rowLine, "expected a value");
+    }
+
+    if (slot >= 0) {
+        values[slot] = std::move(value);
+        filled[slot] = 1;
+    }
+}
+
+// Step over an object or array in a member that is not extracted
+void RecordReader::skipJsonNested() {
+    const char* text = file.data();
+    size_t end = file.size();
+    int depth = 0;
+    do {
+        if (position >= end || text[position] == '\n') fail(rowLine, "unterminated object or array");
+        char c = text[position];
+        if (c == '"') {
+            const char* data;
+            size_t size;
+            readJsonString(data, size, nullptr);
+            continue;
+        }
+        if (c == '{' || c == '[') depth++;
+        if (c == '}' || c == ']') depth--;
+        position++;
+    } while (depth > 0);
+}
+
+void RecordReader::skipJsonSpaces() {
+    const char* text = file.data();
+    size_t end = file.size();
+    while (position < end && (text[position] == ' ' || text[position] == '\t' || text[position] == '\r')) {
+        position++;
+    }
+}
+
+void RecordReader::expectJson(char c, const char* what) {
+    skipJsonSpaces();
+    if (position >= file.size() || file.data()[position] != c) {
+        fail(rowLine, std::string("expected ") + what);
+    }
+    position++;
+}
+
+int RecordReader::slotOf(const char* name, size_t size) const {
+    for (size_t slot = 0; slot < fields.size(); slot++) {
+        if (fields[slot].size() == size && std::memcmp(fields[slot].data(), name, size) == 0) {
+            return static_cast<int>(slot);
+        }
+    }
+    return -1;
+}
+
+void RecordReader::releaseBefore(size_t offset) {
+    file.release(offset);
+    released = offset;
+}
+
+void RecordReader::fail(size_t line, const std::string& message) const {
+    throw std::runtime_error(path + ":" + std::to_string(line) + ": " + message);
+}
+
+} // namespace cook
@@ -0,0 +1,67 @@
+#include "region.h"
+#include <cstddef>
+#include <cstring>
+
+namespace cook {
+
+Region::Region(size_t blockSize) : blockSize(blockSize) {}
+
+char* Region::allocate(size_t size) {
+    // Move forward through the retained blocks until one has room
+    while (current < blocks.size() && offset + size > blocks[current].size) {
+        current++;
+        offset = 0;
+    }
+
+    if (current == blocks.size()) {
+        size_t bytes = size > blockSize ? size : blockSize;
+        blocks.push_back(Block{std::unique_ptr<char[]>(new char[bytes]), bytes});
+        offset = 0;
+    }
+
+    char* memory = blocks[current].data.get() + offset;
+    offset += size;
+    return memory;
+}
+
+const char* Region::copy(const char* data, size_t size) {
+    if (size == 0) return "";
+
+    char* memory = allocate(size);
+    std::memcpy(memory, data, size);
+    return memory;
+}
+
+void Region::release(const Mark& mark) {
+    current = mark.block;
+    offset = mark.offset;
+
+    // Blocks made for a single oversized string are freed once nothing in
+    // them is live, so one huge value does not stay allocated for good
+    size_t first = offset == 0 ? current : current + 1;
+    for (size_t i = first; i < blocks.size();) {
+        if (blocks[i].size > blockSize) {
+            blocks.erase(blocks.begin() + static_cast<std::ptrdiff_t>(i));
+        } else {
+            i++;
+        }
+    }
+}
+
+size_t Region::capacity() const {
+    size_t total = 0;
+    for (const auto& block : blocks) {
+        total += block.size;
+    }
+    return total;
+}
+
+size_t Region::used() const {
+    size_t total = offset;
+    for (size_t i = 0; i < current && i < blocks.size(); i++) {
+        total += blocks[i].size;
+    }
+    return total;
+}
+
+} // namespace cook
@@ -0,0 +1,267 @@
+#include "serializer.h"
+#include <stdexcept>
+
+namespace cook {
+
+// Node tags used in the binary format
+enum NodeTag : uint8_t {
+    TAG_NULL = 0,
+
+    // Expressions
+    TAG_LITERAL = 1,
+    TAG_VARIABLE = 2,
+    TAG_BINARY = 3,
+    TAG_ASSIGN = 4,
+    TAG_CALL = 5,
+    TAG_UNARY = 6,
+
+    // Statements
+    TAG_EXPRESSION_STMT = 16,
+    TAG_INGREDIENT_STMT = 17,
+    TAG_RECIPE_STMT = 18,
+    TAG_TASTE_STMT = 19,
+    TAG_COOKBOOK_STMT = 20
+};
+
+// AstWriter implementation
+void AstWriter::writeU8(uint8_t value) {
+    buffer.push_back(static_cast<char>(value));
+}
+
+void AstWriter::writeU32(uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        buffer.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+    }
+}
+
+void AstWriter::writeU64(uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        buffer.push_back(static_cast<char>((value >> (i * 8)) & 0xFF));
+    }
+}
+
+void AstWriter::writeString(const std::string& value) {
+    writeU32(static_cast<uint32_t>(value.size()));
+    buffer.append(value);
+}
+
+void AstWriter::writeLocation(const ASTNode* node) {
+    writeU32(static_cast<uint32_t>(node->line));
+    writeU32(static_cast<uint32_t>(node->column));
+}
+
+void AstWriter::writeExpression(const Expression* expr) {
+    if (!expr) {
+        writeU8(TAG_NULL);
+    } else if (auto literalExpr = dynamic_cast<const LiteralExpr*>(expr)) {
+        writeU8(TAG_LITERAL);
+        writeU8(static_cast<uint8_t>(literalExpr->type));
+        writeString(literalExpr->value);
+    } else if (auto variableExpr = dynamic_cast<const VariableExpr*>(expr)) {
+        writeU8(TAG_VARIABLE);
+        writeString(variableExpr->name);
+    } else if (auto unaryExpr = dynamic_cast<const UnaryExpr*>(expr)) {
+        writeU8(TAG_UNARY);
+        writeU8(static_cast<uint8_t>(unaryExpr->op));
+        writeExpression(unaryExpr->operand.get());
+    } else if (auto binaryExpr = dynamic_cast<const BinaryExpr*>(expr)) {
+        writeU8(TAG_BINARY);
+        writeU8(static_cast<uint8_t>(binaryExpr->op));
+        writeExpression(binaryExpr->left.get());
+        writeExpression(binaryExpr->right.get());
+    } else if (auto assignExpr = dynamic_cast<const AssignExpr*>(expr)) {
+        writeU8(TAG_ASSIGN);
+        writeString(assignExpr->name);
+        writeExpression(assignExpr->value.get());
+    } else if (auto callExpr = dynamic_cast<const CallExpr*>(expr)) {
+        writeU8(TAG_CALL);
+        writeString(callExpr->callee);
+        writeU32(static_cast<uint32_t>(callExpr->arguments.size()));
+        for (const auto& arg : callExpr->arguments) {
+            writeExpression(arg.get());
+        }
+    } else {
+        throw std::runtime_error("Cannot serialize unknown expression type");
+    }
+
+    if (expr) writeLocation(expr);
+}
+
+void AstWriter::writeStatement(const Statement* stmt) {
+    if (!stmt) {
+        writeU8(TAG_NULL);
+    } else if (auto exprStmt = dynamic_cast<const ExpressionStmt*>(stmt)) {
+        writeU8(TAG_EXPRESSION_STMT);
+        writeExpression(exprStmt->expression.get());
+    } else if (auto ingredientStmt = dynamic_cast<const IngredientStmt*>(stmt)) {
+        writeU8(TAG_INGREDIENT_STMT);
+        writeString(ingredientStmt->name);
+        writeExpression(ingredientStmt->initializer.get());
+    } else if (auto recipeStmt = dynamic_cast<const RecipeStmt*>(stmt)) {
+        writeU8(TAG_RECIPE_STMT);
+        writeString(recipeStmt->name);
+        writeU32(static_cast<uint32_t>(recipeStmt->parameters.size()));
+        for (const auto& param : recipeStmt->parameters) {
+            writeString(param);
+        }
+        writeU32(static_cast<uint32_t>(recipeStmt->body.size()));
+        for (const auto& bodyStmt : recipeStmt->body) {
+            writeStatement(bodyStmt.get());
+        }
+    } else if (auto tasteStmt = dynamic_cast<const TasteStmt*>(stmt)) {
+        writeU8(TAG_TASTE_STMT);
+        writeExpression(tasteStmt->expression.get());
+    } else if (auto cookbookStmt = dynamic_cast<const CookbookStmt*>(stmt)) {
+        writeU8(TAG_COOKBOOK_STMT);
+        writeString(cookbookStmt->path);
+    } else {
+        throw std::runtime_error("Cannot serialize unknown statement type");
+    }
+
+    if (stmt) writeLocation(stmt);
+}
+
+// AstReader implementation
+AstReader::AstReader(const char* data, size_t size) : bytes(data), length(size) {}
+
+void AstReader::require(size_t count) {
+    if (count > length - offset || offset > length) {
+        throw std::runtime_error("Unexpected end of compiled data");
+    }
+}
+
+void AstReader::seek(size_t position) {
+    if (position > length) {
+        throw std::runtime_error("Invalid offset in compiled data");
+    }
+    offset = position;
+}
+
+uint8_t AstReader::readU8() {
+    require(1);
+    return static_cast<uint8_t>(bytes[offset++]);
+}
+
+uint32_t AstReader::readU32() {
+    require(4);
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(bytes[offset++])) << (i * 8);
+    }
+    return value;
+}
+
+uint64_t AstReader::readU64() {
+    require(8);
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(bytes[offset++])) << (i * 8);
+    }
+    return value;
+}
+
+std::string AstReader::readString() {
+    uint32_t size = readU32();
+    require(size);
+    std::string value(bytes + offset, size);
+    offset += size;
+    return value;
+}
+
+void AstReader::readLocation(ASTNode* node) {
+    int line = static_cast<int>(readU32());
+    int column = static_cast<int>(readU32());
+    node->setLocation(line, column);
+}
+
+std::unique_ptr<Expression> AstReader::readExpression() {
+    std::unique_ptr<Expression> expr = readExpressionNode();
+    if (expr) readLocation(expr.get());
+    return expr;
+}
+
+std::unique_ptr<Statement> AstReader::readStatement() {
+    std::unique_ptr<Statement> stmt = readStatementNode();
+    if (stmt) readLocation(stmt.get());
+    return stmt;
+}
+
+std::unique_ptr<Expression> AstReader::readExpressionNode() {
+    uint8_t tag = readU8();
+
+    switch (tag) {
+        case TAG_NULL:
+            return nullptr;
+        case TAG_LITERAL: {
+            auto type = static_cast<LiteralExpr::Type>(readU8());
+            std::string value = readString();
+            return std::make_unique<LiteralExpr>(type, value);
+        }
+        case TAG_VARIABLE:
+            return std::make_unique<VariableExpr>(readString());
+        case TAG_UNARY: {
+            auto op = static_cast<UnaryExpr::Operator>(readU8());
+            return std::make_unique<UnaryExpr>(op, readExpression());
+        }
+        case TAG_BINARY: {
+            auto op = static_cast<BinaryExpr::Operator>(readU8());
+            auto left = readExpression();
+            auto right = readExpression();
+            return std::make_unique<BinaryExpr>(op, std::move(left), std::move(right));
+        }
+        case TAG_ASSIGN: {
+            std::string name = readString();
+            auto value = readExpression();
+            return std::make_unique<AssignExpr>(name, std::move(value));
+        }
+        case TAG_CALL: {
+            std::string callee = readString();
+            uint32_t count = readU32();
+            std::vector<std::unique_ptr<Expression>> arguments;
+            for (uint32_t i = 0; i < count; i++) {
+                arguments.push_back(readExpression());
+            }
+            return std::make_unique<CallExpr>(callee, std::move(arguments));
+        }
+        default:
+            throw std::runtime_error("Invalid expression tag in compiled data");
+    }
+}
+
+std::unique_ptr<Statement> AstReader::readStatementNode() {
+    uint8_t tag = readU8();
+
+    switch (tag) {
+        case TAG_NULL:
+            return nullptr;
+        case TAG_EXPRESSION_STMT:
+            return std::make_unique<ExpressionStmt>(readExpression());
+        case TAG_INGREDIENT_STMT: {
+            std::string name = readString();
+            auto initializer = readExpression();
+            return std::make_unique<IngredientStmt>(name, std::move(initializer));
+        }
+        case TAG_RECIPE_STMT: {
+            std::string name = readString();
+            uint32_t paramCount = readU32();
+            std::vector<std::string> parameters;
+            for (uint32_t i = 0; i < paramCount; i++) {
+                parameters.push_back(readString());
+            }
+            uint32_t bodyCount = readU32();
+            std::vector<std::unique_ptr<Statement>> body;
+            for (uint32_t i = 0; i < bodyCount; i++) {
+                body.push_back(readStatement());
+            }
+            return std::make_unique<RecipeStmt>(name, std::move(parameters), std::move(body));
+        }
+        case TAG_TASTE_STMT:
+            return std::make_unique<TasteStmt>(readExpression());
+        case TAG_COOKBOOK_STMT:
+            return std::make_unique<CookbookStmt>(readString());
+        default:
+            throw std::runtime_error("Invalid statement tag in compiled data");
+    }
+}
+
+} // namespace cook
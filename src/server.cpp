@@ -0,0 +1,435 @@
+#include "server.h"
+#include "files.h"
+#include "lexer.h"
+#include "module.h"
+#include "stats.h"
+#include <cerrno>
+#include <cmath>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <streambuf>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace cook {
+
+namespace {
+
+// Requests longer than this close the connection
+const size_t MAX_REQUEST_BYTES = 1 << 20;
+
+// A client that reads none of its reply for this long is disconnected,
+// rather than holding a worker (and shutdown) indefinitely
+const int SEND_TIMEOUT_MS = 10000;
+
+#ifndef _WIN32
+volatile std::sig_atomic_t stopRequested = 0;
+int signalWakeFd = -1;
+
+void requestStop(int) {
+    stopRequested = 1;
+    if (signalWakeFd >= 0) {
+        char byte = 0;
+        ssize_t ignored = write(signalWakeFd, &byte, 1);
+        (void)ignored;
+    }
+}
+
+// Write all of 'data', giving up if the peer has gone away or has not made
+// room for more for SEND_TIMEOUT_MS
+bool sendAll(int fd, const std::string& data) {
+#ifdef MSG_NOSIGNAL
+    const int flags = MSG_DONTWAIT | MSG_NOSIGNAL;
+#else
+    const int flags = MSG_DONTWAIT;
+#endif
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t written = ::send(fd, data.data() + sent, data.size() - sent, flags);
+        if (written < 0 && errno == EINTR) continue;
+        if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            pollfd writable{fd, POLLOUT, 0};
+            int ready = poll(&writable, 1, SEND_TIMEOUT_MS);
+            if (ready < 0 && errno == EINTR) continue;
+            if (ready <= 0) return false;
+            continue;
+        }
+        if (written <= 0) return false;
+        sent += static_cast<size_t>(written);
+    }
+    return true;
+}
+
+// Sends what a script tastes to the client as {"output": ...} lines. Taste
+// ends every value with std::endl, so each flush is one line.
+class ReplyBuffer : public std::streambuf {
+public:
+    explicit ReplyBuffer(int fd) : fd(fd) {}
+
+    bool failed() const { return broken; }
+
+protected:
+    int_type overflow(int_type c) override {
+        if (c != traits_type::eof()) pending += static_cast<char>(c);
+        return c;
+    }
+
+    std::streamsize xsputn(const char* data, std::streamsize size) override {
+        pending.append(data, static_cast<size_t>(size));
+        return size;
+    }
+
+    int sync() override {
+        if (pending.empty()) return 0;
+        // The trailing newline is implied by the message
+        if (pending.back() == '\n') pending.pop_back();
+
+        Json message = Json::object();
+        message["output"] = pending;
+        pending.clear();
+        if (!broken && !sendAll(fd, message.dump() + "\n")) broken = true;
+        return 0;
+    }
+
+private:
+    int fd;
+    std::string pending;
+    bool broken = false;
+};
+
+Value ingredientValue(const Json& value) {
+    if (value.isNumber()) {
+        // JSON has one number type; whole numbers that a double holds
+        // exactly become integers, like integer literals in a script
+        double number = value.asNumber();
+        if (std::floor(number) == number && std::fabs(number) <= 9007199254740992.0) {
+            return Value::integer(static_cast<int64_t>(number));
+        }
+        return Value(number);
+    }
+    if (value.isString()) return Value(value.asString());
+    throw std::runtime_error("Ingredients must be numbers or strings");
+}
+#endif
+
+} // namespace
+
+Server::Server(std::string socketPath, size_t workers, const ExecutionBudget& budget)
+    : socketPath(std::move(socketPath)), workerCount(workers), budget(budget) {
+    ModuleCache::instance().setRevalidate(true);
+}
+
+Server::~Server() {
+#ifndef _WIN32
+    if (listenFd >= 0) close(listenFd);
+    if (wakeFds[0] >= 0) close(wakeFds[0]);
+    if (wakeFds[1] >= 0) close(wakeFds[1]);
+#endif
+}
+
+void Server::loadScript(Script& script) {
+    // Taken before reading, so a write racing the read shows up next time
+    fileStatus(script.path, script.size, script.modified);
+
+    std::string source;
+    if (!readWholeFile(script.path, source)) {
+        throw std::runtime_error("Could not open file: " + script.path);
+    }
+
+    Parser parser(Lexer(source).tokenize());
+    auto parsed = std::make_shared<Parsed>();
+    parsed->program = parser.parse();
+    if (parser.hadError()) {
+        for (const auto& diagnostic : parser.getDiagnostics()) {
+            std::cerr << diagnostic.format(script.path) << std::endl;
+        }
+        throw std::runtime_error("Could not load '" + script.path + "'");
+    }
+
+    for (const auto& stmt : parsed->program->statements) {
+        if (auto ingredient = dynamic_cast<const IngredientStmt*>(stmt.get())) {
+            parsed->ingredients.insert(ingredient->name);
+        }
+    }
+    script.parsed = std::move(parsed);
+}
+
+void Server::addScript(const std::string& name, const std::string& path) {
+    std::unique_ptr<Script> script(new Script);
+    script->path = path;
+    script->baseDirectory = directoryOf(path);
+    loadScript(*script);
+
+    // Load the cookbooks it imports now rather than on the first request
+    for (const auto& stmt : script->parsed->program->statements) {
+        auto cookbook = dynamic_cast<const CookbookStmt*>(stmt.get());
+        if (cookbook && !isBuiltinCookbook(cookbook->path)) {
+            ModuleCache::instance().load(resolveModulePath(script->baseDirectory, cookbook->path));
+        }
+    }
+
+    if (!scripts.emplace(name, std::move(script)).second) {
+        throw std::runtime_error("Two scripts are named '" + name + "'");
+    }
+}
+
+std::shared_ptr<const Server::Parsed> Server::currentScript(const std::string& name, std::string& baseDirectory) {
+    auto it = scripts.find(name);
+    if (it == scripts.end()) {
+        throw std::runtime_error("Unknown script '" + name + "'");
+    }
+
+    // A script that has gone away keeps its last version; one that no longer
+    // parses fails its requests until it is saved again. The path never
+    // changes, so the file is checked before taking the script's lock.
+    Script& script = *it->second;
+    uint64_t size = 0, modified = 0;
+    bool exists = fileStatus(script.path, size, modified);
+
+    std::lock_guard<std::mutex> lock(script.mutex);
+    if (exists && (size != script.size || modified != script.modified)) {
+        try {
+            loadScript(script);
+            script.error.clear();
+        } catch (const std::exception& e) {
+            script.error = e.what();
+        }
+    }
+    if (!script.error.empty()) {
+        throw std::runtime_error(script.error);
+    }
+
+    baseDirectory = script.baseDirectory;
+    return script.parsed;
+}
+
+#ifdef _WIN32
+
+int Server::run() {
+    std::cerr << "cook serve needs Unix domain sockets, which this build does not support" << std::endl;
+    return 1;
+}
+
+#else
+
+bool Server::listen() {
+    sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path is too long: " << socketPath << std::endl;
+        return false;
+    }
+    std::strcpy(address.sun_path, socketPath.c_str());
+
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        std::cerr << "Could not create socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    // A socket file left behind by a previous server would make bind fail
+    unlink(socketPath.c_str());
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        ::listen(listenFd, 128) < 0) {
+        std::cerr << "Could not listen on " << socketPath << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    if (pipe(wakeFds) < 0) {
+        std::cerr << "Could not create pipe: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    fcntl(wakeFds[0], F_SETFL, O_NONBLOCK);
+    fcntl(wakeFds[1], F_SETFL, O_NONBLOCK);
+    return true;
+}
+
+int Server::run() {
+    if (!listen()) return 1;
+
+    stopRequested = 0;
+    signalWakeFd = wakeFds[1];
+    std::signal(SIGINT, requestStop);
+    std::signal(SIGTERM, requestStop);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    ThreadPool pool(workerCount);
+    std::cerr << "Serving " << scripts.size() << (scripts.size() == 1 ? " script" : " scripts")
+              << " on " << socketPath << " with " << pool.size()
+              << (pool.size() == 1 ? " worker" : " workers") << std::endl;
+
+    // Connections waiting for input; the rest are with a worker
+    std::vector<std::unique_ptr<Connection>> connections;
+    std::vector<Connection*> idle;
+    std::vector<pollfd> polled;
+
+    auto closeConnection = [&](Connection* connection) {
+        close(connection->fd);
+        for (auto it = connections.begin(); it != connections.end(); ++it) {
+            if (it->get() == connection) {
+                connections.erase(it);
+                break;
+            }
+        }
+    };
+
+    while (!stopRequested) {
+        polled.clear();
+        polled.push_back(pollfd{listenFd, POLLIN, 0});
+        polled.push_back(pollfd{wakeFds[0], POLLIN, 0});
+        for (Connection* connection : idle) {
+            polled.push_back(pollfd{connection->fd, POLLIN, 0});
+        }
+
+        if (poll(polled.data(), polled.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "poll failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+
+        // Read from connections that have input; hand over those holding a
+        // complete request
+        std::vector<Connection*> stillIdle;
+        for (size_t i = 2; i < polled.size(); i++) {
+            Connection* connection = idle[i - 2];
+            if (!polled[i].revents) {
+                stillIdle.push_back(connection);
+                continue;
+            }
+
+            char buffer[65536];
+            ssize_t received = recv(connection->fd, buffer, sizeof(buffer), 0);
+            if (received < 0 && errno == EINTR) {
+                stillIdle.push_back(connection);
+                continue;
+            }
+            if (received <= 0 || connection->input.size() + received > MAX_REQUEST_BYTES) {
+                closeConnection(connection);
+                continue;
+            }
+
+            connection->input.append(buffer, static_cast<size_t>(received));
+            if (connection->input.find('\n') == std::string::npos) {
+                stillIdle.push_back(connection);
+                continue;
+            }
+            pool.submit([this, connection] { serveConnection(connection); });
+        }
+        idle.swap(stillIdle);
+
+        if (polled[1].revents) {
+            char drained[64];
+            while (read(wakeFds[0], drained, sizeof(drained)) > 0) {}
+
+            std::lock_guard<std::mutex> lock(returnedMutex);
+            for (Connection* connection : returned) {
+                if (connection->closed) {
+                    closeConnection(connection);
+                } else {
+                    idle.push_back(connection);
+                }
+            }
+            returned.clear();
+        }
+
+        if (polled[0].revents & POLLIN) {
+            int fd = accept(listenFd, nullptr, nullptr);
+            if (fd >= 0) {
+                connections.push_back(std::unique_ptr<Connection>(new Connection{fd, "", false}));
+                idle.push_back(connections.back().get());
+            }
+        }
+    }
+
+    // Let requests in progress finish before closing their connections
+    close(listenFd);
+    listenFd = -1;
+    unlink(socketPath.c_str());
+    pool.wait();
+    signalWakeFd = -1;
+    for (const auto& connection : connections) {
+        close(connection->fd);
+    }
+    std::cerr << "Server stopped" << std::endl;
+    return 0;
+}
+
+void Server::serveConnection(Connection* connection) {
+    size_t start = 0;
+    size_t end;
+    while (!connection->closed && (end = connection->input.find('\n', start)) != std::string::npos) {
+        std::string line = connection->input.substr(start, end - start);
+        start = end + 1;
+        if (line.empty() || line == "\r") continue;
+        handleRequest(connection, line);
+    }
+    connection->input.erase(0, start);
+    giveBack(connection);
+}
+
+void Server::handleRequest(Connection* connection, const std::string& line) {
+    Stopwatch timer;
+    ReplyBuffer buffer(connection->fd);
+    std::ostream output(&buffer);
+    Json reply = Json::object();
+
+    try {
+        Json request = Json::parse(line);
+        std::string baseDirectory;
+        const std::string& name = request["script"].asString();
+        std::shared_ptr<const Parsed> script = currentScript(name, baseDirectory);
+
+        Interpreter interpreter;
+        interpreter.setBaseDirectory(baseDirectory);
+        interpreter.setOutput(output);
+        interpreter.setBudget(budget);
+
+        const Json& ingredients = request["ingredients"];
+        if (!ingredients.isNull() && !ingredients.isObject()) {
+            throw std::runtime_error("'ingredients' must be an object");
+        }
+        for (const auto& member : ingredients.entries()) {
+            if (script->ingredients.count(member.first)) {
+                throw std::runtime_error("Script '" + name + "' declares ingredient '" + member.first +
+                                         "' itself, so a request cannot set it");
+            }
+            interpreter.define(member.first, ingredientValue(member.second));
+        }
+
+        interpreter.interpret(*script->program);
+        output.flush();
+        reply["status"] = "ok";
+        reply["ms"] = timer.elapsedMillis();
+    } catch (const std::exception& e) {
+        output.flush();
+        reply["status"] = "error";
+        reply["message"] = e.what();
+    }
+
+    if (buffer.failed() || !sendAll(connection->fd, reply.dump() + "\n")) {
+        connection->closed = true;
+    }
+}
+
+void Server::giveBack(Connection* connection) {
+    {
+        std::lock_guard<std::mutex> lock(returnedMutex);
+        returned.push_back(connection);
+    }
+    char byte = 0;
+    ssize_t ignored = write(wakeFds[1], &byte, 1);
+    (void)ignored;
+}
+
+#endif
+
+} // namespace cook
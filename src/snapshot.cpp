@@ -0,0 +1,106 @@
+#include "snapshot.h"
+#include "serializer.h"
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+
+namespace cook {
+
+// Snapshot header: magic "CKSN", format version, size and hash of the
+// script, the snapshot line and the resume offset, line and column
+static const uint32_t SNAPSHOT_MAGIC = 0x4E534B43;
+static const uint32_t SNAPSHOT_VERSION = 4;
+static const size_t HEADER_SIZE = 44;
+
+// Byte offset of a one-based line and column
+static size_t offsetOf(const std::string& source, int line, int column) {
+    size_t offset = 0;
+    for (int current = 1; current < line && offset < source.size(); offset++) {
+        if (source[offset] == '\n') current++;
+    }
+    offset += static_cast<size_t>(column - 1);
+    return offset < source.size() ? offset : source.size();
+}
+
+void Snapshot::write(const std::string& path, const Interpreter& interpreter, const std::string& source,
+                     uint32_t line, const Statement* resume) {
+    AstWriter writer;
+    writer.writeU32(SNAPSHOT_MAGIC);
+    writer.writeU32(SNAPSHOT_VERSION);
+    writer.writeU64(source.size());
+    writer.writeU64(contentHash(source));
+    writer.writeU32(line);
+    if (resume) {
+        writer.writeU64(offsetOf(source, resume->line, resume->column));
+        writer.writeU32(static_cast<uint32_t>(resume->line));
+        writer.writeU32(static_cast<uint32_t>(resume->column));
+    } else {
+        // Nothing left to run; resume at the end of the file
+        writer.writeU64(source.size());
+        writer.writeU32(0);
+        writer.writeU32(0);
+    }
+    interpreter.saveState(writer);
+
+    // Write beside the snapshot and rename, so a run restoring it never sees
+    // a partial file
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            throw std::runtime_error("Could not write snapshot '" + path + "'");
+        }
+        out.write(writer.data().data(), static_cast<std::streamsize>(writer.size()));
+        if (!out) {
+            throw std::runtime_error("Could not write snapshot '" + path + "'");
+        }
+    }
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Could not write snapshot '" + path + "'");
+    }
+}
+
+void Snapshot::open(const std::string& path, const std::string& source) {
+    this->path = path;
+    if (!file.open(path)) {
+        throw std::runtime_error("Could not open snapshot '" + path + "'");
+    }
+
+    AstReader header(file.data(), file.size());
+    if (file.size() < HEADER_SIZE || header.readU32() != SNAPSHOT_MAGIC ||
+        header.readU32() != SNAPSHOT_VERSION) {
+        throw std::runtime_error("'" + path + "' is not a snapshot from this version of cook");
+    }
+    if (header.readU64() != source.size() || header.readU64() != contentHash(source)) {
+        throw std::runtime_error("Snapshot '" + path + "' was taken from a different version of the script");
+    }
+
+    snapshotLine = header.readU32();
+    offset = header.readU64();
+    lineAt = static_cast<int>(header.readU32());
+    columnAt = static_cast<int>(header.readU32());
+    if (offset > source.size()) {
+        throw std::runtime_error("Snapshot '" + path + "' is corrupt");
+    }
+    if (offset == source.size()) {
+        lineAt = 1;
+        columnAt = 1;
+    }
+    stateOffset = header.position();
+}
+
+void Snapshot::restore(Interpreter& interpreter) const {
+    AstReader reader(file.data(), file.size());
+    reader.seek(stateOffset);
+    try {
+        interpreter.restoreState(reader);
+    } catch (const std::exception& e) {
+        throw std::runtime_error("Could not restore snapshot '" + path + "': " + e.what());
+    }
+}
+
+} // namespace cook
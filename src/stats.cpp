@@ -0,0 +1,155 @@
+#include "stats.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <mutex>
+#include <new>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+namespace cook {
+
+namespace {
+
+// Adds one thread's counters into a total
+void merge(RuntimeStats& total, const RuntimeStats& counters) {
+    total.nodesEvaluated += counters.nodesEvaluated;
+    total.environmentLookups += counters.environmentLookups;
+    total.environmentMisses += counters.environmentMisses;
+    total.stringBytesCopied += counters.stringBytesCopied;
+    total.heapAllocations += counters.heapAllocations;
+    total.recipeCalls += counters.recipeCalls;
+    total.maxCallDepth = std::max(total.maxCallDepth, counters.maxCallDepth);
+}
+
+// Live threads' counters are linked together rather than kept in a vector:
+// operator new counts allocations, so registering must not allocate.
+std::mutex registryMutex;
+struct ThreadStats;
+ThreadStats* liveThreads = nullptr;
+RuntimeStats exitedThreads;
+
+struct ThreadStats {
+    RuntimeStats counters;
+    ThreadStats* previous = nullptr;
+    ThreadStats* next = nullptr;
+
+    ThreadStats() {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        next = liveThreads;
+        if (next) next->previous = this;
+        liveThreads = this;
+    }
+
+    ~ThreadStats() {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        merge(exitedThreads, counters);
+        if (previous) previous->next = next;
+        else liveThreads = next;
+        if (next) next->previous = previous;
+    }
+};
+
+} // namespace
+
+RuntimeStats& runtimeStats() {
+    static thread_local ThreadStats stats;
+    return stats.counters;
+}
+
+RuntimeStats totalRuntimeStats() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    RuntimeStats total = exitedThreads;
+    for (ThreadStats* thread = liveThreads; thread; thread = thread->next) {
+        merge(total, thread->counters);
+    }
+    return total;
+}
+
+uint64_t peakResidentKilobytes() {
+#ifdef _WIN32
+    return 0;
+#else
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#ifdef __APPLE__
+    return static_cast<uint64_t>(usage.ru_maxrss) / 1024;
+#else
+    return static_cast<uint64_t>(usage.ru_maxrss);
+#endif
+#endif
+}
+
+void writeStatsJson(std::ostream& out, const PhaseTimings& timings) {
+    double total = timings.readMs + timings.lexMs + timings.parseMs + timings.executeMs;
+
+    out << std::fixed << std::setprecision(3);
+    out << "{\n";
+    out << "  \"phases\": {\n";
+    out << "    \"read_ms\": " << timings.readMs << ",\n";
+    out << "    \"lex_ms\": " << timings.lexMs << ",\n";
+    out << "    \"parse_ms\": " << timings.parseMs << ",\n";
+    out << "    \"execute_ms\": " << timings.executeMs << ",\n";
+    out << "    \"total_ms\": " << total << "\n";
+    out << "  },\n";
+#ifdef COOK_STATS
+    const RuntimeStats counters = totalRuntimeStats();
+    out << "  \"counters\": {\n";
+    out << "    \"nodes_evaluated\": " << counters.nodesEvaluated << ",\n";
+    out << "    \"environment_lookups\": " << counters.environmentLookups << ",\n";
+    out << "    \"environment_misses\": " << counters.environmentMisses << ",\n";
+    out << "    \"string_bytes_copied\": " << counters.stringBytesCopied << ",\n";
+    out << "    \"heap_allocations\": " << counters.heapAllocations << ",\n";
+    out << "    \"recipe_calls\": " << counters.recipeCalls << ",\n";
+    out << "    \"max_call_depth\": " << counters.maxCallDepth << "\n";
+    out << "  },\n";
+#else
+    out << "  \"counters\": null,\n";
+#endif
+    out << "  \"peak_rss_kb\": " << peakResidentKilobytes() << "\n";
+    out << "}\n";
+    out << std::defaultfloat;
+}
+
+void writeStatsText(std::ostream& out, const PhaseTimings& timings) {
+    out << std::fixed << std::setprecision(3);
+    out << "read:     " << timings.readMs << " ms\n";
+    out << "lex:      " << timings.lexMs << " ms\n";
+    out << "parse:    " << timings.parseMs << " ms\n";
+    out << "execute:  " << timings.executeMs << " ms\n";
+#ifdef COOK_STATS
+    const RuntimeStats counters = totalRuntimeStats();
+    out << "nodes evaluated:      " << counters.nodesEvaluated << "\n";
+    out << "environment lookups:  " << counters.environmentLookups
+        << " (" << counters.environmentMisses << " misses)\n";
+    out << "string bytes copied:  " << counters.stringBytesCopied << "\n";
+    out << "heap allocations:     " << counters.heapAllocations << "\n";
+    out << "recipe calls:         " << counters.recipeCalls << "\n";
+    out << "max call depth:       " << counters.maxCallDepth << "\n";
+#else
+    out << "counters:             not compiled in (COOK_ENABLE_STATS=OFF)\n";
+#endif
+    out << "peak RSS:             " << peakResidentKilobytes() << " KB\n";
+    out << std::defaultfloat;
+}
+
+} // namespace cook
+
+#ifdef COOK_STATS
+// Count every heap allocation made through operator new
+void* operator new(std::size_t size) {
+    COOK_STAT_ADD(heapAllocations, 1);
+    if (void* memory = std::malloc(size ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+#endif
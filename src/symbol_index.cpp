@@ -0,0 +1,487 @@
+#include "symbol_index.h"
+#include "lexer.h"
+#include "parser.h"
+#include "serializer.h"
+#include "symbols.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace cook {
+
+// Index header: magic "CIDX" followed by the format version
+static const uint32_t INDEX_MAGIC = 0x58444943;
+static const uint32_t INDEX_VERSION = 1;
+
+// Fixed record sizes, so records can be addressed directly in the mapping
+static const uint64_t HEADER_SIZE = 64;
+static const uint64_t FILE_RECORD_SIZE = 40;
+static const uint64_t NAME_RECORD_SIZE = 16;
+static const uint64_t ENTRY_RECORD_SIZE = 24;
+static const uint32_t NO_SCOPE = 0xFFFFFFFF;
+
+namespace {
+
+// A file's entries before names are numbered
+struct FileEntry {
+    std::string name;
+    std::string scope;
+    IndexEntry::Kind kind;
+    uint32_t line;
+    uint32_t column;
+};
+
+// An entry with its names replaced by ids from a NameTable
+struct RawEntry {
+    uint32_t name;
+    uint32_t scope;
+    uint32_t line;
+    uint32_t column;
+    IndexEntry::Kind kind;
+};
+
+struct FileRecord {
+    std::string path;
+    std::string fullPath;
+    uint64_t size = 0;
+    uint64_t modified = 0;
+    uint64_t hash = 0;
+    std::vector<FileEntry> entries; // from parsing
+    std::vector<RawEntry> raw;      // what gets written
+    bool reused = false;
+    bool parsed = false;
+    bool unreadable = false;
+    size_t syntaxErrors = 0;
+    int previous = -1; // record in the previous index
+};
+
+void parseFile(FileRecord& record, const std::string& source) {
+    std::vector<Token> tokens = Lexer(source).tokenize();
+    Parser parser(tokens);
+    std::unique_ptr<Program> program = parser.parse();
+    record.syntaxErrors = parser.getDiagnostics().size();
+
+    SymbolCollector collector(tokens);
+    for (const auto& stmt : program->statements) {
+        collector.collect(stmt.get());
+    }
+
+    auto add = [&record](const Symbol& symbol) {
+        if (symbol.kind == Symbol::Kind::PARAMETER) return;
+        IndexEntry::Kind kind = symbol.kind == Symbol::Kind::RECIPE ? IndexEntry::Kind::RECIPE
+                                                                    : IndexEntry::Kind::INGREDIENT;
+        record.entries.push_back(FileEntry{symbol.name, symbol.scope, kind,
+                                           static_cast<uint32_t>(symbol.line),
+                                           static_cast<uint32_t>(symbol.column)});
+    };
+    for (const auto& symbol : collector.globals) add(symbol);
+    for (const auto& symbol : collector.locals) add(symbol);
+    for (const auto& reference : collector.references) {
+        record.entries.push_back(FileEntry{reference.name, reference.scope,
+                                           reference.call ? IndexEntry::Kind::CALL : IndexEntry::Kind::VARIABLE,
+                                           static_cast<uint32_t>(reference.line),
+                                           static_cast<uint32_t>(reference.column)});
+    }
+
+    std::sort(record.entries.begin(), record.entries.end(), [](const FileEntry& a, const FileEntry& b) {
+        return a.line < b.line || (a.line == b.line && a.column < b.column);
+    });
+    record.parsed = true;
+}
+
+// Re-read a file whose size or mtime changed; its entries are kept if the
+// content hash shows that nothing actually changed
+void refreshFile(FileRecord& record, uint64_t previousHash) {
+    std::string source;
+    if (!readWholeFile(record.fullPath, source)) {
+        // Keep what the previous index knew rather than indexing the file as
+        // empty; a zero size and mtime make the next build read it again
+        record.unreadable = true;
+        record.size = 0;
+        record.modified = 0;
+        if (record.previous >= 0) {
+            record.hash = previousHash;
+            record.reused = true;
+        }
+        return;
+    }
+
+    record.hash = contentHash(source);
+    if (record.previous >= 0 && record.hash == previousHash) {
+        record.reused = true;
+        return;
+    }
+    parseFile(record, source);
+}
+
+// Names seen while building; ids are provisional until the table is sorted
+class NameTable {
+public:
+    uint32_t intern(const std::string& name) {
+        auto it = ids.find(name);
+        if (it != ids.end()) return it->second;
+        uint32_t id = static_cast<uint32_t>(names.size());
+        ids.emplace(name, id);
+        names.push_back(name);
+        return id;
+    }
+
+    // Sort the names; returns the final id of every provisional id
+    std::vector<uint32_t> sort() {
+        std::vector<uint32_t> order(names.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = static_cast<uint32_t>(i);
+        std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) { return names[a] < names[b]; });
+
+        std::vector<uint32_t> finalIds(names.size());
+        std::vector<std::string> sorted(names.size());
+        for (size_t i = 0; i < order.size(); i++) {
+            finalIds[order[i]] = static_cast<uint32_t>(i);
+            sorted[i] = std::move(names[order[i]]);
+        }
+        names = std::move(sorted);
+        ids.clear();
+        return finalIds;
+    }
+
+    const std::vector<std::string>& sortedNames() const { return names; }
+
+private:
+    std::unordered_map<std::string, uint32_t> ids;
+    std::vector<std::string> names;
+};
+
+std::string writeIndex(std::vector<FileRecord>& records, NameTable& table) {
+    // Number names in sorted order so queries can binary-search
+    std::vector<uint32_t> finalIds = table.sort();
+    const std::vector<std::string>& names = table.sortedNames();
+    for (auto& record : records) {
+        for (auto& entry : record.raw) {
+            entry.name = finalIds[entry.name];
+            if (entry.scope != NO_SCOPE) entry.scope = finalIds[entry.scope];
+        }
+    }
+
+    // Strings: paths, then names
+    std::string strings;
+    std::vector<uint32_t> pathOffsets;
+    for (const auto& record : records) {
+        pathOffsets.push_back(static_cast<uint32_t>(strings.size()));
+        strings += record.path;
+    }
+    std::vector<uint32_t> nameOffsets;
+    for (const auto& name : names) {
+        nameOffsets.push_back(static_cast<uint32_t>(strings.size()));
+        strings += name;
+    }
+
+    // Postings list the entries of each name, grouped by kind; entries are
+    // already in file and line order
+    std::vector<std::vector<uint32_t>> postings(names.size());
+    std::vector<IndexEntry::Kind> kinds;
+    uint32_t entryCount = 0;
+    for (const auto& record : records) {
+        for (const auto& entry : record.raw) {
+            postings[entry.name].push_back(entryCount++);
+            kinds.push_back(entry.kind);
+        }
+    }
+    for (auto& list : postings) {
+        std::stable_sort(list.begin(), list.end(), [&kinds](uint32_t a, uint32_t b) {
+            return kinds[a] < kinds[b];
+        });
+    }
+
+    uint64_t filesOffset = HEADER_SIZE;
+    uint64_t namesOffset = filesOffset + records.size() * FILE_RECORD_SIZE;
+    uint64_t postingsOffset = namesOffset + names.size() * NAME_RECORD_SIZE;
+    uint64_t entriesOffset = postingsOffset + static_cast<uint64_t>(entryCount) * 4;
+    uint64_t stringsOffset = entriesOffset + static_cast<uint64_t>(entryCount) * ENTRY_RECORD_SIZE;
+
+    AstWriter out;
+    out.writeU32(INDEX_MAGIC);
+    out.writeU32(INDEX_VERSION);
+    out.writeU32(static_cast<uint32_t>(records.size()));
+    out.writeU32(static_cast<uint32_t>(names.size()));
+    out.writeU32(entryCount);
+    out.writeU32(0);
+    out.writeU64(filesOffset);
+    out.writeU64(namesOffset);
+    out.writeU64(postingsOffset);
+    out.writeU64(entriesOffset);
+    out.writeU64(stringsOffset);
+
+    uint32_t firstEntry = 0;
+    for (size_t i = 0; i < records.size(); i++) {
+        const FileRecord& record = records[i];
+        out.writeU32(pathOffsets[i]);
+        out.writeU32(static_cast<uint32_t>(record.path.size()));
+        out.writeU64(record.size);
+        out.writeU64(record.modified);
+        out.writeU64(record.hash);
+        out.writeU32(firstEntry);
+        out.writeU32(static_cast<uint32_t>(record.raw.size()));
+        firstEntry += static_cast<uint32_t>(record.raw.size());
+    }
+
+    uint32_t firstPosting = 0;
+    for (size_t i = 0; i < names.size(); i++) {
+        out.writeU32(nameOffsets[i]);
+        out.writeU32(static_cast<uint32_t>(names[i].size()));
+        out.writeU32(firstPosting);
+        out.writeU32(static_cast<uint32_t>(postings[i].size()));
+        firstPosting += static_cast<uint32_t>(postings[i].size());
+    }
+
+    for (const auto& list : postings) {
+        for (uint32_t entry : list) out.writeU32(entry);
+    }
+
+    for (size_t i = 0; i < records.size(); i++) {
+        for (const auto& entry : records[i].raw) {
+            out.writeU32(static_cast<uint32_t>(i));
+            out.writeU32(entry.name);
+            out.writeU32(entry.scope);
+            out.writeU32(entry.line);
+            out.writeU32(entry.column);
+            out.writeU32(static_cast<uint32_t>(entry.kind));
+        }
+    }
+
+    std::string image = out.data();
+    image += strings;
+    return image;
+}
+
+} // namespace
+
+std::string SymbolIndex::pathFor(const std::string& root) {
+    return root + "/.cookindex";
+}
+
+IndexReport SymbolIndex::build(const std::string& root, size_t threads) {
+    std::string base = root;
+    while (base.size() > 1 && (base.back() == '/' || base.back() == '\\')) base.pop_back();
+    if (!isDirectory(base)) {
+        throw std::runtime_error("Not a directory: '" + root + "'");
+    }
+
+    // Reuse what the previous index knows about unchanged files
+    SymbolIndex previous;
+    bool havePrevious = false;
+    try {
+        havePrevious = previous.open(base);
+    } catch (const std::exception&) {
+        havePrevious = false;
+    }
+
+    std::unordered_map<std::string, uint32_t> previousFiles;
+    if (havePrevious) {
+        for (uint32_t i = 0; i < previous.files; i++) {
+            previousFiles[previous.filePath(i)] = i;
+        }
+    }
+
+    std::vector<std::string> paths = findCookFiles(base);
+    std::vector<FileRecord> records(paths.size());
+    std::vector<uint64_t> previousHashes(paths.size(), 0);
+
+    {
+        ThreadPool pool(threads);
+        for (size_t i = 0; i < paths.size(); i++) {
+            FileRecord& record = records[i];
+            record.fullPath = paths[i];
+            record.path = paths[i].substr(base.size() + 1);
+            if (!fileStatus(record.fullPath, record.size, record.modified)) continue;
+
+            auto it = previousFiles.find(record.path);
+            if (it != previousFiles.end()) {
+                record.previous = static_cast<int>(it->second);
+                AstReader file(previous.map.data(), previous.map.size());
+                file.seek(previous.filesOffset + it->second * FILE_RECORD_SIZE + 8);
+                uint64_t size = file.readU64();
+                uint64_t modified = file.readU64();
+                previousHashes[i] = file.readU64();
+
+                if (size == record.size && modified == record.modified) {
+                    record.hash = previousHashes[i];
+                    record.reused = true;
+                    continue;
+                }
+            }
+
+            uint64_t previousHash = previousHashes[i];
+            pool.submit([&record, previousHash] { refreshFile(record, previousHash); });
+        }
+        pool.wait();
+    }
+
+    // Entries of unchanged files are copied from the previous index by id;
+    // each of its names is decoded once
+    NameTable table;
+    std::vector<uint32_t> previousNames(havePrevious ? previous.names : 0, NO_SCOPE);
+    auto translate = [&](uint32_t id) {
+        if (id == NO_SCOPE) return NO_SCOPE;
+        if (previousNames[id] == NO_SCOPE) previousNames[id] = table.intern(previous.nameAt(id));
+        return previousNames[id];
+    };
+
+    IndexReport report;
+    report.files = records.size();
+    for (auto& record : records) {
+        if (record.reused) {
+            AstReader file(previous.map.data(), previous.map.size());
+            file.seek(previous.filesOffset + record.previous * FILE_RECORD_SIZE + 32);
+            uint32_t first = file.readU32();
+            uint32_t count = file.readU32();
+
+            AstReader entry(previous.map.data(), previous.map.size());
+            entry.seek(previous.entriesOffset + static_cast<uint64_t>(first) * ENTRY_RECORD_SIZE);
+            for (uint32_t i = 0; i < count; i++) {
+                entry.readU32();
+                RawEntry raw;
+                raw.name = translate(entry.readU32());
+                raw.scope = translate(entry.readU32());
+                raw.line = entry.readU32();
+                raw.column = entry.readU32();
+                raw.kind = static_cast<IndexEntry::Kind>(entry.readU32());
+                record.raw.push_back(raw);
+            }
+        } else {
+            for (const auto& parsed : record.entries) {
+                uint32_t scope = parsed.scope.empty() ? NO_SCOPE : table.intern(parsed.scope);
+                record.raw.push_back(RawEntry{table.intern(parsed.name), scope, parsed.line, parsed.column, parsed.kind});
+            }
+            record.entries.clear();
+        }
+
+        if (record.parsed) report.parsed++;
+        if (record.unreadable) report.unreadable.push_back(record.path);
+        report.entries += record.raw.size();
+        report.syntaxErrors += record.syntaxErrors;
+    }
+
+    std::string image = writeIndex(records, table);
+    previous.map.close();
+
+    // Write beside the index and rename, so readers never see a partial file
+    std::string path = pathFor(base);
+    std::string temporary = path + ".tmp";
+    {
+        std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            throw std::runtime_error("Could not write index '" + path + "'");
+        }
+        out.write(image.data(), static_cast<std::streamsize>(image.size()));
+        if (!out) {
+            throw std::runtime_error("Could not write index '" + path + "'");
+        }
+    }
+#ifdef _WIN32
+    std::remove(path.c_str());
+#endif
+    if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+        std::remove(temporary.c_str());
+        throw std::runtime_error("Could not write index '" + path + "'");
+    }
+
+    return report;
+}
+
+bool SymbolIndex::open(const std::string& root) {
+    if (!map.open(pathFor(root)) || map.size() < HEADER_SIZE) return false;
+
+    AstReader header(map.data(), map.size());
+    if (header.readU32() != INDEX_MAGIC || header.readU32() != INDEX_VERSION) {
+        map.close();
+        return false;
+    }
+
+    files = header.readU32();
+    names = header.readU32();
+    entries = header.readU32();
+    header.readU32();
+    filesOffset = header.readU64();
+    namesOffset = header.readU64();
+    postingsOffset = header.readU64();
+    entriesOffset = header.readU64();
+    stringsOffset = header.readU64();
+
+    if (stringsOffset > map.size() ||
+        entriesOffset + static_cast<uint64_t>(entries) * ENTRY_RECORD_SIZE > stringsOffset) {
+        map.close();
+        return false;
+    }
+    return true;
+}
+
+std::vector<IndexEntry> SymbolIndex::find(const std::string& name) const {
+    std::vector<IndexEntry> result;
+
+    // Binary search the sorted name table
+    uint32_t low = 0;
+    uint32_t high = names;
+    while (low < high) {
+        uint32_t middle = low + (high - low) / 2;
+        if (nameAt(middle) < name) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    if (low == names || nameAt(low) != name) return result;
+
+    AstReader record(map.data(), map.size());
+    record.seek(namesOffset + low * NAME_RECORD_SIZE + 8);
+    uint32_t firstPosting = record.readU32();
+    uint32_t count = record.readU32();
+
+    AstReader postings(map.data(), map.size());
+    postings.seek(postingsOffset + static_cast<uint64_t>(firstPosting) * 4);
+    for (uint32_t i = 0; i < count; i++) {
+        result.push_back(entryAt(postings.readU32()));
+    }
+    return result;
+}
+
+std::string SymbolIndex::string(uint32_t offset, uint32_t length) const {
+    if (stringsOffset + offset + length > map.size()) {
+        throw std::runtime_error("Invalid string in symbol index");
+    }
+    return std::string(map.data() + stringsOffset + offset, length);
+}
+
+std::string SymbolIndex::nameAt(uint32_t id) const {
+    AstReader record(map.data(), map.size());
+    record.seek(namesOffset + id * NAME_RECORD_SIZE);
+    uint32_t offset = record.readU32();
+    uint32_t length = record.readU32();
+    return string(offset, length);
+}
+
+std::string SymbolIndex::filePath(uint32_t index) const {
+    AstReader record(map.data(), map.size());
+    record.seek(filesOffset + index * FILE_RECORD_SIZE);
+    uint32_t offset = record.readU32();
+    uint32_t length = record.readU32();
+    return string(offset, length);
+}
+
+IndexEntry SymbolIndex::entryAt(uint32_t index) const {
+    AstReader record(map.data(), map.size());
+    record.seek(entriesOffset + static_cast<uint64_t>(index) * ENTRY_RECORD_SIZE);
+
+    IndexEntry entry;
+    entry.file = filePath(record.readU32());
+    entry.name = nameAt(record.readU32());
+    uint32_t scope = record.readU32();
+    entry.scope = scope == NO_SCOPE ? "" : nameAt(scope);
+    entry.line = record.readU32();
+    entry.column = record.readU32();
+    entry.kind = static_cast<IndexEntry::Kind>(record.readU32());
+    return entry;
+}
+
+} // namespace cook
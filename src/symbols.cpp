@@ -0,0 +1,92 @@
+#include "symbols.h"
+
+namespace cook {
+
+void SymbolCollector::collect(const Statement* stmt) {
+    if (auto* ingredient = dynamic_cast<const IngredientStmt*>(stmt)) {
+        globals.push_back(declared(stmt, ingredient->name, Symbol::Kind::INGREDIENT));
+        if (ingredient->initializer) expression(ingredient->initializer.get());
+    } else if (auto* recipe = dynamic_cast<const RecipeStmt*>(stmt)) {
+        globals.push_back(declared(stmt, recipe->name, Symbol::Kind::RECIPE));
+        scope = recipe->name;
+        parameters(recipe);
+        for (const auto& bodyStmt : recipe->body) {
+            body(bodyStmt.get());
+        }
+        scope.clear();
+    } else if (auto* cookbook = dynamic_cast<const CookbookStmt*>(stmt)) {
+        cookbooks.push_back(cookbook->path);
+    } else {
+        body(stmt);
+    }
+}
+
+// Index of the token at line:column. Statements are visited in source order,
+// so the search continues from the previous match.
+size_t SymbolCollector::tokenAt(int line, int column) {
+    for (size_t i = cursor; i < tokens.size(); i++) {
+        if (tokens[i].line == line && tokens[i].column == column) {
+            cursor = i;
+            return i;
+        }
+    }
+    return tokens.size();
+}
+
+// The name token follows the declaring keyword
+Symbol SymbolCollector::declared(const Statement* stmt, const std::string& name, Symbol::Kind kind) {
+    std::string owner = kind == Symbol::Kind::RECIPE ? "" : scope;
+    size_t i = tokenAt(stmt->line, stmt->column);
+    if (i + 1 < tokens.size() && tokens[i + 1].lexeme == name) {
+        return Symbol{name, kind, tokens[i + 1].line, tokens[i + 1].column, owner};
+    }
+    return Symbol{name, kind, stmt->line, stmt->column, owner};
+}
+
+void SymbolCollector::parameters(const RecipeStmt* recipe) {
+    // recipe name ( parameters )
+    size_t i = tokenAt(recipe->line, recipe->column);
+    size_t found = 0;
+    for (size_t j = i + 3; j < tokens.size() && found < recipe->parameters.size(); j++) {
+        if (tokens[j].type == TokenType::RPAREN) break;
+        if (tokens[j].type == TokenType::IDENTIFIER && tokens[j].lexeme == recipe->parameters[found]) {
+            locals.push_back(Symbol{tokens[j].lexeme, Symbol::Kind::PARAMETER, tokens[j].line, tokens[j].column, scope});
+            found++;
+        }
+    }
+    for (; found < recipe->parameters.size(); found++) {
+        locals.push_back(Symbol{recipe->parameters[found], Symbol::Kind::PARAMETER, recipe->line, recipe->column, scope});
+    }
+}
+
+void SymbolCollector::body(const Statement* stmt) {
+    if (auto* ingredient = dynamic_cast<const IngredientStmt*>(stmt)) {
+        locals.push_back(declared(stmt, ingredient->name, Symbol::Kind::INGREDIENT));
+        if (ingredient->initializer) expression(ingredient->initializer.get());
+    } else if (auto* exprStmt = dynamic_cast<const ExpressionStmt*>(stmt)) {
+        expression(exprStmt->expression.get());
+    } else if (auto* taste = dynamic_cast<const TasteStmt*>(stmt)) {
+        expression(taste->expression.get());
+    }
+}
+
+void SymbolCollector::expression(const Expression* expr) {
+    if (auto* variable = dynamic_cast<const VariableExpr*>(expr)) {
+        references.push_back(Reference{variable->name, false, expr->line, expr->column, scope});
+    } else if (auto* unary = dynamic_cast<const UnaryExpr*>(expr)) {
+        expression(unary->operand.get());
+    } else if (auto* binary = dynamic_cast<const BinaryExpr*>(expr)) {
+        expression(binary->left.get());
+        expression(binary->right.get());
+    } else if (auto* assign = dynamic_cast<const AssignExpr*>(expr)) {
+        references.push_back(Reference{assign->name, false, expr->line, expr->column, scope});
+        expression(assign->value.get());
+    } else if (auto* call = dynamic_cast<const CallExpr*>(expr)) {
+        references.push_back(Reference{call->callee, true, expr->line, expr->column, scope});
+        for (const auto& argument : call->arguments) {
+            expression(argument.get());
+        }
+    }
+}
+
+} // namespace cook
@@ -0,0 +1,527 @@
+#include "transpiler.h"
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+namespace cook {
+
+namespace {
+
+const char* const OPERATOR_NAMES[] = {
+    "ADD", "SUBTRACT", "MULTIPLY", "DIVIDE",
+    "EQUAL", "NOT_EQUAL", "LESS", "LESS_EQUAL", "GREATER", "GREATER_EQUAL"
+};
+
+const char* const OPERATOR_SYMBOLS[] = {
+    "+", "-", "*", "/", "==", "!=", "<", "<=", ">", ">="
+};
+
+bool isTemporary(const std::string& text) {
+    if (text.size() < 2 || text[0] != 't') return false;
+    for (size_t i = 1; i < text.size(); i++) {
+        if (text[i] < '0' || text[i] > '9') return false;
+    }
+    return true;
+}
+
+// Double literal that converts back to exactly 'value'
+std::string numberLiteral(double value) {
+    if (std::isinf(value)) {
+        return value > 0 ? "std::numeric_limits<double>::infinity()"
+                         : "-std::numeric_limits<double>::infinity()";
+    }
+
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.17g", value);
+    std::string text = buffer;
+    if (text.find_first_of(".e") == std::string::npos) text += ".0";
+    return text;
+}
+
+// Remove one level of indentation from every line of 'text'
+std::string dedented(const std::string& text) {
+    std::string result;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t end = text.find('\n', start);
+        if (end == std::string::npos) end = text.size() - 1;
+        size_t skip = text.compare(start, 4, "    ") == 0 ? 4 : 0;
+        result.append(text, start + skip, end + 1 - start - skip);
+        start = end + 1;
+    }
+    return result;
+}
+
+} // namespace
+
+Transpiler::Transpiler(const std::string& sourceName) : sourceName(sourceName) {}
+
+std::string Transpiler::translate(const Program& program) {
+    collect(program.statements, true);
+
+    do {
+        widened = false;
+        for (const auto& stmt : program.statements) {
+            inferStatement(stmt.get());
+        }
+    } while (widened);
+
+    output.clear();
+    line("// Generated by `cook compile` from " + sourceName);
+    line("//");
+    line("// Build with: g++ -std=c++17 -O2 -I <cook>/include <this file>");
+    line("");
+    line("#include \"runtime.h\"");
+    line("#include <iostream>");
+    line("#include <limits>");
+    line("");
+    line("using namespace cook::runtime;");
+    line("");
+    line("namespace {");
+    line("");
+
+    // Every ingredient, and whether it is currently defined
+    line("struct State {");
+    indent++;
+    for (const auto& entry : slots) {
+        line(std::string(cppType(entry.second.type)) + " " + entry.second.field + "{};");
+        line("bool has_" + entry.first + " = false;");
+    }
+    indent--;
+    line("};");
+    line("");
+    line("State state;");
+
+    // Which declaration of each recipe has run, 0 before any
+    for (const auto& entry : recipes) {
+        line("int version_" + entry.first + " = 0;");
+    }
+    line("");
+
+    for (const auto& declaration : declarations) {
+        std::string parameters;
+        for (size_t i = 0; i < declaration.stmt->parameters.size(); i++) {
+            if (i > 0) parameters += ", ";
+            parameters += cppType(slotFor(declaration.stmt->parameters[i]).type);
+            parameters += " a" + std::to_string(i);
+        }
+        line("void " + declaration.function + "(" + parameters + ");");
+    }
+    if (!declarations.empty()) line("");
+
+    for (const auto& declaration : declarations) {
+        emitRecipe(declaration);
+    }
+
+    line("void run() {");
+    indent++;
+    for (const auto& stmt : program.statements) {
+        emitStatement(stmt.get());
+    }
+    indent--;
+    line("}");
+    line("");
+    line("} // namespace");
+    line("");
+    line("int main() {");
+    indent++;
+    line("std::cout << \"Loading file: \" << " + quoted(sourceName) + " << std::endl;");
+    line("std::cout << \"File loaded, running...\" << std::endl;");
+    line("try {");
+    line("    run();");
+    line("} catch (const std::exception& e) {");
+    line("    std::cerr << \"Error: \" << e.what() << std::endl;");
+    line("    return 1;");
+    line("}");
+    line("std::cout << \"Execution complete.\" << std::endl;");
+    line("return 0;");
+    indent--;
+    line("}");
+
+    return std::move(output);
+}
+
+Transpiler::Slot& Transpiler::slotFor(const std::string& name) {
+    Slot& slot = slots[name];
+    if (slot.field.empty()) slot.field = "v_" + name;
+    return slot;
+}
+
+// Type inference
+
+void Transpiler::collect(const std::vector<std::unique_ptr<Statement>>& statements, bool topLevel) {
+    for (const auto& statement : statements) {
+        if (dynamic_cast<const CookbookStmt*>(statement.get())) {
+            throw std::runtime_error("line " + std::to_string(statement->line) +
+                                     ": cookbooks are not supported by cook compile");
+        }
+
+        // Recipes inside recipes never run, as in the interpreter
+        auto recipe = dynamic_cast<const RecipeStmt*>(statement.get());
+        if (!recipe || !topLevel) continue;
+
+        std::vector<size_t>& versions = recipes[recipe->name];
+        versions.push_back(declarations.size());
+        std::string function = "recipe_" + recipe->name;
+        if (versions.size() > 1) function += "_" + std::to_string(versions.size());
+        declarations.push_back(Declaration{recipe, function});
+        collect(recipe->body, false);
+    }
+}
+
+void Transpiler::inferStatement(const Statement* stmt) {
+    if (auto exprStmt = dynamic_cast<const ExpressionStmt*>(stmt)) {
+        infer(exprStmt->expression.get());
+    } else if (auto ingredientStmt = dynamic_cast<const IngredientStmt*>(stmt)) {
+        Type type = ingredientStmt->initializer ? infer(ingredientStmt->initializer.get()) : Type::STRING;
+        widen(ingredientStmt->name, type);
+    } else if (auto tasteStmt = dynamic_cast<const TasteStmt*>(stmt)) {
+        infer(tasteStmt->expression.get());
+    } else if (auto recipeStmt = dynamic_cast<const RecipeStmt*>(stmt)) {
+        for (const auto& bodyStmt : recipeStmt->body) {
+            if (!dynamic_cast<const RecipeStmt*>(bodyStmt.get())) inferStatement(bodyStmt.get());
+        }
+    }
+}
+
+Transpiler::Type Transpiler::infer(const Expression* expr) {
+    if (auto literal = dynamic_cast<const LiteralExpr*>(expr)) {
+        switch (literal->type) {
+            case LiteralExpr::Type::INTEGER: return Type::INTEGER;
+            case LiteralExpr::Type::NUMBER: return Type::NUMBER;
+            default: return Type::STRING;
+        }
+    } else if (auto variable = dynamic_cast<const VariableExpr*>(expr)) {
+        return slotFor(variable->name).type;
+    } else if (auto unary = dynamic_cast<const UnaryExpr*>(expr)) {
+        return unaryType(unary->op, infer(unary->operand.get()));
+    } else if (auto binary = dynamic_cast<const BinaryExpr*>(expr)) {
+        Type left = infer(binary->left.get());
+        return binaryType(binary->op, left, infer(binary->right.get()));
+    } else if (auto assign = dynamic_cast<const AssignExpr*>(expr)) {
+        Type type = infer(assign->value.get());
+        widen(assign->name, type);
+        return type;
+    } else if (auto call = dynamic_cast<const CallExpr*>(expr)) {
+        std::vector<Type> arguments;
+        for (const auto& argument : call->arguments) {
+            arguments.push_back(infer(argument.get()));
+        }
+
+        // Arguments are bound to the parameters of every declaration they fit
+        auto found = recipes.find(call->callee);
+        if (found != recipes.end()) {
+            for (size_t index : found->second) {
+                const RecipeStmt* recipe = declarations[index].stmt;
+                if (recipe->parameters.size() != arguments.size()) continue;
+                for (size_t i = 0; i < arguments.size(); i++) {
+                    widen(recipe->parameters[i], arguments[i]);
+                }
+            }
+        }
+        return Type::STRING;
+    }
+
+    throw std::runtime_error("Unknown expression type");
+}
+
+void Transpiler::widen(const std::string& name, Type type) {
+    Slot& slot = slotFor(name);
+    if (type == Type::NONE || slot.type == type || slot.type == Type::DYNAMIC) return;
+    slot.type = slot.type == Type::NONE ? type : Type::DYNAMIC;
+    widened = true;
+}
+
+// Result types follow the interpreter: two integers stay integers only
+// without overflow, so only their sum's "some number" is known; any double
+// makes a double; a string makes '+' concatenate. An operand that is NONE
+// makes the result NONE until a later pass knows more.
+Transpiler::Type Transpiler::binaryType(BinaryExpr::Operator op, Type left, Type right) {
+    if (op >= BinaryExpr::Operator::EQUAL) return Type::INTEGER;
+    if (left == Type::NONE || right == Type::NONE) return Type::NONE;
+
+    bool numbers = (left == Type::INTEGER || left == Type::NUMBER) &&
+                   (right == Type::INTEGER || right == Type::NUMBER);
+    if (numbers) {
+        return left == Type::INTEGER && right == Type::INTEGER ? Type::DYNAMIC : Type::NUMBER;
+    }
+    if (op == BinaryExpr::Operator::ADD && (left == Type::STRING || right == Type::STRING)) {
+        return Type::STRING;
+    }
+    return Type::DYNAMIC;
+}
+
+Transpiler::Type Transpiler::unaryType(UnaryExpr::Operator op, Type operand) {
+    if (op == UnaryExpr::Operator::NOT) return Type::INTEGER;
+    if (operand == Type::NONE || operand == Type::NUMBER) return operand;
+    return Type::DYNAMIC;
+}
+
+// Generation
+
+void Transpiler::line(const std::string& text) {
+    if (!text.empty()) output.append(static_cast<size_t>(indent) * 4, ' ');
+    output += text;
+    output += '\n';
+}
+
+void Transpiler::emitStatement(const Statement* stmt) {
+    // Temporaries are scoped to their statement
+    std::string before = std::move(output);
+    output.clear();
+    int firstTemporary = temporaries;
+    indent++;
+
+    if (auto exprStmt = dynamic_cast<const ExpressionStmt*>(stmt)) {
+        Code code = emitExpression(exprStmt->expression.get());
+        if (isTemporary(code.text)) line("(void)" + code.text + ";");
+    } else if (auto ingredientStmt = dynamic_cast<const IngredientStmt*>(stmt)) {
+        Code value = ingredientStmt->initializer ? emitExpression(ingredientStmt->initializer.get())
+                                                 : Code{"std::string()", Type::STRING};
+        const Slot& slot = slotFor(ingredientStmt->name);
+        line("state." + slot.field + " = " + converted(value, slot.type) + ";");
+        line("state.has_" + ingredientStmt->name + " = true;");
+    } else if (auto tasteStmt = dynamic_cast<const TasteStmt*>(stmt)) {
+        Code value = emitExpression(tasteStmt->expression.get());
+        line("taste(std::cout, " + value.text + ");");
+    } else if (auto recipeStmt = dynamic_cast<const RecipeStmt*>(stmt)) {
+        const std::vector<size_t>& versions = recipes[recipeStmt->name];
+        size_t version = 0;
+        while (declarations[versions[version]].stmt != recipeStmt) version++;
+        line("version_" + recipeStmt->name + " = " + std::to_string(version + 1) + ";");
+        line("std::cout << \"Recipe '" + recipeStmt->name + "' defined with " +
+             std::to_string(recipeStmt->parameters.size()) + " parameters\" << std::endl;");
+    }
+
+    indent--;
+    std::string body = std::move(output);
+    output = std::move(before);
+    if (temporaries == firstTemporary) {
+        output += dedented(body);
+    } else {
+        line("{");
+        output += body;
+        line("}");
+    }
+}
+
+void Transpiler::emitRecipe(const Declaration& declaration) {
+    const RecipeStmt* recipe = declaration.stmt;
+    std::string parameters;
+    for (size_t i = 0; i < recipe->parameters.size(); i++) {
+        if (i > 0) parameters += ", ";
+        parameters += cppType(slotFor(recipe->parameters[i]).type);
+        parameters += " a" + std::to_string(i);
+    }
+
+    line("// recipe " + recipe->name + ", line " + std::to_string(recipe->line));
+    line("void " + declaration.function + "(" + parameters + ") {");
+    indent++;
+
+    // Every ingredient is restored when the call returns
+    line("State saved = state;");
+    for (size_t i = 0; i < recipe->parameters.size(); i++) {
+        const std::string& name = recipe->parameters[i];
+        line("state." + slotFor(name).field + " = std::move(a" + std::to_string(i) + ");");
+        line("state.has_" + name + " = true;");
+    }
+    for (const auto& stmt : recipe->body) {
+        if (!dynamic_cast<const RecipeStmt*>(stmt.get())) emitStatement(stmt.get());
+    }
+    line("state = std::move(saved);");
+
+    indent--;
+    line("}");
+    line("");
+}
+
+Transpiler::Code Transpiler::emitExpression(const Expression* expr) {
+    if (auto literal = dynamic_cast<const LiteralExpr*>(expr)) {
+        switch (literal->type) {
+            case LiteralExpr::Type::INTEGER:
+                if (literal->integer == INT64_MIN) return Code{"INT64_MIN", Type::INTEGER};
+                return Code{"int64_t(" + std::to_string(literal->integer) + ")", Type::INTEGER};
+            case LiteralExpr::Type::NUMBER:
+                return Code{numberLiteral(literal->number), Type::NUMBER};
+            default:
+                if (literal->value.empty()) return Code{"std::string()", Type::STRING};
+                return Code{"std::string(" + quoted(literal->value) + ", " +
+                            std::to_string(literal->value.size()) + ")", Type::STRING};
+        }
+    } else if (auto variable = dynamic_cast<const VariableExpr*>(expr)) {
+        // Copied, since a later operand may assign the ingredient
+        checkDefined(variable->name);
+        const Slot& slot = slotFor(variable->name);
+        return temporary(Code{"state." + slot.field, slot.type});
+    } else if (auto unary = dynamic_cast<const UnaryExpr*>(expr)) {
+        Code operand = emitExpression(unary->operand.get());
+        if (unary->op == UnaryExpr::Operator::NOT) {
+            switch (operand.type) {
+                case Type::INTEGER:
+                case Type::NUMBER:
+                    return temporary(Code{"int64_t(" + operand.text + " == 0)", Type::INTEGER});
+                case Type::STRING:
+                    return temporary(Code{"int64_t(" + operand.text + ".empty())", Type::INTEGER});
+                default:
+                    return temporary(Code{"logicalNot(" + operand.text + ")", Type::INTEGER});
+            }
+        }
+        if (operand.type == Type::NUMBER) return temporary(Code{"-" + operand.text, Type::NUMBER});
+        return temporary(Code{"negate(" + boxed(operand) + ")", unaryType(unary->op, operand.type)});
+    } else if (auto binary = dynamic_cast<const BinaryExpr*>(expr)) {
+        return emitBinary(binary);
+    } else if (auto assign = dynamic_cast<const AssignExpr*>(expr)) {
+        Code value = emitExpression(assign->value.get());
+        checkDefined(assign->name);
+        const Slot& slot = slotFor(assign->name);
+        line("state." + slot.field + " = " + converted(value, slot.type) + ";");
+        return value;
+    } else if (auto call = dynamic_cast<const CallExpr*>(expr)) {
+        return emitCall(call);
+    }
+
+    throw std::runtime_error("Unknown expression type");
+}
+
+Transpiler::Code Transpiler::emitBinary(const BinaryExpr* expr) {
+    Code left = emitExpression(expr->left.get());
+    Code right = emitExpression(expr->right.get());
+    Type type = binaryType(expr->op, left.type, right.type);
+    size_t op = static_cast<size_t>(expr->op);
+
+    bool numbers = (left.type == Type::INTEGER || left.type == Type::NUMBER) &&
+                   (right.type == Type::INTEGER || right.type == Type::NUMBER);
+    bool strings = left.type == Type::STRING && right.type == Type::STRING;
+    std::string plain = left.text + " " + OPERATOR_SYMBOLS[op] + " " + right.text;
+
+    // Operations whose result type is fixed compile to C++ operators; the
+    // rest go through runtime::binary
+    if (expr->op >= BinaryExpr::Operator::EQUAL) {
+        if (numbers || strings) return temporary(Code{"int64_t(" + plain + ")", Type::INTEGER});
+    } else if (type == Type::NUMBER) {
+        if (expr->op == BinaryExpr::Operator::DIVIDE) {
+            return temporary(Code{"divide(" + left.text + ", " + right.text + ")", type});
+        }
+        return temporary(Code{plain, type});
+    } else if (type == Type::STRING) {
+        return temporary(Code{"concat(" + left.text + ", " + right.text + ")", type});
+    }
+
+    std::string generic = std::string("binary<Operator::") + OPERATOR_NAMES[op] + ">(" +
+                          boxed(left) + ", " + boxed(right) + ")";
+    if (type == Type::INTEGER) generic += ".getInteger()";
+    return temporary(Code{generic, type});
+}
+
+Transpiler::Code Transpiler::emitCall(const CallExpr* expr) {
+    Code result{"std::string(\"recipe result\", 13)", Type::STRING};
+
+    auto found = recipes.find(expr->callee);
+    if (found == recipes.end()) {
+        line("undefinedRecipe(" + quoted(expr->callee) + ");");
+        return result;
+    }
+    line("if (version_" + expr->callee + " == 0) undefinedRecipe(" + quoted(expr->callee) + ");");
+
+    std::vector<Code> arguments;
+    for (const auto& argument : expr->arguments) {
+        arguments.push_back(emitExpression(argument.get()));
+    }
+
+    const std::vector<size_t>& versions = found->second;
+    if (versions.size() > 1) {
+        line("switch (version_" + expr->callee + ") {");
+    }
+    for (size_t version = 0; version < versions.size(); version++) {
+        const Declaration& declaration = declarations[versions[version]];
+        const std::vector<std::string>& parameters = declaration.stmt->parameters;
+
+        std::string call;
+        if (parameters.size() != arguments.size()) {
+            call = "wrongArgumentCount(" + std::to_string(parameters.size()) + ", " +
+                   std::to_string(arguments.size()) + ");";
+        } else {
+            call = declaration.function + "(";
+            for (size_t i = 0; i < arguments.size(); i++) {
+                if (i > 0) call += ", ";
+                call += converted(arguments[i], slotFor(parameters[i]).type);
+            }
+            call += ");";
+        }
+
+        if (versions.size() > 1) {
+            line("case " + std::to_string(version + 1) + ":");
+            indent++;
+            line(call);
+            line("break;");
+            indent--;
+        } else {
+            line(call);
+        }
+    }
+    if (versions.size() > 1) {
+        line("}");
+    }
+
+    return result;
+}
+
+Transpiler::Code Transpiler::temporary(const Code& code) {
+    std::string name = "t" + std::to_string(++temporaries);
+    line("const " + std::string(cppType(code.type)) + " " + name + " = " + code.text + ";");
+    return Code{name, code.type};
+}
+
+void Transpiler::checkDefined(const std::string& name) {
+    line("if (!state.has_" + name + ") undefinedIngredient(" + quoted(name) + ");");
+}
+
+const char* Transpiler::cppType(Type type) {
+    switch (type) {
+        case Type::INTEGER: return "int64_t";
+        case Type::NUMBER: return "double";
+        case Type::STRING: return "std::string";
+        default: return "Value";
+    }
+}
+
+std::string Transpiler::boxed(const Code& code) {
+    if (code.type == Type::DYNAMIC || code.type == Type::NONE) return code.text;
+    return "Value(" + code.text + ")";
+}
+
+// 'code' stored as 'type'. Inference makes every stored value's type fit
+// its slot, except NONE values, which are never produced.
+std::string Transpiler::converted(const Code& code, Type type) {
+    bool dynamic = type == Type::DYNAMIC || type == Type::NONE;
+    if (code.type == type || dynamic) return dynamic ? boxed(code) : code.text;
+
+    std::string value = boxed(code);
+    switch (type) {
+        case Type::INTEGER: return "integerOf(" + value + ")";
+        case Type::NUMBER: return "numberOf(" + value + ")";
+        default: return "stringOf(" + value + ")";
+    }
+}
+
+// C++ string literal for any bytes
+std::string Transpiler::quoted(const std::string& text) {
+    std::string result = "\"";
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            result += '\\';
+            result += static_cast<char>(c);
+        } else if (c == '\n') {
+            result += "\\n";
+        } else if (c >= 0x20 && c < 0x7f) {
+            result += static_cast<char>(c);
+        } else {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\%03o", c);
+            result += escape;
+        }
+    }
+    return result + "\"";
+}
+
+} // namespace cook
@@ -0,0 +1,261 @@
+#include "watch.h"
+#include "files.h"
+#include "lexer.h"
+#include "module.h"
+#include "parser.h"
+#include "serializer.h"
+#include "stats.h"
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+namespace cook {
+
+namespace {
+
+// Offsets of the lines of a source, to turn a line and column into an offset
+class LineTable {
+public:
+    explicit LineTable(const std::string& source) {
+        starts.push_back(0);
+        for (size_t i = 0; i < source.size(); i++) {
+            if (source[i] == '\n') starts.push_back(i + 1);
+        }
+    }
+
+    size_t offset(int line, int column) const {
+        return starts[static_cast<size_t>(line) - 1] + static_cast<size_t>(column) - 1;
+    }
+
+    // Line and column of an offset
+    void position(size_t offset, int& line, int& column) const {
+        size_t index = static_cast<size_t>(std::distance(starts.begin(),
+                                                         std::upper_bound(starts.begin(), starts.end(), offset))) - 1;
+        line = static_cast<int>(index) + 1;
+        column = static_cast<int>(offset - starts[index]) + 1;
+    }
+
+private:
+    std::vector<size_t> starts;
+};
+
+// Polling interval where inotify is not available
+const int POLL_MILLIS = 200;
+
+// Events arriving this soon after a change belong to the same save
+const int SETTLE_MILLIS = 50;
+
+} // namespace
+
+Watcher::Watcher(std::string path, const ExecutionBudget& budget)
+    : path(std::move(path)), budget(budget) {
+    checkpoints[0] = "";
+    fileStatus(this->path, lastSize, lastModified);
+
+#ifdef __linux__
+    // Editors often save by writing a new file and renaming it over the old
+    // one, so watch the directory rather than the file
+    notifyFd = inotify_init1(IN_CLOEXEC);
+    if (notifyFd >= 0) {
+        std::string directory = directoryOf(this->path);
+        if (inotify_add_watch(notifyFd, directory.empty() ? "." : directory.c_str(),
+                              IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            close(notifyFd);
+            notifyFd = -1;
+        }
+    }
+#endif
+}
+
+Watcher::~Watcher() {
+#ifdef __linux__
+    if (notifyFd >= 0) close(notifyFd);
+#endif
+}
+
+bool Watcher::update(std::ostream& out, std::ostream& err) {
+    std::string source;
+    if (!readWholeFile(path, source)) {
+        err << "Could not open file: " << path << std::endl;
+        return false;
+    }
+
+    // Statements whose source is the same as in the last run, and the states
+    // saved within them
+    size_t start = 0;
+    reused = 0;
+    while (reused < entries.size()) {
+        const Entry& entry = entries[reused];
+        if (entry.end > source.size() || contentHash(source.substr(start, entry.end - start)) != entry.hash) {
+            break;
+        }
+        start = entry.end;
+        reused++;
+    }
+    entries.resize(reused);
+    checkpoints.erase(checkpoints.upper_bound(reused), checkpoints.end());
+
+    // Resume from the last of those states: lex and parse the rest of the
+    // file, then run the unchanged statements after the state quietly
+    size_t resume = std::prev(checkpoints.upper_bound(reused))->first;
+    size_t offset = resume == 0 ? 0 : entries[resume - 1].end;
+    LineTable lines(source);
+    int line, column;
+    lines.position(offset, line, column);
+
+    std::vector<Token> tokens = Lexer(source.substr(offset), line, column).tokenize();
+    Parser parser(tokens);
+    std::unique_ptr<Program> program = parser.parse();
+    if (!parser.getDiagnostics().empty()) {
+        for (const auto& diagnostic : parser.getDiagnostics()) {
+            err << diagnostic.format(path) << std::endl;
+        }
+        size_t count = parser.getDiagnostics().size();
+        err << "Error: " << count << (count == 1 ? " syntax error" : " syntax errors") << std::endl;
+        return false;
+    }
+
+    // Where each statement ends: just past its closing ';' or '}'
+    const auto& statements = program->statements;
+    std::vector<size_t> ends(statements.size());
+    size_t next = 0;
+    for (size_t i = 0; i < statements.size(); i++) {
+        size_t following = i + 1 < statements.size()
+                         ? lines.offset(statements[i + 1]->line, statements[i + 1]->column)
+                         : source.size();
+        const Token* last = nullptr;
+        while (next < tokens.size() && tokens[next].type != TokenType::EOF_TOKEN &&
+               lines.offset(tokens[next].line, tokens[next].column) < following) {
+            last = &tokens[next++];
+        }
+        bool closed = last && (last->type == TokenType::SEMICOLON || last->type == TokenType::RBRACE);
+        ends[i] = closed ? lines.offset(last->line, last->column) + 1 : following;
+    }
+
+    Interpreter interpreter;
+    interpreter.setBaseDirectory(directoryOf(path));
+    interpreter.setBudget(budget);
+    if (resume > 0) {
+        const std::string& state = checkpoints[resume];
+        AstReader reader(state.data(), state.size());
+        interpreter.restoreState(reader);
+    }
+    interpreter.startRun();
+
+    for (size_t i = 0; i < resume; i++) {
+        out << entries[i].output;
+    }
+
+    std::ostream discard(nullptr);
+    size_t index = resume;
+    try {
+        for (size_t i = 0; i < statements.size(); index++, i++) {
+            if (index < reused) {
+                interpreter.setOutput(discard);
+                interpreter.interpretStatement(*statements[i]);
+                out << entries[index].output;
+                continue;
+            }
+
+            if (index > 0 && (index % CHECKPOINT_INTERVAL == 0 || index == reused) && !checkpoints.count(index)) {
+                AstWriter writer;
+                interpreter.saveState(writer);
+                checkpoints[index] = writer.data();
+            }
+
+            std::ostringstream output;
+            interpreter.setOutput(output);
+            try {
+                interpreter.interpretStatement(*statements[i]);
+            } catch (...) {
+                out << output.str();
+                throw;
+            }
+
+            size_t begin = index == 0 ? 0 : entries[index - 1].end;
+            entries.push_back({ends[i], contentHash(source.substr(begin, ends[i] - begin)), output.str()});
+            out << entries.back().output;
+        }
+    } catch (const std::exception& e) {
+        // The statement that failed and the ones after it run again next time
+        entries.resize(std::min(entries.size(), index));
+        checkpoints.erase(checkpoints.upper_bound(index), checkpoints.end());
+        out.flush();
+        err << "Error: " << e.what() << std::endl;
+        return false;
+    }
+
+    out.flush();
+    return true;
+}
+
+void Watcher::waitForChange() {
+#ifdef __linux__
+    if (notifyFd >= 0) {
+        size_t slash = path.find_last_of("/\\");
+        std::string name = slash == std::string::npos ? path : path.substr(slash + 1);
+        alignas(struct inotify_event) char buffer[4096];
+        bool changed = false;
+        while (true) {
+            // Once the file has changed, wait only for the rest of the save
+            pollfd ready = {notifyFd, POLLIN, 0};
+            if (poll(&ready, 1, changed ? SETTLE_MILLIS : -1) <= 0) {
+                if (changed) return;
+                continue;
+            }
+
+            ssize_t length = read(notifyFd, buffer, sizeof(buffer));
+            for (ssize_t at = 0; at < length;) {
+                auto* event = reinterpret_cast<struct inotify_event*>(buffer + at);
+                if (event->len > 0 && name == event->name) changed = true;
+                at += static_cast<ssize_t>(sizeof(struct inotify_event) + event->len);
+            }
+        }
+    }
+#endif
+
+    // Without inotify, compare the size and time of the file
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(POLL_MILLIS));
+        uint64_t size = 0, modified = 0;
+        if (fileStatus(path, size, modified) && (size != lastSize || modified != lastModified)) {
+            lastSize = size;
+            lastModified = modified;
+            return;
+        }
+    }
+}
+
+int Watcher::run() {
+    std::cout << "Loading file: " << path << std::endl;
+    std::cout << "File loaded, running..." << std::endl;
+    if (update(std::cout, std::cerr)) {
+        std::cout << "Execution complete." << std::endl;
+    }
+
+    while (true) {
+        std::cout << "Watching " << path << " for changes (Ctrl+C to stop)" << std::endl;
+        waitForChange();
+
+        std::cout << std::endl << "Reloading " << path << std::endl;
+        Stopwatch elapsed;
+        if (update(std::cout, std::cerr)) {
+            std::cout << "Execution complete." << std::endl;
+        }
+        std::cerr << "Reused " << reused << (reused == 1 ? " statement in " : " statements in ")
+                  << std::fixed << std::setprecision(2) << elapsed.elapsedMillis() << " ms" << std::endl;
+    }
+}
+
+} // namespace cook